@@ -17,31 +17,18 @@ int main(int argc, char **argv)
 	printf("Read Input Data...\n");
 
 	// ȡݼС
-	size_t train_size = ReadUByteDataset(
-		FLAGS_train_images.c_str(),
-		FLAGS_train_labels.c_str(),
-		nullptr,
-		nullptr,
-		width,
-		height);
-	size_t test_size = ReadUByteDataset(
-		FLAGS_test_images.c_str(), 
-		FLAGS_test_labels.c_str(), 
-		nullptr, 
-		nullptr, 
-		width, 
-		height);
-	if (train_size == 0)
+	UByteDataset train_set, test_set;
+	if (!OpenUByteDataset(FLAGS_train_images.c_str(), FLAGS_train_labels.c_str(), train_set) || train_set.size == 0)
 		return 1;
-
-	std::vector<uint8_t> train_images(train_size * width * height * channels), train_labels(train_size);
-	std::vector<uint8_t> test_images(test_size * width * height * channels), test_labels(test_size);
-
-	// ȡݼ
-	if (ReadUByteDataset(FLAGS_train_images.c_str(), FLAGS_train_labels.c_str(), &train_images[0], &train_labels[0], width, height) != train_size)
-		return 2;
-	if (ReadUByteDataset(FLAGS_test_images.c_str(), FLAGS_test_labels.c_str(), &test_images[0], &test_labels[0], width, height) != test_size)
+	if (!OpenUByteDataset(FLAGS_test_images.c_str(), FLAGS_test_labels.c_str(), test_set))
 		return 3;
+	width = train_set.width;
+	height = train_set.height;
+	const size_t train_size = train_set.size, test_size = test_set.size;
+
+	// Views into the mapped files, nothing is copied
+	const uint8_t *train_images = train_set.images, *train_labels = train_set.labels;
+	const uint8_t *test_images = test_set.images, *test_labels = test_set.labels;
 
 	printf("Mnist train dataset: %d, Mnist test dataset: %d\n", (int)train_size, (int)test_size);
 	printf("Batch size: %lld, iterations: %d\n", FLAGS_batch_size, FLAGS_iterations);
@@ -217,14 +204,10 @@ int main(int argc, char **argv)
 
 	
 	printf("Training...\n");
-	// Normalize training set to be in [0,1]
 	// ѵ
-	std::vector<float> train_images_float(train_images.size()), train_labels_float(train_size);
-	for (size_t i = 0; i < train_size * channels * width * height; ++i)
-		train_images_float[i] = (float)train_images[i] / 255.0f;
-
-	for (size_t i = 0; i < train_size; ++i)
-		train_labels_float[i] = (float)train_labels[i];
+	// only one batch is converted at a time, straight from the mapped files : host memory doesn't grow with the train set
+	const size_t batch_pixels = (size_t)context.m_batchSize * channels * width * height;
+	std::vector<float> batch_images_float(batch_pixels), batch_labels_float(context.m_batchSize);
 
 	// ʹݶ½ķѵ
 	checkCudaErrors(cudaDeviceSynchronize());
@@ -235,11 +218,17 @@ int main(int argc, char **argv)
 		// Train
 		int imageid = iter % (train_size / context.m_batchSize);
 
-		// Prepare current batch on device
-		checkCudaErrors(cudaMemcpyAsync(d_data, &train_images_float[imageid * context.m_batchSize * width*height*channels],
-			sizeof(float)* context.m_batchSize * channels * width * height, cudaMemcpyHostToDevice));
-		checkCudaErrors(cudaMemcpyAsync(d_labels, &train_labels_float[imageid * context.m_batchSize],
-			sizeof(float)* context.m_batchSize, cudaMemcpyHostToDevice));
+		// Normalize current batch to be in [0,1]
+		const uint8_t* batch_images = train_images + (size_t)imageid * batch_pixels;
+		const uint8_t* batch_labels = train_labels + (size_t)imageid * context.m_batchSize;
+		for (size_t i = 0; i < batch_pixels; ++i)
+			batch_images_float[i] = (float)batch_images[i] / 255.0f;
+		for (size_t i = 0; i < (size_t)context.m_batchSize; ++i)
+			batch_labels_float[i] = (float)batch_labels[i];
+
+		// Prepare current batch on device. pageable copies are staged before they return, the buffers can be refilled next iteration
+		checkCudaErrors(cudaMemcpyAsync(d_data, &batch_images_float[0], sizeof(float)* batch_pixels, cudaMemcpyHostToDevice));
+		checkCudaErrors(cudaMemcpyAsync(d_labels, &batch_labels_float[0], sizeof(float)* context.m_batchSize, cudaMemcpyHostToDevice));
 
 		// Forward propagation
 		context.ForwardPropagation(d_data, d_conv1, d_pool1, d_conv2, d_pool2, d_fc1, d_fc1relu, d_fc2, d_fc2smax,
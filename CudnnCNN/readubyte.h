@@ -7,20 +7,43 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <memory>
+
+#include "../EasyCNN/IdxFile.h"
+
+/**
+* A UByte (IDX) dataset mapped into memory. Images and labels point into the mapped files and stay valid
+* as long as the dataset lives, nothing is copied : pages are read from the file when they are first touched.
+*/
+struct UByteDataset
+{
+	std::shared_ptr<EasyCNN::IdxFile> image_file;
+	std::shared_ptr<EasyCNN::IdxFile> label_file;
+
+	/// Number of images (and labels) in the dataset.
+	size_t size = 0;
+
+	/// The width of each image.
+	size_t width = 0;
+
+	/// The height of each image.
+	size_t height = 0;
+
+	/// The images, a Dx1xHxW array (single channel, D is the dataset size).
+	const uint8_t* images = nullptr;
+
+	/// The Dx1 label array.
+	const uint8_t* labels = nullptr;
+};
 
 /**
-* Obtains images and labels from a UByte dataset. If "data" and "labels" are null,
-* only the number of images is returned.
+* Maps the images and labels of a UByte dataset, checking both headers once.
 *
 * @param image_filename The dataset file containing the images.
 * @param label_filename The dataset file containing the labels.
-* @param data The output dataset, a Dx1xHxW array (single channel, D is the dataset size).
-* @param labels The Dx1 label array.
-* @param width The width of each image.
-* @param height The height of each image.
-* @return Number of images in dataset.
+* @param dataset The mapped dataset.
+* @return false (the reason printed) if a file is invalid or they don't match.
 */
-size_t ReadUByteDataset(const char* image_filename, const char* label_filename,
-	uint8_t *data, uint8_t *labels, size_t& width, size_t& height);
+bool OpenUByteDataset(const char* image_filename, const char* label_filename, UByteDataset& dataset);
 
 #endif  // __CUDNN_TRAINING_READUBYTE_H
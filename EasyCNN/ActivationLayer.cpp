@@ -1,5 +1,9 @@
 #include <algorithm>
 #include "ActivationLayer.h"
+#include "Kernels.h"
+
+//elements per parallel chunk
+static const size_t elementGrain = 16384;
 
 //Sigmoid Layer
 EasyCNN::SigmodLayer::SigmodLayer()
@@ -13,27 +17,15 @@ EasyCNN::SigmodLayer::~SigmodLayer()
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::SigmodLayer, "SigmodLayer");
-std::string EasyCNN::SigmodLayer::getLayerType() const
+const std::string& EasyCNN::SigmodLayer::getLayerType() const
 {
 	return layerType;
 }
 
-//f(x)=1/(1+e^(-x))
-static inline float sigmodOperator(const float x)
-{
-	float result = 0;
-	result = 1.0f / (1.0f + std::exp(-1.0f * x));
-	return result;
-}
-
-//f'(x) = x(1-x)
-static inline float sigmodDfOperator(const float x)
-{
-	return x * (1.0f - x);
-}
-
+//f(x)=1/(1+e^(-x)), f'(x) = f(x)(1-f(x)) : getKernels().sigmoid / sigmoidBackward
 //Sigmoid forward
-void EasyCNN::SigmodLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::SigmodLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
@@ -41,20 +33,11 @@ void EasyCNN::SigmodLayer::forward(const std::shared_ptr<DataBucket> prevDataBuc
 	const float* prevRawData = prevDataBucket->getData().get();
 	float* nextRawData = nextDataBucket->getData().get();
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	const auto kernel = getKernels().sigmoid;
+	parallelFor(pool, nextDataBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
-		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++)
-			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
-				{
-					const size_t nextDataIdx = nextDataSize.getIndex(nn, nc, nh, nw);
-					nextRawData[nextDataIdx] = sigmodOperator(prevRawData[nextDataIdx]);
-				}
-			}
-		}
-	}
+		kernel(prevRawData + begin, nextRawData + begin, end - begin);
+	}, elementGrain);
 }
 //Sigmoid backward
 void EasyCNN::SigmodLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
@@ -63,44 +46,21 @@ void EasyCNN::SigmodLayer::backward(std::shared_ptr<DataBucket> prevDataBucket,
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 	const DataSize nextDiffSize = nextDiffBucket->getSize();
-	const float* prevData = prevDataBucket->getData().get();
 	const float* nextData = nextDataBucket->getData().get();
-	const float* nextDiff = nextDiffBucket->getData().get();
-	easyAssert(prevDataSize == nextDataSize, "size must be equal!");
-
-	//update prevDiff data, initial
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
-	float* prevDiff = prevDiffBucket->getData().get();
+	easyAssert(prevDataSize == nextDataSize && nextDiffSize == nextDataSize, "size must be equal!");
+	easyAssert(nextDiffBucket->getLayout() == prevDataBucket->getLayout(), "diff layout is invalidate.");
 
 	//calculate current inner diff
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
-	{
-		for (size_t pc = 0; pc < prevDiffSize.channels; pc++)
-		{
-			for (size_t ph = 0; ph < prevDiffSize.height; ph++)
-			{
-				for (size_t pw = 0; pw < prevDiffSize.width; pw++)
-				{
-					const size_t dataIdx = nextDataSize.getIndex(pn, pc, ph, pw);
-					const size_t paramIdx = prevDiffSize.getIndex(pn, pc, ph, pw);
-					prevDiff[paramIdx] += sigmodDfOperator(nextData[dataIdx]);
-				}
-			}
-		}
-	}
-
-	//multiply next diff
-	for (size_t i = 0; i < prevDiffBucket->getSize()._4DSize(); i++)
+	//and multiply next diff, in place : nextDiff becomes prevDiff
+	float* diff = nextDiffBucket->getData().get();
+	const auto kernel = getKernels().sigmoidBackward;
+	parallelFor(getThreadPool(), nextDiffBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		prevDiff[i] *= nextDiff[i];
-	}
-
-	nextDiffBucket = prevDiffBucket;
+		kernel(nextData + begin, diff + begin, diff + begin, end - begin);
+	}, elementGrain);
 
 	//update this layer's param
-	//Tanh layer : nop
+	//Sigmoid layer : nop
 }
 
 //TanhLayer
@@ -115,29 +75,15 @@ EasyCNN::TanhLayer::~TanhLayer()
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::TanhLayer, "TanhLayer");
-std::string EasyCNN::TanhLayer::getLayerType() const
+const std::string& EasyCNN::TanhLayer::getLayerType() const
 {
 	return layerType;
 }
 
-//f(x)=(e^x-e^(-x))/(e^x+e^(-x))
-static inline float tanhOperator(const float x)
-{
-	float result = 0;
-	const float ex = std::exp(x);
-	const float efx = std::exp(-x);
-	result = (ex - efx) / (ex + efx);
-	return result;
-}
-
-//f'(x)=1-x^(1/2)
-static inline float tanhDfOperator(const float x)
-{
-	return 1.0f - std::sqrt(x);
-}
-
+//f(x)=tanh(x), f'(x) = 1-f(x)^2 : getKernels().tanh / tanhBackward
 //tanh forward
-void EasyCNN::TanhLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::TanhLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
@@ -145,20 +91,11 @@ void EasyCNN::TanhLayer::forward(const std::shared_ptr<DataBucket> prevDataBucke
 	const float* prevRawData = prevDataBucket->getData().get();
 	float* nextRawData = nextDataBucket->getData().get();
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	const auto kernel = getKernels().tanh;
+	parallelFor(pool, nextDataBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
-		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++)
-			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
-				{
-					const size_t nextDataIdx = nextDataSize.getIndex(nn, nc, nh, nw);
-					nextRawData[nextDataIdx] += tanhOperator(prevRawData[nextDataIdx]);
-				}
-			}
-		}
-	}
+		kernel(prevRawData + begin, nextRawData + begin, end - begin);
+	}, elementGrain);
 }
 
 //tanh backward
@@ -168,41 +105,18 @@ void EasyCNN::TanhLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, co
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 	const DataSize nextDiffSize = nextDiffBucket->getSize();
-	const float* prevData = prevDataBucket->getData().get();
 	const float* nextData = nextDataBucket->getData().get();
-	const float* nextDiff = nextDiffBucket->getData().get();
-	easyAssert(prevDataSize == nextDataSize, "size must be equal!");
-
-	//update prevDiff data
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
-	float* prevDiff = prevDiffBucket->getData().get();
+	easyAssert(prevDataSize == nextDataSize && nextDiffSize == nextDataSize, "size must be equal!");
+	easyAssert(nextDiffBucket->getLayout() == prevDataBucket->getLayout(), "diff layout is invalidate.");
 
 	//calculate current inner diff
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	//and multiply next diff, in place : nextDiff becomes prevDiff
+	float* diff = nextDiffBucket->getData().get();
+	const auto kernel = getKernels().tanhBackward;
+	parallelFor(getThreadPool(), nextDiffBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t pc = 0; pc < prevDiffSize.channels; pc++)
-		{
-			for (size_t ph = 0; ph < prevDiffSize.height; ph++)
-			{
-				for (size_t pw = 0; pw < prevDiffSize.width; pw++)
-				{
-					const size_t dataIdx = nextDataSize.getIndex(pn, pc, ph, pw);
-					const size_t paramIdx = prevDiffSize.getIndex(pn, pc, ph, pw);
-					prevDiff[paramIdx] += tanhDfOperator(nextData[dataIdx]);
-				}
-			}
-		}
-	}
-
-	//multiply next diff
-	for (size_t i = 0; i < prevDiffBucket->getSize()._4DSize(); i++)
-	{
-		prevDiff[i] *= nextDiff[i];
-	}
-
-	nextDiffBucket = prevDiffBucket;
+		kernel(nextData + begin, diff + begin, diff + begin, end - begin);
+	}, elementGrain);
 
 	//update this layer's param
 	//Tanh layer : nop
@@ -220,26 +134,15 @@ EasyCNN::ReluLayer::~ReluLayer()
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::ReluLayer, "ReluLayer");
-std::string EasyCNN::ReluLayer::getLayerType() const
+const std::string& EasyCNN::ReluLayer::getLayerType() const
 {
 	return layerType;
 }
 
-//f(x)=max(x,0)
-static inline float reluOperator(const float x)
-{
-	float result = std::max(x, 0.0f);
-	return result;
-}
-
-//f'(x)=0(x<=0),1(x>0)
-static inline float reluDfOperator(const float x)
-{
-	//note : too small df is not suitable.
-	return x <= 0.0f ? 0.01f : 1.0f;
-}
+//f(x)=max(x,0), f'(x)=0.01(x<=0),1(x>0) : getKernels().relu / reluBackward
 //ReluLayer forward
-void EasyCNN::ReluLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::ReluLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
@@ -247,20 +150,11 @@ void EasyCNN::ReluLayer::forward(const std::shared_ptr<DataBucket> prevDataBucke
 	const float* prevRawData = prevDataBucket->getData().get();
 	float* nextRawData = nextDataBucket->getData().get();
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	const auto kernel = getKernels().relu;
+	parallelFor(pool, nextDataBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
-		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++)
-			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
-				{
-					const size_t nextDataIdx = nextDataSize.getIndex(nn, nc, nh, nw);
-					nextRawData[nextDataIdx] = reluOperator(prevRawData[nextDataIdx]);
-				}
-			}
-		}
-	}
+		kernel(prevRawData + begin, nextRawData + begin, end - begin);
+	}, elementGrain);
 }
 
 //ReluLayer backward
@@ -270,41 +164,18 @@ void EasyCNN::ReluLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, co
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 	const DataSize nextDiffSize = nextDiffBucket->getSize();
-	const float* prevData = prevDataBucket->getData().get();
 	const float* nextData = nextDataBucket->getData().get();
-	const float* nextDiff = nextDiffBucket->getData().get();
-	easyAssert(prevDataSize == nextDataSize, "size must be equal!");
-
-	//update prevDiff data
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
-	float* prevDiff = prevDiffBucket->getData().get();
+	easyAssert(prevDataSize == nextDataSize && nextDiffSize == nextDataSize, "size must be equal!");
+	easyAssert(nextDiffBucket->getLayout() == prevDataBucket->getLayout(), "diff layout is invalidate.");
 
 	//calculate current inner diff
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
-	{
-		for (size_t pc = 0; pc < prevDiffSize.channels; pc++)
-		{
-			for (size_t ph = 0; ph < prevDiffSize.height; ph++)
-			{
-				for (size_t pw = 0; pw < prevDiffSize.width; pw++)
-				{
-					const size_t dataIdx = nextDataSize.getIndex(pn, pc, ph, pw);
-					const size_t paramIdx = prevDiffSize.getIndex(pn, pc, ph, pw);
-					prevDiff[paramIdx] += reluDfOperator(nextData[dataIdx]);
-				}
-			}
-		}
-	}
-
-	//multiply next diff
-	for (size_t i = 0; i < prevDiffBucket->getSize()._4DSize(); i++)
+	//and multiply next diff, in place : nextDiff becomes prevDiff
+	float* diff = nextDiffBucket->getData().get();
+	const auto kernel = getKernels().reluBackward;
+	parallelFor(getThreadPool(), nextDiffBucket->getStorageSize(), [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		prevDiff[i] *= nextDiff[i];
-	}
-
-	nextDiffBucket = prevDiffBucket;
+		kernel(nextData + begin, diff + begin, diff + begin, end - begin);
+	}, elementGrain);
 
 	//update this layer's param
 	//RELU layer : nop
@@ -5,8 +5,14 @@
 
 namespace EasyCNN
 {
+	//element wise, works in whatever layout the previous layer produces, in place,
+	//the derivative is taken from the output
 	class ActivationLayer : public Layer
 	{
+	protected:
+		virtual DataLayout getPreferredLayout(const DataLayout prevLayout) const override{ return prevLayout; }
+		virtual bool isInPlaceCapable() const override{ return true; }
+		virtual bool isOutputUsedInBackward() const override{ return true; }
 	};
 
 	class SigmodLayer : public ActivationLayer
@@ -17,8 +23,9 @@ namespace EasyCNN
 		virtual ~SigmodLayer();
 	protected:
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual const std::string& getLayerType() const override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
 	};
 
@@ -30,8 +37,9 @@ namespace EasyCNN
 		virtual ~TanhLayer();
 	protected:
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual const std::string& getLayerType() const override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
 	};
 
@@ -43,8 +51,9 @@ namespace EasyCNN
 		virtual ~ReluLayer();
 	protected:
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual const std::string& getLayerType() const override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include "Allocator.h"
+#include "EasyAssert.h"
+
+static std::atomic<size_t> allocationCount(0);
+static std::atomic<size_t> allocatedBytes(0);
+
+static const size_t hugePageSize = (size_t)2 << 20;
+
+static size_t roundUp(const size_t value, const size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+static void* alignedMalloc(const size_t bytes, const size_t alignment)
+{
+#ifdef _WIN32
+	return _aligned_malloc(bytes, alignment);
+#else
+	void* data = nullptr;
+	return posix_memalign(&data, alignment, bytes) == 0 ? data : nullptr;
+#endif
+}
+
+static void alignedFree(void* data)
+{
+#ifdef _WIN32
+	_aligned_free(data);
+#else
+	free(data);
+#endif
+}
+
+//AlignedAllocator
+EasyCNN::AlignedAllocator::AlignedAllocator(const size_t hugePageBytes, const bool reservedHugePages)
+	:hugePageBytes(hugePageBytes), reservedHugePages(reservedHugePages)
+{
+}
+
+EasyCNN::AlignedAllocator::~AlignedAllocator()
+{
+}
+
+const char* EasyCNN::AlignedAllocator::getName() const
+{
+	return "aligned";
+}
+
+float* EasyCNN::AlignedAllocator::allocate(const size_t count)
+{
+	const size_t bytes = roundUp(std::max<size_t>(count, 1) * sizeof(float), storageAlignment);
+	void* data = nullptr;
+#ifdef __linux__
+	if (hugePageBytes > 0 && bytes >= hugePageBytes)
+	{
+		const size_t mappedBytes = roundUp(bytes, hugePageSize);
+		if (reservedHugePages)
+		{
+			void* mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (mapped != MAP_FAILED)
+			{
+				std::lock_guard<std::mutex> lock(mappedMutex);
+				mappedBuffers.insert((float*)mapped);
+				return (float*)mapped;
+			}
+		}
+		//huge page aligned, so the kernel can back it with huge pages from the first byte
+		data = alignedMalloc(mappedBytes, hugePageSize);
+		if (data != nullptr)
+		{
+			madvise(data, mappedBytes, MADV_HUGEPAGE);
+		}
+	}
+#endif
+	if (data == nullptr)
+	{
+		data = alignedMalloc(bytes, storageAlignment);
+	}
+	if (data == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return (float*)data;
+}
+
+void EasyCNN::AlignedAllocator::deallocate(float* data, const size_t count)
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+#ifdef __linux__
+	if (reservedHugePages)
+	{
+		std::lock_guard<std::mutex> lock(mappedMutex);
+		const auto iter = mappedBuffers.find(data);
+		if (iter != mappedBuffers.end())
+		{
+			mappedBuffers.erase(iter);
+			munmap(data, roundUp(std::max<size_t>(count, 1) * sizeof(float), hugePageSize));
+			return;
+		}
+	}
+#endif
+	alignedFree(data);
+}
+
+//PoolAllocator
+EasyCNN::PoolAllocator::PoolAllocator(std::shared_ptr<Allocator> upstream, const size_t maxPooledBytes)
+	:upstream(upstream), maxPooledBytes(maxPooledBytes)
+{
+	easyAssert(upstream.get() != nullptr, "upstream allocator can't be null.");
+}
+
+EasyCNN::PoolAllocator::~PoolAllocator()
+{
+	trim();
+}
+
+const char* EasyCNN::PoolAllocator::getName() const
+{
+	return "pool";
+}
+
+//4 classes per power of two : the top 3 bits of the size, rounded up. small buffers share one class per cache line.
+size_t EasyCNN::PoolAllocator::getClassSize(const size_t count)
+{
+	const size_t lineFloats = storageAlignment / sizeof(float);
+	size_t size = roundUp(std::max<size_t>(count, 1), lineFloats);
+	if (size <= 4 * lineFloats)
+	{
+		return size;
+	}
+	size_t shift = 0;
+	while ((size >> shift) > 7)
+	{
+		shift++;
+	}
+	const size_t step = (size_t)1 << shift;
+	return roundUp(size, step);
+}
+
+float* EasyCNN::PoolAllocator::allocate(const size_t count)
+{
+	const size_t classSize = getClassSize(count);
+	if (classSize * sizeof(float) > maxPooledBytes)
+	{
+		return upstream->allocate(count);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto iter = freeLists.find(classSize);
+		if (iter != freeLists.end() && !iter->second.empty())
+		{
+			float* data = iter->second.back();
+			iter->second.pop_back();
+			cachedBytes -= classSize * sizeof(float);
+			return data;
+		}
+	}
+	return upstream->allocate(classSize);
+}
+
+void EasyCNN::PoolAllocator::deallocate(float* data, const size_t count)
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+	const size_t classSize = getClassSize(count);
+	if (classSize * sizeof(float) > maxPooledBytes)
+	{
+		upstream->deallocate(data, count);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	freeLists[classSize].push_back(data);
+	cachedBytes += classSize * sizeof(float);
+}
+
+size_t EasyCNN::PoolAllocator::getCachedBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return cachedBytes;
+}
+
+void EasyCNN::PoolAllocator::trim()
+{
+	std::map<size_t, std::vector<float*>> released;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		released.swap(freeLists);
+		cachedBytes = 0;
+	}
+	for (auto& freeList : released)
+	{
+		for (float* data : freeList.second)
+		{
+			upstream->deallocate(data, freeList.first);
+		}
+	}
+}
+
+//default allocator
+static std::shared_ptr<EasyCNN::Allocator> createDefaultAllocator()
+{
+	const char* hugePages = std::getenv("EASYCNN_HUGEPAGES");
+	const std::string mode = hugePages != nullptr ? hugePages : "";
+	const size_t hugePageBytes = mode == "off" ? 0 : hugePageSize;
+	return std::make_shared<EasyCNN::PoolAllocator>(std::make_shared<EasyCNN::AlignedAllocator>(hugePageBytes, mode == "reserved"));
+}
+
+static std::mutex defaultAllocatorMutex;
+static std::shared_ptr<EasyCNN::Allocator>& defaultAllocatorSlot()
+{
+	static std::shared_ptr<EasyCNN::Allocator> allocator = createDefaultAllocator();
+	return allocator;
+}
+
+std::shared_ptr<EasyCNN::Allocator> EasyCNN::getDefaultAllocator()
+{
+	std::lock_guard<std::mutex> lock(defaultAllocatorMutex);
+	return defaultAllocatorSlot();
+}
+
+void EasyCNN::setDefaultAllocator(std::shared_ptr<Allocator> allocator)
+{
+	easyAssert(allocator.get() != nullptr, "allocator can't be null.");
+	std::lock_guard<std::mutex> lock(defaultAllocatorMutex);
+	defaultAllocatorSlot() = allocator;
+}
+
+namespace
+{
+	//gives the buffer back to the allocator it came from, which it keeps alive until then
+	struct AllocatorDeleter
+	{
+		std::shared_ptr<EasyCNN::Allocator> allocator;
+		size_t count;
+		void operator()(float* data) const
+		{
+			allocator->deallocate(data, count);
+		}
+	};
+}
+
+std::shared_ptr<float> EasyCNN::allocateFloats(const size_t count, std::shared_ptr<Allocator> allocator)
+{
+	if (allocator.get() == nullptr)
+	{
+		allocator = getDefaultAllocator();
+	}
+	float* data = allocator->allocate(count);
+	allocationCount++;
+	allocatedBytes += count * sizeof(float);
+	return std::shared_ptr<float>(data, AllocatorDeleter{ allocator, count });
+}
+
+size_t EasyCNN::getAllocationCount()
+{
+	return allocationCount;
+}
+
+size_t EasyCNN::getAllocatedBytes()
+{
+	return allocatedBytes;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//bucket storage is 64 byte aligned : a cache line, and enough for any simd load up to avx-512
+	const size_t storageAlignment = 64;
+
+	//where bucket storage comes from. allocate returns storageAlignment aligned memory for count floats,
+	//deallocate gets back the same pointer with the same count. implementations must be thread safe.
+	class Allocator
+	{
+	public:
+		virtual ~Allocator() {}
+		virtual const char* getName() const = 0;
+		virtual float* allocate(const size_t count) = 0;
+		virtual void deallocate(float* data, const size_t count) = 0;
+	};
+
+	//straight from the system. on linux, buffers of hugePageBytes and more are backed by huge pages :
+	//reserved ones (MAP_HUGETLB) when reservedHugePages is set and the system has them left,
+	//transparent ones (2MB aligned + madvise(MADV_HUGEPAGE)) otherwise. hugePageBytes 0 never uses huge pages.
+	class AlignedAllocator : public Allocator
+	{
+	public:
+		explicit AlignedAllocator(const size_t hugePageBytes = 0, const bool reservedHugePages = false);
+		virtual ~AlignedAllocator();
+		virtual const char* getName() const override;
+		virtual float* allocate(const size_t count) override;
+		virtual void deallocate(float* data, const size_t count) override;
+	private:
+		size_t hugePageBytes = 0;
+		bool reservedHugePages = false;
+		//buffers that came from MAP_HUGETLB, they go back with munmap
+		std::mutex mappedMutex;
+		std::set<float*> mappedBuffers;
+	};
+
+	//keeps freed buffers on one free list per size class and hands them out again. there are 4 classes
+	//per power of two, a buffer is at most 25% larger than asked for. buffers above maxPooledBytes bypass the pool.
+	//cached buffers go back upstream on trim() and when the pool dies, buffers still out keep the pool alive.
+	class PoolAllocator : public Allocator
+	{
+	public:
+		explicit PoolAllocator(std::shared_ptr<Allocator> upstream, const size_t maxPooledBytes = (size_t)1 << 30);
+		virtual ~PoolAllocator();
+		virtual const char* getName() const override;
+		virtual float* allocate(const size_t count) override;
+		virtual void deallocate(float* data, const size_t count) override;
+		//bytes sitting on the free lists
+		size_t getCachedBytes() const;
+		void trim();
+	private:
+		static size_t getClassSize(const size_t count);
+	private:
+		std::shared_ptr<Allocator> upstream;
+		size_t maxPooledBytes = 0;
+		mutable std::mutex mutex;
+		//class size in floats -> free buffers
+		std::map<size_t, std::vector<float*>> freeLists;
+		size_t cachedBytes = 0;
+	};
+
+	//the allocator buckets use when not handed one : a pool over aligned storage with transparent huge pages
+	//from 2MB up. EASYCNN_HUGEPAGES=reserved asks for reserved huge pages first, EASYCNN_HUGEPAGES=off never uses them.
+	std::shared_ptr<Allocator> getDefaultAllocator();
+	void setDefaultAllocator(std::shared_ptr<Allocator> allocator);
+
+	//every bucket's and arena's float buffer comes from here, a null allocator means the default one
+	std::shared_ptr<float> allocateFloats(const size_t count, std::shared_ptr<Allocator> allocator = nullptr);
+	//buffers / bytes handed out by allocateFloats so far, a steady state training step adds none
+	size_t getAllocationCount();
+	size_t getAllocatedBytes();
+}
@@ -0,0 +1,122 @@
+#include <cstdlib>
+#include <algorithm>
+#include "Blas.h"
+#include "Gemm.h"
+#include "Kernels.h"
+
+namespace
+{
+	//Gemm.cpp's packed sgemm and the isa dispatched dot / axpy
+	class BuiltinBlas : public EasyCNN::BlasBackend
+	{
+	public:
+		virtual std::string getName() const override
+		{
+			return "builtin";
+		}
+		virtual void gemm(const bool transA, const bool transB,
+			const size_t M, const size_t N, const size_t K,
+			const float alpha, const float* A, const size_t lda,
+			const float* B, const size_t ldb,
+			const float beta, float* C, const size_t ldc) const override
+		{
+			EasyCNN::sgemm(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+		}
+		virtual void gemv(const bool transA, const size_t M, const size_t N,
+			const float alpha, const float* A, const size_t lda,
+			const float* x, const float beta, float* y) const override
+		{
+			const EasyCNN::KernelTable& kernels = EasyCNN::getKernels();
+			if (!transA)
+			{
+				//one dot product per row
+				for (size_t i = 0; i < M; i++)
+				{
+					const float sum = alpha * kernels.dot(A + i * lda, x, N);
+					y[i] = beta == 0.0f ? sum : sum + beta * y[i];
+				}
+				return;
+			}
+			//A' * x walks A row by row as well : y += (alpha * x[i]) * A[i]
+			for (size_t j = 0; j < N; j++)
+			{
+				y[j] = beta == 0.0f ? 0.0f : beta * y[j];
+			}
+			for (size_t i = 0; i < M; i++)
+			{
+				kernels.axpy(N, alpha * x[i], A + i * lda, y);
+			}
+		}
+		virtual void axpy(const size_t n, const float alpha, const float* x, float* y) const override
+		{
+			EasyCNN::getKernels().axpy(n, alpha, x, y);
+		}
+	};
+
+	std::vector<std::shared_ptr<EasyCNN::BlasBackend>> createBackends()
+	{
+		std::vector<std::shared_ptr<EasyCNN::BlasBackend>> backends;
+		backends.push_back(std::make_shared<BuiltinBlas>());
+#if WITH_CBLAS
+		backends.push_back(EasyCNN::createCblasBackend());
+#endif
+		return backends;
+	}
+
+	const std::vector<std::shared_ptr<EasyCNN::BlasBackend>>& getBackends()
+	{
+		static const std::vector<std::shared_ptr<EasyCNN::BlasBackend>> backends = createBackends();
+		return backends;
+	}
+
+	std::shared_ptr<EasyCNN::BlasBackend> findBackend(const std::string& name)
+	{
+		for (const auto& backend : getBackends())
+		{
+			if (backend->getName() == name)
+			{
+				return backend;
+			}
+		}
+		return nullptr;
+	}
+
+	std::shared_ptr<EasyCNN::BlasBackend> findStartupBackend()
+	{
+		const char* name = std::getenv("EASYCNN_BLAS");
+		std::shared_ptr<EasyCNN::BlasBackend> backend = name != nullptr ? findBackend(name) : nullptr;
+		return backend.get() != nullptr ? backend : getBackends().front();
+	}
+
+	std::shared_ptr<EasyCNN::BlasBackend>& getCurrentBackend()
+	{
+		static std::shared_ptr<EasyCNN::BlasBackend> backend = findStartupBackend();
+		return backend;
+	}
+}
+
+const EasyCNN::BlasBackend& EasyCNN::getBlas()
+{
+	return *getCurrentBackend();
+}
+
+bool EasyCNN::setBlasBackend(const std::string& name)
+{
+	std::shared_ptr<BlasBackend> backend = findBackend(name);
+	if (backend.get() == nullptr)
+	{
+		return false;
+	}
+	getCurrentBackend() = backend;
+	return true;
+}
+
+std::vector<std::string> EasyCNN::getBlasBackendNames()
+{
+	std::vector<std::string> names;
+	for (const auto& backend : getBackends())
+	{
+		names.push_back(backend->getName());
+	}
+	return names;
+}
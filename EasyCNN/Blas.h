@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//the blas routines layers call, all matrices are row major.
+	//"builtin" (Gemm.cpp + the isa kernels) is always there, vendor libraries plug in behind build flags.
+	class BlasBackend
+	{
+	public:
+		virtual ~BlasBackend() {}
+		virtual std::string getName() const = 0;
+		//C(MxN) = alpha * op(A)(MxK) * op(B)(KxN) + beta * C
+		virtual void gemm(const bool transA, const bool transB,
+			const size_t M, const size_t N, const size_t K,
+			const float alpha, const float* A, const size_t lda,
+			const float* B, const size_t ldb,
+			const float beta, float* C, const size_t ldc) const = 0;
+		//y = alpha * op(A) * x + beta * y, A is (MxN), y has M elements (N when transA)
+		virtual void gemv(const bool transA, const size_t M, const size_t N,
+			const float alpha, const float* A, const size_t lda,
+			const float* x, const float beta, float* y) const = 0;
+		//y += alpha * x
+		virtual void axpy(const size_t n, const float alpha, const float* x, float* y) const = 0;
+	};
+
+	//the backend picked at startup : EASYCNN_BLAS when it names a compiled in backend, builtin otherwise.
+	const BlasBackend& getBlas();
+	//switches every later getBlas() to the backend called name, returns false (and changes nothing) if it isn't compiled in.
+	//not thread safe, call it before running a network.
+	bool setBlasBackend(const std::string& name);
+	std::vector<std::string> getBlasBackendNames();
+
+#if WITH_CBLAS
+	//system cblas (OpenBLAS / BLIS / MKL's cblas interface), BlasCblas.cpp
+	std::shared_ptr<BlasBackend> createCblasBackend();
+#endif
+}
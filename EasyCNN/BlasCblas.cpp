@@ -0,0 +1,43 @@
+#include "Blas.h"
+
+#if WITH_CBLAS
+#include <cblas.h>
+
+namespace
+{
+	//row major calls straight into the system cblas, the library's own threading applies
+	class CblasBlas : public EasyCNN::BlasBackend
+	{
+	public:
+		virtual std::string getName() const override
+		{
+			return "cblas";
+		}
+		virtual void gemm(const bool transA, const bool transB,
+			const size_t M, const size_t N, const size_t K,
+			const float alpha, const float* A, const size_t lda,
+			const float* B, const size_t ldb,
+			const float beta, float* C, const size_t ldc) const override
+		{
+			cblas_sgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans,
+				(int)M, (int)N, (int)K, alpha, A, (int)lda, B, (int)ldb, beta, C, (int)ldc);
+		}
+		virtual void gemv(const bool transA, const size_t M, const size_t N,
+			const float alpha, const float* A, const size_t lda,
+			const float* x, const float beta, float* y) const override
+		{
+			cblas_sgemv(CblasRowMajor, transA ? CblasTrans : CblasNoTrans,
+				(int)M, (int)N, alpha, A, (int)lda, x, 1, beta, y, 1);
+		}
+		virtual void axpy(const size_t n, const float alpha, const float* x, float* y) const override
+		{
+			cblas_saxpy((int)n, alpha, x, 1, y, 1);
+		}
+	};
+}
+
+std::shared_ptr<EasyCNN::BlasBackend> EasyCNN::createCblasBackend()
+{
+	return std::make_shared<CblasBlas>();
+}
+#endif
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include "BlockedConvolver.h"
+#include "EasyAssert.h"
+
+namespace
+{
+	struct ConvShape
+	{
+		size_t inBlocks, outBlocks;
+		size_t inHeight, inWidth, outHeight, outWidth;
+		size_t kernelHeight, kernelWidth, heightStep, widthStep;
+	};
+
+	//one output row of one output block, 4 pixels at a time so every weight row is reused 4 times.
+	//weights : (inBlocks, kh, kw, inLane, outLane) of this output block.
+	template <size_t B>
+	void forwardRow(const ConvShape& shape, const float* input, const float* weights, const size_t oh, float* outputRow)
+	{
+		const size_t pixelStep = shape.widthStep * B;
+		for (size_t ow = 0; ow < shape.outWidth; ow += 4)
+		{
+			const size_t pixels = std::min<size_t>(4, shape.outWidth - ow);
+			float acc[4][B];
+			for (size_t p = 0; p < 4; p++)
+			{
+				for (size_t lane = 0; lane < B; lane++)
+				{
+					acc[p][lane] = p < pixels ? outputRow[(ow + p) * B + lane] : 0.0f;
+				}
+			}
+			for (size_t icb = 0; icb < shape.inBlocks; icb++)
+			{
+				for (size_t kh = 0; kh < shape.kernelHeight; kh++)
+				{
+					const float* inRow = input + ((icb * shape.inHeight + oh * shape.heightStep + kh) * shape.inWidth + ow * shape.widthStep) * B;
+					const float* w = weights + ((icb * shape.kernelHeight + kh) * shape.kernelWidth) * B * B;
+					for (size_t kw = 0; kw < shape.kernelWidth; kw++, w += B * B)
+					{
+						const float* x = inRow + kw * B;
+						if (pixels == 4)
+						{
+							for (size_t il = 0; il < B; il++)
+							{
+								const float x0 = x[il], x1 = x[pixelStep + il], x2 = x[2 * pixelStep + il], x3 = x[3 * pixelStep + il];
+								const float* wr = w + il * B;
+								for (size_t lane = 0; lane < B; lane++)
+								{
+									acc[0][lane] += x0 * wr[lane];
+									acc[1][lane] += x1 * wr[lane];
+									acc[2][lane] += x2 * wr[lane];
+									acc[3][lane] += x3 * wr[lane];
+								}
+							}
+						}
+						else
+						{
+							for (size_t p = 0; p < pixels; p++)
+							{
+								for (size_t il = 0; il < B; il++)
+								{
+									const float xv = x[p * pixelStep + il];
+									const float* wr = w + il * B;
+									for (size_t lane = 0; lane < B; lane++)
+									{
+										acc[p][lane] += xv * wr[lane];
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+			for (size_t p = 0; p < pixels; p++)
+			{
+				for (size_t lane = 0; lane < B; lane++)
+				{
+					outputRow[(ow + p) * B + lane] = acc[p][lane];
+				}
+			}
+		}
+	}
+
+	//data gradient of one input row of one input block, gathered from every output pixel the row feeds,
+	//4 pixels at a time with the accumulators in registers.
+	//weightsT : (outBlocks, kh, kw, outLane, inLane) of this input block.
+	template <size_t B>
+	void backwardDataRow(const ConvShape& shape, const float* outputDiff, const float* weightsT, const size_t ih, float* inputDiffRow)
+	{
+		for (size_t iw = 0; iw < shape.inWidth; iw += 4)
+		{
+			const size_t pixels = std::min<size_t>(4, shape.inWidth - iw);
+			float acc[4][B] = {};
+			for (size_t ocb = 0; ocb < shape.outBlocks; ocb++)
+			{
+				for (size_t kh = 0; kh < shape.kernelHeight && kh <= ih; kh++)
+				{
+					if ((ih - kh) % shape.heightStep != 0 || (ih - kh) / shape.heightStep >= shape.outHeight)
+					{
+						continue;
+					}
+					const size_t oh = (ih - kh) / shape.heightStep;
+					const float* diffRow = outputDiff + (ocb * shape.outHeight + oh) * shape.outWidth * B;
+					const float* w = weightsT + ((ocb * shape.kernelHeight + kh) * shape.kernelWidth) * B * B;
+					for (size_t kw = 0; kw < shape.kernelWidth; kw++, w += B * B)
+					{
+						//step 1 and all 4 pixels inside the output : 4 consecutive output pixels
+						if (shape.widthStep == 1 && pixels == 4 && iw >= kw && iw + 3 - kw < shape.outWidth)
+						{
+							const float* g = diffRow + (iw - kw) * B;
+							for (size_t ol = 0; ol < B; ol++)
+							{
+								const float g0 = g[ol], g1 = g[B + ol], g2 = g[2 * B + ol], g3 = g[3 * B + ol];
+								const float* wr = w + ol * B;
+								for (size_t lane = 0; lane < B; lane++)
+								{
+									acc[0][lane] += g0 * wr[lane];
+									acc[1][lane] += g1 * wr[lane];
+									acc[2][lane] += g2 * wr[lane];
+									acc[3][lane] += g3 * wr[lane];
+								}
+							}
+							continue;
+						}
+						for (size_t p = 0; p < pixels; p++)
+						{
+							const size_t ix = iw + p;
+							if (ix < kw || (ix - kw) % shape.widthStep != 0 || (ix - kw) / shape.widthStep >= shape.outWidth)
+							{
+								continue;
+							}
+							const float* g = diffRow + (ix - kw) / shape.widthStep * B;
+							for (size_t ol = 0; ol < B; ol++)
+							{
+								const float gv = g[ol];
+								const float* wr = w + ol * B;
+								for (size_t lane = 0; lane < B; lane++)
+								{
+									acc[p][lane] += gv * wr[lane];
+								}
+							}
+						}
+					}
+				}
+			}
+			for (size_t p = 0; p < pixels; p++)
+			{
+				for (size_t lane = 0; lane < B; lane++)
+				{
+					inputDiffRow[(iw + p) * B + lane] = acc[p][lane];
+				}
+			}
+		}
+	}
+
+	//kernel gradient of one (output block, input block) pair, summed over the batch.
+	//every tap is an outer product sum over all output pixels, 8 input lanes x B output lanes held in registers.
+	//kernelDiff : (kh, kw, inLane, outLane).
+	template <size_t B>
+	void backwardKernelBlock(const ConvShape& shape, const size_t number, const float* input, const size_t inputStride,
+		const float* outputDiff, const size_t outputStride, float* kernelDiff)
+	{
+		const size_t rows = 8;
+		for (size_t kh = 0; kh < shape.kernelHeight; kh++)
+		{
+			for (size_t kw = 0; kw < shape.kernelWidth; kw++)
+			{
+				for (size_t il0 = 0; il0 < B; il0 += rows)
+				{
+					float acc[8][B] = {};
+					for (size_t nn = 0; nn < number; nn++)
+					{
+						for (size_t oh = 0; oh < shape.outHeight; oh++)
+						{
+							const float* xRow = input + nn * inputStride +
+								((oh * shape.heightStep + kh) * shape.inWidth + kw) * B + il0;
+							const float* gRow = outputDiff + nn * outputStride + oh * shape.outWidth * B;
+							for (size_t ow = 0; ow < shape.outWidth; ow++)
+							{
+								const float* x = xRow + ow * shape.widthStep * B;
+								const float* g = gRow + ow * B;
+								for (size_t il = 0; il < rows; il++)
+								{
+									const float xv = x[il];
+									for (size_t lane = 0; lane < B; lane++)
+									{
+										acc[il][lane] += xv * g[lane];
+									}
+								}
+							}
+						}
+					}
+					float* dw = kernelDiff + ((kh * shape.kernelWidth + kw) * B + il0) * B;
+					for (size_t il = 0; il < rows; il++)
+					{
+						for (size_t lane = 0; lane < B; lane++)
+						{
+							dw[il * B + lane] = acc[il][lane];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool EasyCNN::BlockedConvolver::setShape(const size_t inChannels, const size_t outChannels, const size_t kernelHeight, const size_t kernelWidth,
+	const size_t heightStep, const size_t widthStep, const DataLayout layout)
+{
+	easyAssert(layout == DataLayout::NCHW8c || layout == DataLayout::NCHW16c, "blocked convolution needs NCHW8c or NCHW16c.");
+	if (this->inChannels == inChannels && this->outChannels == outChannels && this->kernelHeight == kernelHeight &&
+		this->kernelWidth == kernelWidth && this->heightStep == heightStep && this->widthStep == widthStep && this->layout == layout)
+	{
+		return false;
+	}
+	this->inChannels = inChannels;
+	this->outChannels = outChannels;
+	this->kernelHeight = kernelHeight;
+	this->kernelWidth = kernelWidth;
+	this->heightStep = heightStep;
+	this->widthStep = widthStep;
+	this->layout = layout;
+	this->block = getChannelBlock(layout, inChannels);
+	this->inBlocks = getPaddedChannels(layout, inChannels) / block;
+	this->outBlocks = getPaddedChannels(layout, outChannels) / block;
+	blockedKernel.clear();
+	blockedKernelT.clear();
+	return true;
+}
+
+void EasyCNN::BlockedConvolver::setKernel(const float* kernel, const bool withBackward)
+{
+	const size_t blockSize = block * block;
+	const size_t taps = kernelHeight * kernelWidth;
+	blockedKernel.assign(outBlocks * inBlocks * taps * blockSize, 0.0f);
+	if (withBackward)
+	{
+		blockedKernelT.assign(inBlocks * outBlocks * taps * blockSize, 0.0f);
+	}
+	for (size_t oc = 0; oc < outChannels; oc++)
+	{
+		for (size_t ic = 0; ic < inChannels; ic++)
+		{
+			const float* src = kernel + (oc * inChannels + ic) * taps;
+			const size_t ocb = oc / block, ol = oc % block;
+			const size_t icb = ic / block, il = ic % block;
+			for (size_t tap = 0; tap < taps; tap++)
+			{
+				blockedKernel[((ocb * inBlocks + icb) * taps + tap) * blockSize + il * block + ol] = src[tap];
+				if (withBackward)
+				{
+					blockedKernelT[((icb * outBlocks + ocb) * taps + tap) * blockSize + ol * block + il] = src[tap];
+				}
+			}
+		}
+	}
+}
+
+void EasyCNN::BlockedConvolver::forward(const float* input, const DataSize inputSize, const float* bias, float* output, const DataSize outputSize,
+	ThreadPool* pool) const
+{
+	easyAssert(!blockedKernel.empty(), "blocked kernel is not set.");
+	const ConvShape shape = { inBlocks, outBlocks, inputSize.height, inputSize.width, outputSize.height, outputSize.width,
+		kernelHeight, kernelWidth, heightStep, widthStep };
+	const size_t inputStride = inBlocks * block * inputSize._2DSize();
+	const size_t outPlaneSize = outputSize._2DSize();
+	const size_t taps = kernelHeight * kernelWidth;
+	//tasks are (sample, output block, output row)
+	parallelFor(pool, outputSize.number * outBlocks * outputSize.height, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t task = begin; task < end; task++)
+		{
+			const size_t oh = task % outputSize.height;
+			const size_t ocb = task / outputSize.height % outBlocks;
+			const size_t nn = task / outputSize.height / outBlocks;
+			float* outputRow = output + ((nn * outBlocks + ocb) * outPlaneSize + oh * outputSize.width) * block;
+			for (size_t ow = 0; ow < outputSize.width; ow++)
+			{
+				for (size_t lane = 0; lane < block; lane++)
+				{
+					const size_t oc = ocb * block + lane;
+					outputRow[ow * block + lane] = (bias != nullptr && oc < outChannels) ? bias[oc] : 0.0f;
+				}
+			}
+			const float* in = input + nn * inputStride;
+			const float* weights = &blockedKernel[0] + ocb * inBlocks * taps * block * block;
+			if (block == 16)
+			{
+				forwardRow<16>(shape, in, weights, oh, outputRow);
+			}
+			else
+			{
+				forwardRow<8>(shape, in, weights, oh, outputRow);
+			}
+		}
+	});
+}
+
+void EasyCNN::BlockedConvolver::backward(const float* input, const DataSize inputSize, const float* outputDiff, const DataSize outputSize,
+	float* inputDiff, float* kernelDiff, ThreadPool* pool)
+{
+	easyAssert(!blockedKernelT.empty(), "blocked backward kernel is not set.");
+	const ConvShape shape = { inBlocks, outBlocks, inputSize.height, inputSize.width, outputSize.height, outputSize.width,
+		kernelHeight, kernelWidth, heightStep, widthStep };
+	const size_t inPlaneSize = inputSize._2DSize();
+	const size_t outPlaneSize = outputSize._2DSize();
+	const size_t inputStride = inBlocks * block * inPlaneSize;
+	const size_t outputStride = outBlocks * block * outPlaneSize;
+	const size_t taps = kernelHeight * kernelWidth;
+	const size_t blockSize = block * block;
+
+	//data gradient : every (sample, input block, input row) owns its slice of inputDiff
+	parallelFor(pool, inputSize.number * inBlocks * inputSize.height, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t task = begin; task < end; task++)
+		{
+			const size_t ih = task % inputSize.height;
+			const size_t icb = task / inputSize.height % inBlocks;
+			const size_t nn = task / inputSize.height / inBlocks;
+			float* inputDiffRow = inputDiff + nn * inputStride + (icb * inPlaneSize + ih * inputSize.width) * block;
+			const float* diff = outputDiff + nn * outputStride;
+			const float* weightsT = &blockedKernelT[0] + icb * outBlocks * taps * blockSize;
+			if (block == 16)
+			{
+				backwardDataRow<16>(shape, diff, weightsT, ih, inputDiffRow);
+			}
+			else
+			{
+				backwardDataRow<8>(shape, diff, weightsT, ih, inputDiffRow);
+			}
+		}
+	});
+
+	//kernel gradient : every (output block, input block) pair owns its slice, no reduction needed
+	blockedKernelDiff.resize(outBlocks * inBlocks * taps * blockSize);
+	parallelFor(pool, outBlocks * inBlocks, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t task = begin; task < end; task++)
+		{
+			const size_t ocb = task / inBlocks;
+			const size_t icb = task % inBlocks;
+			float* dw = &blockedKernelDiff[0] + task * taps * blockSize;
+			const float* in = input + icb * inPlaneSize * block;
+			const float* diff = outputDiff + ocb * outPlaneSize * block;
+			if (block == 16)
+			{
+				backwardKernelBlock<16>(shape, inputSize.number, in, inputStride, diff, outputStride, dw);
+			}
+			else
+			{
+				backwardKernelBlock<8>(shape, inputSize.number, in, inputStride, diff, outputStride, dw);
+			}
+			//back to (oc, ic, kh, kw)
+			for (size_t ol = 0; ol < block && ocb * block + ol < outChannels; ol++)
+			{
+				for (size_t il = 0; il < block && icb * block + il < inChannels; il++)
+				{
+					float* dst = kernelDiff + ((ocb * block + ol) * inChannels + icb * block + il) * taps;
+					for (size_t tap = 0; tap < taps; tap++)
+					{
+						dst[tap] = dw[tap * blockSize + il * block + ol];
+					}
+				}
+			}
+		}
+	});
+}
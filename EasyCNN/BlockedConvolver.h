@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	//direct convolution on channel blocked data (NCHW8c / NCHW16c).
+	//input and output blocks are block channels wide, kernels are regrouped to
+	//(outBlocks, inBlocks, kh, kw, inLane, outLane) so the inner loops are block wide multiply-adds
+	//over contiguous lanes. padding lanes of the input meet zero weights, padding lanes of the output are written as 0.
+	class BlockedConvolver
+	{
+	public:
+		BlockedConvolver() = default;
+		//returns true if the shape changed (the kernel must be set again).
+		bool setShape(const size_t inChannels, const size_t outChannels, const size_t kernelHeight, const size_t kernelWidth,
+			const size_t heightStep, const size_t widthStep, const DataLayout layout);
+		//kernel is outChannels x inChannels x kernelHeight x kernelWidth.
+		//withBackward also builds the (inBlocks, outBlocks, kh, kw, outLane, inLane) copy used for the data gradient.
+		void setKernel(const float* kernel, const bool withBackward);
+		//bias may be null.
+		void forward(const float* input, const DataSize inputSize, const float* bias, float* output, const DataSize outputSize,
+			ThreadPool* pool = nullptr) const;
+		//inputDiff in the blocked layout, kernelDiff in the plain kernel layout.
+		void backward(const float* input, const DataSize inputSize, const float* outputDiff, const DataSize outputSize,
+			float* inputDiff, float* kernelDiff, ThreadPool* pool = nullptr);
+	private:
+		size_t inChannels = 0;
+		size_t outChannels = 0;
+		size_t kernelHeight = 0;
+		size_t kernelWidth = 0;
+		size_t heightStep = 0;
+		size_t widthStep = 0;
+		DataLayout layout = DataLayout::NCHW8c;
+		size_t block = 8;
+		size_t inBlocks = 0;
+		size_t outBlocks = 0;
+		std::vector<float> blockedKernel;
+		std::vector<float> blockedKernelT;
+		std::vector<float> blockedKernelDiff;
+	};
+}
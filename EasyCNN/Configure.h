@@ -1,3 +1,5 @@
 #pragma once
 
-#define WITH_OPENCV_DEBUG 0
\ No newline at end of file
+#define WITH_OPENCV_DEBUG 0
+//link a system cblas (OpenBLAS / BLIS / MKL) and offer it as the "cblas" blas backend
+#define WITH_CBLAS 0
@@ -1,6 +1,8 @@
 #include <sstream>
 #include "ConvolutionLayer.h"
 #include "CommonTools.h"
+#include "Blas.h"
+#include "Im2Col.h"
 
 #if WITH_OPENCV_DEBUG
 #include "opencv2/opencv.hpp"
@@ -28,14 +30,185 @@ void EasyCNN::ConvolutionLayer::setParamaters(const ParamSize _kernelSize, const
 	enabledBias = _enabledBias;
 }
 
+void EasyCNN::ConvolutionLayer::setAlgorithm(const ConvolutionAlgorithm _algorithm)
+{
+	algorithm = _algorithm;
+	transformedKernelReady = false;
+}
+
+EasyCNN::ConvolutionLayer::ConvolutionAlgorithm EasyCNN::ConvolutionLayer::resolveAlgorithm() const
+{
+	//the layout was chosen from getPreferredLayout, blocked data can only take the blocked path
+	const DataLayout layout = getDataLayout();
+	if (layout == DataLayout::NCHW8c || layout == DataLayout::NCHW16c)
+	{
+		easyAssert(algorithm == AutoConvolution || algorithm == BlockedConvolution, "blocked layout needs blocked convolution.");
+		return BlockedConvolution;
+	}
+	easyAssert(layout == DataLayout::NCHW, "data layout is invalidate.");
+	const bool winogradCapable = kernelSize.width == 3 && kernelSize.height == 3 && widthStep == 1 && heightStep == 1;
+	if (algorithm == WinogradConvolution)
+	{
+		easyAssert(winogradCapable, "winograd needs 3x3 kernel with step 1.");
+		return WinogradConvolution;
+	}
+	if (algorithm == FFTConvolution)
+	{
+		easyAssert(widthStep == 1 && heightStep == 1, "fft convolution needs step 1.");
+		return FFTConvolution;
+	}
+	if (algorithm == AutoConvolution)
+	{
+		//with few channels the tile transforms cost more than the saved multiplies
+		if (winogradCapable && kernelSize.number >= 16 && kernelSize.channels >= 16)
+		{
+			return WinogradConvolution;
+		}
+		//the frequency domain cost does not grow with the kernel, gemm does
+		const DataSize inputSize = getInputBucketSize();
+		if (widthStep == 1 && heightStep == 1 && kernelSize.width >= 7 && kernelSize.height >= 7 &&
+			inputSize.width >= 64 && inputSize.height >= 64)
+		{
+			return FFTConvolution;
+		}
+	}
+	return GemmConvolution;
+}
+
+EasyCNN::DataLayout EasyCNN::ConvolutionLayer::getPreferredLayout(const DataLayout prevLayout) const
+{
+	//outside a network (or asked for another algorithm) the layer stays NCHW
+	//strided kernels gather their data gradient pixel by pixel, gemm stays ahead there
+	const bool blockedCapable = kernelSize.channels >= 8 && kernelSize.number >= 8 && widthStep == 1 && heightStep == 1;
+	if (algorithm == BlockedConvolution || (algorithm == AutoConvolution && blockedCapable && resolveAlgorithm() == GemmConvolution))
+	{
+		//keep an upstream blocking, else as wide as the channels fill
+		if (prevLayout == DataLayout::NCHW8c || prevLayout == DataLayout::NCHW16c)
+		{
+			return prevLayout;
+		}
+		return (kernelSize.channels >= 16 && kernelSize.number >= 16) ? DataLayout::NCHW16c : DataLayout::NCHW8c;
+	}
+	return DataLayout::NCHW;
+}
+
+std::shared_ptr<EasyCNN::LayerWorkspace> EasyCNN::ConvolutionLayer::createWorkspace() const
+{
+	return std::make_shared<Workspace>();
+}
+
+void EasyCNN::ConvolutionLayer::im2colBatch(const float* prevData, const DataSize prevDataSize, const DataSize nextDataSize, Workspace& workspace, ThreadPool* pool) const
+{
+	//lower the whole batch to one matrix : (kc*kh*kw) x (number*nh*nw)
+	const size_t colRows = kernelSize._3DSize();
+	const size_t outPlaneSize = nextDataSize._2DSize();
+	const size_t colCols = nextDataSize.number * outPlaneSize;
+	std::vector<float>& colBuffer = workspace.colBuffer;
+	colBuffer.resize(colRows * colCols);
+	workspace.gemmBuffer.resize(kernelSize.number * colCols);
+	parallelFor(pool, nextDataSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t nn = begin; nn < end; nn++)
+		{
+			im2col(prevData + nn * prevDataSize._3DSize(), prevDataSize.channels, prevDataSize.height, prevDataSize.width,
+				kernelSize.height, kernelSize.width, heightStep, widthStep,
+				nextDataSize.height, nextDataSize.width, &colBuffer[0] + nn * outPlaneSize, colCols);
+		}
+	});
+}
+
+size_t EasyCNN::ConvolutionLayer::getWinogradTileSize(const DataSize nextDataSize)
+{
+	//F(4x4,3x3) once the output holds a few 4x4 tiles, F(2x2,3x3) below that
+	return (nextDataSize.width >= 8 && nextDataSize.height >= 8) ? 4 : 2;
+}
+
+void EasyCNN::ConvolutionLayer::prepareWinograd(const DataSize nextDataSize)
+{
+	const size_t tileSize = getWinogradTileSize(nextDataSize);
+	if (winogradForward.getTileSize() != tileSize)
+	{
+		winogradForward = Winograd3x3(tileSize);
+		winogradBackward = Winograd3x3(tileSize);
+		transformedKernelReady = false;
+	}
+	//transforms built in test phase lack backward's
+	if (getPhase() == Phase::Train && !transformedKernelBackward)
+	{
+		transformedKernelReady = false;
+	}
+	if (!transformedKernelReady)
+	{
+		const float* kernel = kernelData->getData().get();
+		winogradForward.setKernel(kernel, kernelSize.number, kernelSize.channels, false);
+		if (getPhase() == Phase::Train)
+		{
+			winogradBackward.setKernel(kernel, kernelSize.number, kernelSize.channels, true);
+		}
+		transformedKernelReady = true;
+		transformedKernelBackward = getPhase() == Phase::Train;
+	}
+}
+
+void EasyCNN::ConvolutionLayer::prepareFFT(const DataSize prevDataSize)
+{
+	if (fftConvolver.setShape(kernelSize.channels, kernelSize.number, prevDataSize.height, prevDataSize.width,
+		kernelSize.height, kernelSize.width))
+	{
+		transformedKernelReady = false;
+	}
+	if (!transformedKernelReady)
+	{
+		fftConvolver.setKernel(kernelData->getData().get());
+		transformedKernelReady = true;
+	}
+}
+
+void EasyCNN::ConvolutionLayer::prepareBlocked()
+{
+	if (blockedConvolver.setShape(kernelSize.channels, kernelSize.number, kernelSize.height, kernelSize.width,
+		heightStep, widthStep, getDataLayout()))
+	{
+		transformedKernelReady = false;
+	}
+	//transforms built in test phase lack backward's
+	if (getPhase() == Phase::Train && !transformedKernelBackward)
+	{
+		transformedKernelReady = false;
+	}
+	if (!transformedKernelReady)
+	{
+		blockedConvolver.setKernel(kernelData->getData().get(), getPhase() == Phase::Train);
+		transformedKernelReady = true;
+		transformedKernelBackward = getPhase() == Phase::Train;
+	}
+}
+
+void EasyCNN::ConvolutionLayer::prepareForward()
+{
+	//the shapes the transforms are planned for are the ones solveInnerParams worked out
+	switch (resolveAlgorithm())
+	{
+	case BlockedConvolution:
+		prepareBlocked();
+		break;
+	case WinogradConvolution:
+		prepareWinograd(getOutputBucketSize());
+		break;
+	case FFTConvolution:
+		prepareFFT(getInputBucketSize());
+		break;
+	default:
+		break;
+	}
+}
+
 std::string EasyCNN::ConvolutionLayer::serializeToString() const
 {
 	const std::string spliter = " ";
 	std::stringstream ss;
 	//layer desc
-	ss << getLayerType() << spliter
-		<< kernelSize.number << spliter << kernelSize.channels << spliter << kernelSize.width << spliter << kernelSize.height << spliter
-		<< widthStep << spliter << heightStep << spliter << enabledBias << spliter;
+	writeDesc(ss);
 	//weight
 	const auto kernel = kernelData->getData().get();
 	for (size_t i = 0; i < kernelSize._4DSize(); i++)
@@ -59,12 +232,9 @@ void EasyCNN::ConvolutionLayer::serializeFromString(const std::string content)
 {
 	std::stringstream ss(content);
 	//layer desc
-	std::string _layerType;
-	ss >> _layerType
-		>> kernelSize.number >> kernelSize.channels >> kernelSize.width >> kernelSize.height
-		>> widthStep >> heightStep >> enabledBias;
-	easyAssert(_layerType == layerType, "layer type is invalidate.");
+	readDesc(ss);
 	solveInnerParams();
+	transformedKernelReady = false;
 	//weight
 	auto kernel = kernelData->getData().get();
 	for (size_t i = 0; i < kernelSize._4DSize(); i++)
@@ -83,13 +253,82 @@ void EasyCNN::ConvolutionLayer::serializeFromString(const std::string content)
 	}
 }
 
+std::string EasyCNN::ConvolutionLayer::serializeDescToString() const
+{
+	const std::string spliter = " ";
+	std::stringstream ss;
+	writeDesc(ss);
+	//the binary model's desc also keeps the algorithm, a loaded or replicated layer computes as the original
+	ss << (int)algorithm << spliter;
+	return ss.str();
+}
+
+void EasyCNN::ConvolutionLayer::serializeDescFromString(const std::string content)
+{
+	std::stringstream ss(content);
+	readDesc(ss);
+	//descs saved before it was recorded have no algorithm, the layer keeps its own
+	int _algorithm = AutoConvolution;
+	if (ss >> _algorithm)
+	{
+		easyAssert(_algorithm >= AutoConvolution && _algorithm <= BlockedConvolution, "convolution algorithm is invalidate.");
+		setAlgorithm((ConvolutionAlgorithm)_algorithm);
+	}
+}
+
+void EasyCNN::ConvolutionLayer::writeDesc(std::ostream& os) const
+{
+	const std::string spliter = " ";
+	os << getLayerType() << spliter
+		<< kernelSize.number << spliter << kernelSize.channels << spliter << kernelSize.width << spliter << kernelSize.height << spliter
+		<< widthStep << spliter << heightStep << spliter << enabledBias << spliter;
+}
+
+void EasyCNN::ConvolutionLayer::readDesc(std::istream& is)
+{
+	std::string _layerType;
+	is >> _layerType
+		>> kernelSize.number >> kernelSize.channels >> kernelSize.width >> kernelSize.height
+		>> widthStep >> heightStep >> enabledBias;
+	easyAssert(_layerType == layerType, "layer type is invalidate.");
+}
+
+std::vector<std::shared_ptr<EasyCNN::ParamBucket>> EasyCNN::ConvolutionLayer::getParamBuckets() const
+{
+	std::vector<std::shared_ptr<ParamBucket>> buckets;
+	buckets.push_back(kernelData);
+	if (enabledBias)
+	{
+		buckets.push_back(biasData);
+	}
+	return buckets;
+}
+
+void EasyCNN::ConvolutionLayer::setParamBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets)
+{
+	easyAssert(buckets.size() == (enabledBias ? 2 : 1), "param bucket count is invalidate.");
+	kernelData = buckets[0];
+	biasData = enabledBias ? buckets[1] : nullptr;
+	transformedKernelReady = false;
+}
+
 DEFINE_LAYER_TYPE(EasyCNN::ConvolutionLayer, "ConvolutionLayer");
 
-std::string EasyCNN::ConvolutionLayer::getLayerType() const
+const std::string& EasyCNN::ConvolutionLayer::getLayerType() const
 {
 	return layerType;
 }
 
+std::vector<EasyCNN::ParamSize> EasyCNN::ConvolutionLayer::getGradientSizes() const
+{
+	std::vector<ParamSize> sizes(1, kernelSize);
+	if (enabledBias)
+	{
+		sizes.push_back(ParamSize(kernelSize.number, 1, 1, 1));
+	}
+	return sizes;
+}
+
 void EasyCNN::ConvolutionLayer::solveInnerParams()
 {
 	const DataSize inputSize = getInputBucketSize();
@@ -109,6 +348,7 @@ void EasyCNN::ConvolutionLayer::solveInnerParams()
 		kernelData.reset(new ParamBucket(kernelSize));
 		normal_distribution_init(kernelData->getData().get(), kernelData->getSize()._4DSize(), 0.0f, 0.1f);
 	}
+	easyAssert(kernelData->getSize() == kernelSize, "kernel param size is invalidate.");
 	if (enabledBias)
 	{
 		if (biasData.get() == nullptr)
@@ -116,56 +356,99 @@ void EasyCNN::ConvolutionLayer::solveInnerParams()
 			biasData.reset(new ParamBucket(ParamSize(kernelSize.number, 1, 1, 1)));
 			const_distribution_init(biasData->getData().get(), biasData->getSize()._4DSize(), 0.0f);
 		}
+		easyAssert(biasData->getSize() == ParamSize(kernelSize.number, 1, 1, 1), "bias param size is invalidate.");
 	}
 }
 //ǰ򴫲
-void EasyCNN::ConvolutionLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::ConvolutionLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 
 	const float* prevRawData = prevDataBucket->getData().get();
 	const float* kernelRawData = kernelData->getData().get();
-	const float* biasRawData = biasData->getData().get();
+	const float* biasRawData = enabledBias ? biasData->getData().get() : nullptr;
 	float* nextRawData = nextDataBucket->getData().get();
 
-	// four loop for convolution
-	for (size_t nn = 0; nn < nextDataSize.number; nn++) // number
+	const ConvolutionAlgorithm usedAlgorithm = resolveAlgorithm();
+	Workspace& forwardWorkspace = *static_cast<Workspace*>(workspace);
+	easyAssert(prevDataBucket->getLayout() == getDataLayout() && nextDataBucket->getLayout() == getDataLayout(), "data layout is invalidate.");
+	easyAssert(usedAlgorithm == GemmConvolution || transformedKernelReady, "prepareForward must run after the kernel changed.");
+	if (usedAlgorithm == BlockedConvolution)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++) // channels
+		//bias is added in place of the output's initial zero
+		blockedConvolver.forward(prevRawData, prevDataSize, biasRawData, nextRawData, nextDataSize, pool);
+		return;
+	}
+	if (usedAlgorithm == WinogradConvolution || usedAlgorithm == FFTConvolution)
+	{
+		if (usedAlgorithm == WinogradConvolution)
+		{
+			easyAssert(winogradForward.getTileSize() == getWinogradTileSize(nextDataSize), "winograd is prepared for another output size.");
+			winogradForward.forward(prevRawData, prevDataSize.number, prevDataSize.height, prevDataSize.width, 0, nextRawData, forwardWorkspace.winograd, pool);
+		}
+		else
+		{
+			fftConvolver.forward(prevRawData, prevDataSize.number, nextRawData, forwardWorkspace.fft, pool);
+		}
+		if (enabledBias)
 		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++) // height
+			parallelFor(pool, nextDataSize.number * nextDataSize.channels, [&](const size_t begin, const size_t end, const size_t threadIdx)
 			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++) // width
+				for (size_t plane = begin; plane < end; plane++)
 				{
-					const size_t inStartX = nw * widthStep;
-					const size_t inStartY = nh * heightStep;
-					float sum = 0;
-
-					for (size_t kc = 0; kc < kernelSize.channels; kc++)
+					const float bias = biasRawData[plane % nextDataSize.channels];
+					float* dst = nextRawData + plane * nextDataSize._2DSize();
+					for (size_t i = 0; i < nextDataSize._2DSize(); i++)
 					{
-						for (size_t kh = 0; kh < kernelSize.height; kh++)
-						{
-							for (size_t kw = 0; kw < kernelSize.width; kw++)
-							{
-								const size_t prevDataIdx = prevDataSize.getIndex(nn, kc, inStartY + kh, inStartX + kw);
-								const size_t kernelIdx = kernelSize.getIndex(nc, kc, kh, kw);
-
-								sum += prevRawData[prevDataIdx] * kernelRawData[kernelIdx];
-							}
-						}
+						dst[i] += bias;
 					}
-					if (enabledBias)
+				}
+			});
+		}
+		return;
+	}
+
+	const size_t colRows = kernelSize._3DSize();
+	const size_t outPlaneSize = nextDataSize._2DSize();
+	const size_t colCols = nextDataSize.number * outPlaneSize;
+	im2colBatch(prevRawData, prevDataSize, nextDataSize, forwardWorkspace, pool);
+	const std::vector<float>& colBuffer = forwardWorkspace.colBuffer;
+	std::vector<float>& gemmBuffer = forwardWorkspace.gemmBuffer;
+
+	//kernel(kn x kc*kh*kw) * col, split in batch x output channel tiles
+	const size_t threadCount = getThreadCount(pool);
+	const size_t batchTiles = std::min(nextDataSize.number, threadCount);
+	const size_t channelTiles = std::max<size_t>(1, std::min((threadCount + batchTiles - 1) / batchTiles, kernelSize.number / 8));
+	parallelFor(pool, batchTiles * channelTiles, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+		{
+			const size_t nBegin = nextDataSize.number * (tile / channelTiles) / batchTiles;
+			const size_t nEnd = nextDataSize.number * (tile / channelTiles + 1) / batchTiles;
+			const size_t cBegin = kernelSize.number * (tile % channelTiles) / channelTiles;
+			const size_t cEnd = kernelSize.number * (tile % channelTiles + 1) / channelTiles;
+			getBlas().gemm(false, false, cEnd - cBegin, (nEnd - nBegin) * outPlaneSize, colRows,
+				1.0f, kernelRawData + cBegin * colRows, colRows, &colBuffer[0] + nBegin * outPlaneSize, colCols,
+				0.0f, &gemmBuffer[0] + cBegin * colCols + nBegin * outPlaneSize, colCols);
+
+			//scatter back to NCHW and add bias
+			for (size_t nn = nBegin; nn < nEnd; nn++)
+			{
+				for (size_t nc = cBegin; nc < cEnd; nc++)
+				{
+					const float* src = &gemmBuffer[0] + nc * colCols + nn * outPlaneSize;
+					float* dst = nextRawData + nextDataSize.getIndex(nn, nc, 0, 0);
+					const float bias = enabledBias ? biasRawData[nc] : 0.0f;
+					for (size_t i = 0; i < outPlaneSize; i++)
 					{
-						const size_t biasIdx = nc;
-						sum += biasRawData[biasIdx];
+						dst[i] = src[i] + bias;
 					}
-					const size_t nextDataIdx = nextDataSize.getIndex(nn, nc, nh, nw);
-					nextRawData[nextDataIdx] = sum;
 				}
 			}
 		}
-	}
+	});
 }
 
 void EasyCNN::ConvolutionLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
@@ -174,118 +457,145 @@ void EasyCNN::ConvolutionLayer::backward(std::shared_ptr<DataBucket> prevDataBuc
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 	const DataSize nextDiffSize = nextDiffBucket->getSize();
-	const ParamSize biasSize = biasData->getSize();
-	const float* prevData = prevDataBucket->getData().get();
-	const float* nextData = nextDataBucket->getData().get();
 	const float* nextDiff = nextDiffBucket->getData().get();
-	float *kernel = kernelData->getData().get();
-	float *bias = biasData->getData().get();
+	const float *kernel = kernelData->getData().get();
+	const ConvolutionAlgorithm usedAlgorithm = resolveAlgorithm();
+	const DataLayout layout = getDataLayout();
+	easyAssert(nextDiffBucket->getLayout() == layout, "diff layout is invalidate.");
 
-	//update prevDiff data
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
+	//prevDiff and params' diff buckets come from the network's arenas
+	const std::shared_ptr<DataBucket> prevDiffBucket = getDiffBucket(prevDataSize, layout);
 	float* prevDiff = prevDiffBucket->getData().get();
+	float* kernelDiff = getGradientBucket(0)->getData().get();
+	Workspace& ownWorkspace = *static_cast<Workspace*>(getWorkspace());
 
-	//calculate current inner diff
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	if (usedAlgorithm == BlockedConvolution)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		prepareBlocked();
+		blockedConvolver.backward(prevDataBucket->getData().get(), prevDataSize, nextDiff, nextDiffSize, prevDiff, kernelDiff, getThreadPool());
+	}
+	else if (usedAlgorithm == FFTConvolution)
+	{
+		//both gradients from the spectra, the input spectra are still cached from forward
+		prepareFFT(prevDataSize);
+		fftConvolver.backward(nextDiff, nextDiffSize.number, prevDiff, kernelDiff, ownWorkspace.fft, getThreadPool());
+	}
+	else
+	{
+		const size_t colRows = kernelSize._3DSize();
+		const size_t outPlaneSize = nextDiffSize._2DSize();
+		const size_t colCols = nextDiffSize.number * outPlaneSize;
+		std::vector<float>& colBuffer = ownWorkspace.colBuffer;
+		std::vector<float>& gemmBuffer = ownWorkspace.gemmBuffer;
+		if (usedAlgorithm == GemmConvolution)
+		{
+			//colBuffer still holds im2col(prevData) from the forward pass of this batch
+			easyAssert(colBuffer.size() == colRows * colCols && gemmBuffer.size() == kernelSize.number * colCols,
+				"backward must follow forward of the same batch.");
+		}
+		else
+		{
+			im2colBatch(prevDataBucket->getData().get(), prevDataSize, nextDataSize, ownWorkspace, getThreadPool());
+		}
+
+		ThreadPool* pool = getThreadPool();
+		const size_t batchTiles = std::min(nextDiffSize.number, getThreadCount(pool));
+		//gather nextDiff to the same (kn x number*nh*nw) layout as the forward result
+		float* diffMatrix = &gemmBuffer[0];
+		parallelFor(pool, nextDiffSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
 		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++)
+			for (size_t nn = begin; nn < end; nn++)
 			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
+				for (size_t nc = 0; nc < nextDiffSize.channels; nc++)
 				{
-					const size_t inStartX = nw * widthStep;
-					const size_t inStartY = nh * heightStep;
-					const size_t nextDiffIdx = nextDataSize.getIndex(pn, nc, nh, nw);
-					const size_t kn = nc;
-					for (size_t kc = 0; kc < kernelSize.channels; kc++)
-					{
-						for (size_t kh = 0; kh < kernelSize.height; kh++)
-						{
-							for (size_t kw = 0; kw < kernelSize.width; kw++)
-							{
-								const size_t prevDiffIdx = prevDiffSize.getIndex(pn, kc, inStartY + kh, inStartX + kw);
-								const size_t kernelIdx = kernelSize.getIndex(kn, kc, kh, kw);
-								prevDiff[prevDiffIdx] += kernel[kernelIdx] * nextDiff[nextDiffIdx];
-							}
-						}
-					}
+					const float* src = nextDiff + nextDiffSize.getIndex(nn, nc, 0, 0);
+					float* dst = diffMatrix + nc * colCols + nn * outPlaneSize;
+					std::copy(src, src + outPlaneSize, dst);
 				}
 			}
-		}
-	}
+		});
 
-	//update this layer's param
-	const ParamSize kernelDiffSize(kernelSize);
-	std::shared_ptr<ParamBucket> kernelDiffBucket(std::make_shared<ParamBucket>(kernelDiffSize));
-	kernelDiffBucket->fillData(0.0f);
-	float* kernelDiff = kernelDiffBucket->getData().get();
+		//kernelDiff = nextDiff * col', every batch tile accumulates into its thread's buffer
+		prepareThreadBuffers(pool, threadKernelDiffs, kernelSize._4DSize());
+		parallelFor(pool, batchTiles, [&](const size_t begin, const size_t end, const size_t threadIdx)
+		{
+			for (size_t tile = begin; tile < end; tile++)
+			{
+				const size_t nBegin = nextDiffSize.number * tile / batchTiles;
+				const size_t nEnd = nextDiffSize.number * (tile + 1) / batchTiles;
+				getBlas().gemm(false, true, kernelSize.number, colRows, (nEnd - nBegin) * outPlaneSize,
+					1.0f, diffMatrix + nBegin * outPlaneSize, colCols, &colBuffer[0] + nBegin * outPlaneSize, colCols,
+					1.0f, &threadKernelDiffs[threadIdx][0], colRows);
+			}
+		});
+		reduceThreadBuffers(pool, threadKernelDiffs, kernelDiff);
 
-	//update kernel
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
-	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		if (usedAlgorithm == WinogradConvolution)
+		{
+			//prevDiff = nextDiff padded by 2 (*) rot180(kernel)
+			prepareWinograd(nextDataSize);
+			winogradBackward.forward(nextDiff, nextDiffSize.number, nextDiffSize.height, nextDiffSize.width, 2, prevDiff, ownWorkspace.winograd, getThreadPool());
+		}
+		else
 		{
-			for (size_t nh = 0; nh < nextDataSize.height; nh++)
+			//colDiff = kernel' * nextDiff, written over colBuffer which is not needed anymore,
+			//then folded back to prevDiff, batch tiles touch disjoint columns and images
+			float* colDiff = &colBuffer[0];
+			parallelFor(pool, batchTiles, [&](const size_t begin, const size_t end, const size_t threadIdx)
 			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
+				for (size_t tile = begin; tile < end; tile++)
 				{
-					const size_t inStartX = nw * widthStep;
-					const size_t inStartY = nh*heightStep;
-					const size_t nextDiffIdx = nextDataSize.getIndex(pn, nc, nh, nw);
-					const size_t kn = nc;
-					for (size_t kc = 0; kc < kernelSize.channels; kc++)
+					const size_t nBegin = nextDiffSize.number * tile / batchTiles;
+					const size_t nEnd = nextDiffSize.number * (tile + 1) / batchTiles;
+					getBlas().gemm(true, false, colRows, (nEnd - nBegin) * outPlaneSize, kernelSize.number,
+						1.0f, kernel, colRows, diffMatrix + nBegin * outPlaneSize, colCols,
+						0.0f, colDiff + nBegin * outPlaneSize, colCols);
+					std::fill(prevDiff + nBegin * prevDataSize._3DSize(), prevDiff + nEnd * prevDataSize._3DSize(), 0.0f);
+					for (size_t pn = nBegin; pn < nEnd; pn++)
 					{
-						for (size_t kh = 0; kh < kernelSize.height; kh++)
-						{
-							for (size_t kw = 0; kw < kernelSize.width; kw++)
-							{
-								const size_t kernelDiffIdx = kernelDiffSize.getIndex(kn, kc, kh, kw);
-								const size_t prevDataIdx = prevDataSize.getIndex(pn, kc, inStartY + kh, inStartX + kw);
-								kernelDiff[kernelDiffIdx] += prevData[prevDataIdx] * nextDiff[nextDiffIdx];
-							}
-						}
+						col2im(colDiff + pn * outPlaneSize, colCols, prevDataSize.channels, prevDataSize.height, prevDataSize.width,
+							kernelSize.height, kernelSize.width, heightStep, widthStep,
+							nextDiffSize.height, nextDiffSize.width, prevDiff + pn * prevDataSize._3DSize());
 					}
 				}
-			}
+			});
 		}
 	}
 
-	//apply change
-	for (size_t kernelIdx = 0; kernelIdx < kernelSize._4DSize(); kernelIdx++)
-	{
-		kernel[kernelIdx] -= getLearningRate() * kernelDiff[kernelIdx] / nextDataSize.number;
-	}
-
-	//update bias
-	const ParamSize biasDiffSize(biasSize);
-	std::shared_ptr<ParamBucket> biasDiffBucket(std::make_shared<ParamBucket>(biasDiffSize));
-	biasDiffBucket->fillData(0.0f);
-	float* biasDiff = biasDiffBucket->getData().get();
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	//bias diff
+	if (enabledBias)
 	{
-		for (size_t nc = 0; nc < nextDiffSize.channels; nc++)
+		const ParamSize biasSize = biasData->getSize();
+		float* biasDiff = getGradientBucket(1)->getData().get();
+		ThreadPool* pool = getThreadPool();
+		//a channel's plane is strided by its block's width, 1 for NCHW
+		const size_t block = getChannelBlock(layout, nextDiffSize.channels);
+		prepareThreadBuffers(pool, threadBiasDiffs, biasSize._4DSize());
+		parallelFor(pool, nextDiffSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
 		{
-			const size_t biasDiffIdx = nc;
-			for (size_t nh = 0; nh < nextDiffSize.height; nh++)
+			float* localDiff = &threadBiasDiffs[threadIdx][0];
+			for (size_t nn = begin; nn < end; nn++)
 			{
-				for (size_t nw = 0; nw < nextDiffSize.width; nw++)
+				for (size_t nc = 0; nc < nextDiffSize.channels; nc++)
 				{
-					const size_t nextDiffIdx = nextDiffSize.getIndex(pn, nc, nh, nw);
-					biasDiff[biasDiffIdx] += 1.0f * nextDiff[nextDiffIdx];
+					const float* plane = nextDiff + getLayoutIndex(nextDiffSize, layout, nn, nc, 0, 0);
+					float sum = 0.0f;
+					for (size_t i = 0; i < nextDiffSize._2DSize(); i++)
+					{
+						sum += plane[i * block];
+					}
+					localDiff[nc] += sum;
 				}
 			}
-		}
-	}
-
-	//apply change
-	for (size_t biasIdx = 0; biasIdx < biasSize._4DSize(); biasIdx++)
-	{
-		bias[biasIdx] -= getLearningRate() * biasDiff[biasIdx] / nextDataSize.number;
+		});
+		reduceThreadBuffers(pool, threadBiasDiffs, biasDiff);
 	}
 
 	//////////////////////////////////////////////////////////////////////////
 	nextDiffBucket = prevDiffBucket;
+}
+
+void EasyCNN::ConvolutionLayer::onParamsChanged()
+{
+	transformedKernelReady = false;
 }
\ No newline at end of file
@@ -1,24 +1,71 @@
 #pragma once
+#include <iosfwd>
+#include <vector>
 #include "Configure.h"
 #include "Layer.h"
+#include "Winograd.h"
+#include "FFTConvolver.h"
+#include "BlockedConvolver.h"
 
 namespace EasyCNN
 {
 	class ConvolutionLayer : public Layer
 	{
 		FRIEND_WITH_NETWORK
+	public:
+		enum ConvolutionAlgorithm
+		{
+			//winograd for 3x3 stride 1 kernels with 16+ input and output channels,
+			//fft for 7x7+ stride 1 kernels on 64x64+ inputs, blocked for stride 1 with 8+ input and output channels, gemm otherwise
+			AutoConvolution = 0,
+			GemmConvolution = 1,
+			WinogradConvolution = 2,
+			FFTConvolution = 3,
+			//direct convolution on NCHW8c / NCHW16c data, the network reorders around it
+			BlockedConvolution = 4
+		};
 	public:
 		ConvolutionLayer();
 		virtual ~ConvolutionLayer();
 		void setParamaters(const ParamSize _kernelSize, const size_t _widthStep, const size_t _heightStep, const bool _enabledBias);
+		void setAlgorithm(const ConvolutionAlgorithm _algorithm);
 	protected:
 		virtual std::string serializeToString() const override;
 		virtual void serializeFromString(const std::string content) override;
+		virtual std::string serializeDescToString() const override;
+		virtual void serializeDescFromString(const std::string content) override;
+		virtual std::vector<std::shared_ptr<ParamBucket>> getParamBuckets() const override;
+		virtual void setParamBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets) override;
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
+		virtual const std::string& getLayerType() const override;
 		virtual void solveInnerParams() override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual std::vector<ParamSize> getGradientSizes() const override;
+		virtual DataLayout getPreferredLayout(const DataLayout prevLayout) const override;
+		virtual void prepareForward() override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
+		virtual void onParamsChanged() override;
+	private:
+		//scratch buffers, kept between batches. backward reads the im2col / spectra of the forward before it
+		struct Workspace : public LayerWorkspace
+		{
+			std::vector<float> colBuffer;
+			std::vector<float> gemmBuffer;
+			Winograd3x3::Workspace winograd;
+			FFTConvolver::Workspace fft;
+		};
+		virtual std::shared_ptr<LayerWorkspace> createWorkspace() const override;
+		//layer desc, shared by the text and the binary model
+		void writeDesc(std::ostream& os) const;
+		void readDesc(std::istream& is);
+		ConvolutionAlgorithm resolveAlgorithm() const;
+		void im2colBatch(const float* prevData, const DataSize prevDataSize, const DataSize nextDataSize, Workspace& workspace, ThreadPool* pool) const;
+		//winograd's tile size for an output size
+		static size_t getWinogradTileSize(const DataSize nextDataSize);
+		void prepareWinograd(const DataSize nextDataSize);
+		void prepareFFT(const DataSize prevDataSize);
+		void prepareBlocked();
 	private:
 		ParamSize kernelSize;
 		size_t widthStep = 0;
@@ -26,5 +73,17 @@ namespace EasyCNN
 		std::shared_ptr<ParamBucket> kernelData;
 		bool enabledBias = false;
 		std::shared_ptr<ParamBucket> biasData;
+		ConvolutionAlgorithm algorithm = AutoConvolution;
+		//winograd / fft / blocked transformed kernels, rebuilt after every kernel change
+		Winograd3x3 winogradForward;
+		Winograd3x3 winogradBackward;
+		FFTConvolver fftConvolver;
+		BlockedConvolver blockedConvolver;
+		bool transformedKernelReady = false;
+		//winograd / blocked transforms include backward's, only built in train phase
+		bool transformedKernelBackward = false;
+		//per thread partial gradients
+		std::vector<std::vector<float>> threadKernelDiffs;
+		std::vector<std::vector<float>> threadBiasDiffs;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EASYCNN_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef EASYCNN_X86
+static void cpuid(const int leaf, const int subLeaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4] = { 0 };
+	__cpuidex(info, leaf, subLeaf);
+	for (int i = 0; i < 4; i++)
+	{
+		regs[i] = (unsigned int)info[i];
+	}
+#else
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//XCR0 : register state the OS saves on context switches
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax = 0, edx = 0;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+static EasyCNN::CpuFeatures detectCpuFeatures()
+{
+	EasyCNN::CpuFeatures features;
+#ifdef EASYCNN_X86
+	unsigned int regs[4] = { 0 };
+	cpuid(0, 0, regs);
+	const unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1)
+	{
+		return features;
+	}
+	cpuid(1, 0, regs);
+	const unsigned int ecx1 = regs[2];
+	features.sse41 = (ecx1 & (1u << 19)) != 0;
+	const bool osxsave = (ecx1 & (1u << 27)) != 0;
+	const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+	//xmm | ymm
+	const bool osAvx = (xcr0 & 0x6) == 0x6;
+	//opmask | zmm0-15 upper | zmm16-31
+	const bool osAvx512 = osAvx && (xcr0 & 0xe0) == 0xe0;
+	features.avx = osAvx && (ecx1 & (1u << 28)) != 0;
+	features.fma = features.avx && (ecx1 & (1u << 12)) != 0;
+	if (maxLeaf >= 7)
+	{
+		cpuid(7, 0, regs);
+		const unsigned int ebx7 = regs[1];
+		features.avx2 = features.avx && (ebx7 & (1u << 5)) != 0;
+		features.avx512f = osAvx512 && (ebx7 & (1u << 16)) != 0;
+	}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	//advanced simd is mandatory on aarch64
+	features.neon = true;
+#endif
+	return features;
+}
+
+const EasyCNN::CpuFeatures& EasyCNN::getCpuFeatures()
+{
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
+
+bool EasyCNN::isCpuIsaSupported(const CpuIsa isa)
+{
+	const CpuFeatures& features = getCpuFeatures();
+	switch (isa)
+	{
+	case CpuIsa::Generic:
+		return true;
+	case CpuIsa::SSE4:
+		return features.sse41;
+	case CpuIsa::AVX2:
+		return features.avx2 && features.fma;
+	case CpuIsa::AVX512:
+		return features.avx512f && features.avx2 && features.fma;
+	case CpuIsa::NEON:
+		return features.neon;
+	default:
+		return false;
+	}
+}
+
+EasyCNN::CpuIsa EasyCNN::getBestCpuIsa()
+{
+	const CpuIsa candidates[] = { CpuIsa::AVX512, CpuIsa::AVX2, CpuIsa::SSE4, CpuIsa::NEON };
+	for (const CpuIsa isa : candidates)
+	{
+		if (isCpuIsaSupported(isa))
+		{
+			return isa;
+		}
+	}
+	return CpuIsa::Generic;
+}
+
+const char* EasyCNN::getCpuIsaName(const CpuIsa isa)
+{
+	switch (isa)
+	{
+	case CpuIsa::SSE4:
+		return "sse4";
+	case CpuIsa::AVX2:
+		return "avx2";
+	case CpuIsa::AVX512:
+		return "avx512";
+	case CpuIsa::NEON:
+		return "neon";
+	default:
+		return "generic";
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//instruction sets the kernels are built for, ordered by preference on each architecture.
+	enum class CpuIsa
+	{
+		Generic = 0,
+		SSE4 = 1,
+		AVX2 = 2,
+		AVX512 = 3,
+		NEON = 4
+	};
+
+	struct CpuFeatures
+	{
+		bool sse41 = false;
+		//avx needs the OS to save ymm state, checked through xgetbv
+		bool avx = false;
+		bool fma = false;
+		bool avx2 = false;
+		//avx512 needs the OS to save zmm state too
+		bool avx512f = false;
+		bool neon = false;
+	};
+
+	//detected once, on first use
+	const CpuFeatures& getCpuFeatures();
+	//best isa the host supports
+	CpuIsa getBestCpuIsa();
+	bool isCpuIsaSupported(const CpuIsa isa);
+	const char* getCpuIsaName(const CpuIsa isa);
+}
@@ -1,8 +1,68 @@
 #include <algorithm>
 #include "DataBucket.h"
 
-EasyCNN::DataBucket::DataBucket(const DataSize _size):size(_size),data(new float[size._4DSize()])
+const char* EasyCNN::getLayoutName(const DataLayout layout)
 {
+	switch (layout)
+	{
+	case DataLayout::NHWC:
+		return "NHWC";
+	case DataLayout::NCHW8c:
+		return "NCHW8c";
+	case DataLayout::NCHW16c:
+		return "NCHW16c";
+	default:
+		return "NCHW";
+	}
+}
+
+void EasyCNN::convertLayout(const float* src, const DataLayout srcLayout, float* dst, const DataLayout dstLayout,
+	const DataSize size, ThreadPool* pool)
+{
+	if (srcLayout == dstLayout)
+	{
+		std::copy(src, src + getStorageSize(size, srcLayout), dst);
+		return;
+	}
+	const size_t srcBlock = getChannelBlock(srcLayout, size.channels);
+	const size_t dstBlock = getChannelBlock(dstLayout, size.channels);
+	const size_t dstChannels = getPaddedChannels(dstLayout, size.channels);
+	const size_t planeSize = size._2DSize();
+	//one task per (number, dst channel block), it owns that block of dst including the padding lanes
+	const size_t dstBlocks = dstChannels / dstBlock;
+	parallelFor(pool, size.number * dstBlocks, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t task = begin; task < end; task++)
+		{
+			const size_t nn = task / dstBlocks;
+			const size_t cBegin = task % dstBlocks * dstBlock;
+			float* dstBlockData = dst + getLayoutIndex(size, dstLayout, nn, cBegin, 0, 0);
+			std::fill(dstBlockData, dstBlockData + planeSize * dstBlock, 0.0f);
+			const size_t cEnd = std::min(cBegin + dstBlock, size.channels);
+			for (size_t nc = cBegin; nc < cEnd; nc++)
+			{
+				const float* srcPlane = src + getLayoutIndex(size, srcLayout, nn, nc, 0, 0);
+				float* dstPlane = dst + getLayoutIndex(size, dstLayout, nn, nc, 0, 0);
+				//element i of the plane sits at i * block in either layout
+				for (size_t i = 0; i < planeSize; i++)
+				{
+					dstPlane[i * dstBlock] = srcPlane[i * srcBlock];
+				}
+			}
+		}
+	});
+}
+
+EasyCNN::DataBucket::DataBucket(const DataSize _size, const DataLayout _layout, std::shared_ptr<Allocator> allocator)
+	:size(_size), layout(_layout), data(allocateFloats(EasyCNN::getStorageSize(_size, _layout), allocator)),
+	capacity(EasyCNN::getStorageSize(_size, _layout)), allocator(allocator)
+{
+}
+
+EasyCNN::DataBucket::DataBucket(const DataSize _size, const DataLayout _layout, std::shared_ptr<float> _data)
+	:size(_size), layout(_layout), data(_data), capacity(EasyCNN::getStorageSize(_size, _layout))
+{
+	easyAssert(data.get() != nullptr, "data can't be null.");
 }
 
 EasyCNN::DataBucket::~DataBucket()
@@ -10,18 +70,52 @@ EasyCNN::DataBucket::~DataBucket()
 
 }
 
+size_t EasyCNN::DataBucket::getCapacity() const
+{
+	return capacity;
+}
+
+void EasyCNN::DataBucket::reshape(const size_t number)
+{
+	DataSize newSize = size;
+	newSize.number = number;
+	const size_t storageSize = EasyCNN::getStorageSize(newSize, layout);
+	if (storageSize > capacity)
+	{
+		data.reset();
+		data = allocateFloats(storageSize, allocator);
+		capacity = storageSize;
+	}
+	size = newSize;
+}
+
+void EasyCNN::DataBucket::rebind(const std::shared_ptr<float> _data, const size_t number)
+{
+	easyAssert(_data.get() != nullptr, "data can't be null.");
+	data = _data;
+	size.number = number;
+	capacity = EasyCNN::getStorageSize(size, layout);
+}
+
 void EasyCNN::DataBucket::fillData(const float item)
 {
-	std::fill(data.get(), data.get() + getSize()._4DSize(), item);
+	std::fill(data.get(), data.get() + getStorageSize(), item);
 }
 
 void EasyCNN::DataBucket::cloneTo(DataBucket& target)
 {
 	target.size = this->size;
-	const size_t dataSize = sizeof(float)*this->size._4DSize();
+	target.layout = this->layout;
+	const size_t dataSize = sizeof(float)*this->getStorageSize();
 	memcpy(target.data.get(), this->data.get(), dataSize);
 }
 
+void EasyCNN::DataBucket::convertTo(DataBucket& target, ThreadPool* pool) const
+{
+	easyAssert(target.size == size, "data size must be equal.");
+	convertLayout(data.get(), layout, target.data.get(), target.layout, size, pool);
+}
+
 std::shared_ptr<float> EasyCNN::DataBucket::getData() const
 {
 	return data;
@@ -30,4 +124,33 @@ std::shared_ptr<float> EasyCNN::DataBucket::getData() const
 EasyCNN::DataSize EasyCNN::DataBucket::getSize() const
 {
 	return size;
-}
\ No newline at end of file
+}
+
+EasyCNN::DataLayout EasyCNN::DataBucket::getLayout() const
+{
+	return layout;
+}
+
+size_t EasyCNN::DataBucket::getStorageSize() const
+{
+	return EasyCNN::getStorageSize(size, layout);
+}
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::bindInputView(std::shared_ptr<DataBucket>& view, const DataSize sampleSize,
+	const float* data, const size_t number)
+{
+	easyAssert(data != nullptr, "input data can't be null.");
+	//non owning : aliases an empty owner
+	const std::shared_ptr<float> viewData(std::shared_ptr<float>(), const_cast<float*>(data));
+	if (view.get() == nullptr || !view->getSize().isSameSample(sampleSize))
+	{
+		DataSize size = sampleSize;
+		size.number = number;
+		view = std::make_shared<DataBucket>(size, DataLayout::NCHW, viewData);
+	}
+	else
+	{
+		view->rebind(viewData, number);
+	}
+	return view;
+}
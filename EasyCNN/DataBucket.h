@@ -6,9 +6,23 @@
 #include "Configure.h"
 #include "EasyLogger.h"
 #include "EasyAssert.h"
+#include "ThreadPool.h"
+#include "Allocator.h"
 
 namespace EasyCNN
 {
+	//memory order of a bucket. every layout stores (number, channels / block, height, width, block) :
+	//NCHW is block 1, NHWC is block channels, NCHW8c / NCHW16c are blocks of 8 / 16 channels.
+	//blocked layouts round channels up to a whole block, the padding lanes hold unspecified values
+	//and every consumer must leave them out of its results.
+	enum class DataLayout
+	{
+		NCHW,
+		NHWC,
+		NCHW8c,
+		NCHW16c
+	};
+
 	struct DataSize
 	{
 	public:
@@ -24,6 +38,10 @@ namespace EasyCNN
 		inline bool operator!=(const DataSize& other) const{
 			return !(*this == (other));
 		}
+		//equal but for number
+		inline bool isSameSample(const DataSize& other) const{
+			return other.channels == channels && other.width == width && other.height == height;
+		}
 		inline size_t getIndex(const size_t in, const size_t ic, const size_t ih, const size_t iw) const{
 			return in * channels * height * width + ic * height * width + ih * width + iw;
 		}
@@ -36,18 +54,77 @@ namespace EasyCNN
 		size_t height = 0;
 	};
 
+	inline size_t getChannelBlock(const DataLayout layout, const size_t channels)
+	{
+		switch (layout)
+		{
+		case DataLayout::NHWC:
+			return channels;
+		case DataLayout::NCHW8c:
+			return 8;
+		case DataLayout::NCHW16c:
+			return 16;
+		default:
+			return 1;
+		}
+	}
+	inline size_t getPaddedChannels(const DataLayout layout, const size_t channels)
+	{
+		const size_t block = getChannelBlock(layout, channels);
+		return (channels + block - 1) / block * block;
+	}
+	//floats needed to store size in layout
+	inline size_t getStorageSize(const DataSize& size, const DataLayout layout)
+	{
+		return size.number * getPaddedChannels(layout, size.channels) * size.height * size.width;
+	}
+	inline size_t getLayoutIndex(const DataSize& size, const DataLayout layout,
+		const size_t in, const size_t ic, const size_t ih, const size_t iw)
+	{
+		const size_t block = getChannelBlock(layout, size.channels);
+		const size_t channelBlocks = getPaddedChannels(layout, size.channels) / block;
+		return (((in * channelBlocks + ic / block) * size.height + ih) * size.width + iw) * block + ic % block;
+	}
+	const char* getLayoutName(const DataLayout layout);
+	//reorders size-shaped data from srcLayout to dstLayout, padding lanes of dst are zeroed.
+	void convertLayout(const float* src, const DataLayout srcLayout, float* dst, const DataLayout dstLayout,
+		const DataSize size, ThreadPool* pool = nullptr);
+
 	class DataBucket
 	{
 	public:
-		DataBucket(const DataSize _size);
+		//storage from allocator, null for the default one
+		DataBucket(const DataSize _size, const DataLayout _layout = DataLayout::NCHW, std::shared_ptr<Allocator> allocator = nullptr);
+		//a view on storage owned elsewhere, _data holds at least getStorageSize(_size, _layout) floats
+		DataBucket(const DataSize _size, const DataLayout _layout, std::shared_ptr<float> _data);
 		virtual ~DataBucket();
 	public:
 		DataSize getSize() const;
+		DataLayout getLayout() const;
+		//floats in data, larger than getSize()._4DSize() for padded layouts
+		size_t getStorageSize() const;
 		std::shared_ptr<float> getData() const;
+		//floats data has room for, at least getStorageSize()
+		size_t getCapacity() const;
+		//changes the batch size. a number that fits the capacity only changes the size, a larger one
+		//reallocates (contents are lost) and becomes the new capacity. views reallocate into storage of their own.
+		void reshape(const size_t number);
+		//as the view constructor on number samples of other storage, without an allocation
+		void rebind(const std::shared_ptr<float> _data, const size_t number);
 		void fillData(const float item);
 		void cloneTo(DataBucket& target);
+		//same size, reordered to target's layout
+		void convertTo(DataBucket& target, ThreadPool* pool = nullptr) const;
 	private:
 		DataSize size;
+		DataLayout layout = DataLayout::NCHW;
 		std::shared_ptr<float> data;
+		size_t capacity = 0;
+		std::shared_ptr<Allocator> allocator;
 	};
+
+	//number NCHW samples shaped like sampleSize at data as a non owning view, data is only read.
+	//view is created by the first call and rebound by the later ones, which allocate nothing.
+	std::shared_ptr<DataBucket> bindInputView(std::shared_ptr<DataBucket>& view, const DataSize sampleSize,
+		const float* data, const size_t number);
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstdio>
+#include "DataLoader.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "Kernels.h"
+
+//readySequence of a slot that holds no batch yet
+static const uint64_t noSequence = ~(uint64_t)0;
+
+//DataLoaderStats
+std::string EasyCNN::DataLoaderStats::toString() const
+{
+	char line[256] = { 0 };
+	snprintf(line, sizeof(line), "batches %llu samples %llu stalls %llu (%.3fs) worker wait %.3fs assemble %.3fs mean queue depth %.2f",
+		(unsigned long long)batches, (unsigned long long)samples, (unsigned long long)stalls, stallSeconds,
+		workerWaitSeconds, assembleSeconds, meanQueueDepth);
+	return line;
+}
+
+//DataLoader
+EasyCNN::DataLoader::DataLoader(std::shared_ptr<Dataset> dataset, std::shared_ptr<Sampler> sampler, const DataLoaderConfig& config)
+	:dataset(dataset), sampler(sampler), config(config)
+{
+	logVerbose("DataLoader constructed.");
+	easyAssert(dataset.get() != nullptr && sampler.get() != nullptr, "dataset and sampler can't be empty!");
+	easyAssert(config.batchSize > 0 && config.prefetchBatches > 0 && config.workerCount > 0,
+		"batch size, prefetch batches and worker count can't be 0.");
+	DataSize inputSize = dataset->getSampleSize();
+	sampleSize = inputSize._3DSize();
+	classCount = dataset->getClassCount();
+	easyAssert(sampleSize > 0 && classCount > 0, "dataset is empty.");
+	inputSize.number = config.batchSize;
+	slots.resize(config.prefetchBatches);
+	for (auto& slot : slots)
+	{
+		slot.input = std::make_shared<DataBucket>(inputSize);
+		slot.label = std::make_shared<DataBucket>(DataSize(config.batchSize, classCount, 1, 1));
+		slot.readySequence = noSequence;
+	}
+	stats.queueDepths.assign(config.prefetchBatches + 1, 0);
+	for (size_t i = 0; i < config.workerCount; i++)
+	{
+		workers.push_back(std::thread(&DataLoader::workerLoop, this));
+	}
+}
+
+EasyCNN::DataLoader::~DataLoader()
+{
+	stop();
+	logVerbose("DataLoader destructed.");
+}
+
+bool EasyCNN::DataLoader::next(std::shared_ptr<DataBucket>& inputDataBucket, std::shared_ptr<DataBucket>& labelDataBucket)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	//the batch returned last time goes back to the workers
+	if (releasedSequences != consumedSequences)
+	{
+		releasedSequences = consumedSequences;
+		freeCondition.notify_all();
+	}
+	Slot& slot = slots[consumedSequences % slots.size()];
+	const auto isReady = [&](){ return slot.readySequence == consumedSequences; };
+	const size_t readyCount = getReadyCount();
+	if (!isReady())
+	{
+		const Clock::time_point startTime = Clock::now();
+		readyCondition.wait(lock, [&](){ return stopping || isReady() || (claimedAll && consumedSequences == claimedSequences); });
+		if (isReady())
+		{
+			stats.stalls++;
+			stats.stallSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+		}
+	}
+	if (!isReady())
+	{
+		return false;
+	}
+	if (slot.epoch != consumerEpoch)
+	{
+		//left where it is for the call that starts the epoch
+		consumerEpoch = slot.epoch;
+		return false;
+	}
+	consumedSequences++;
+	stats.batches++;
+	stats.samples += slot.input->getSize().number;
+	stats.queueDepths[readyCount]++;
+	inputDataBucket = slot.input;
+	labelDataBucket = slot.label;
+	return true;
+}
+
+size_t EasyCNN::DataLoader::getEpoch() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return consumerEpoch;
+}
+
+void EasyCNN::DataLoader::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	readyCondition.notify_all();
+	freeCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+	workers.clear();
+}
+
+EasyCNN::DataLoaderStats EasyCNN::DataLoader::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	DataLoaderStats result = stats;
+	uint64_t depthSum = 0;
+	for (size_t i = 0; i < result.queueDepths.size(); i++)
+	{
+		depthSum += i * result.queueDepths[i];
+	}
+	result.meanQueueDepth = result.batches == 0 ? 0.0 : (double)depthSum / result.batches;
+	return result;
+}
+
+void EasyCNN::DataLoader::resetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats = DataLoaderStats();
+	stats.queueDepths.assign(slots.size() + 1, 0);
+}
+
+size_t EasyCNN::DataLoader::getReadyCount() const
+{
+	size_t readyCount = 0;
+	for (const auto& slot : slots)
+	{
+		if (slot.readySequence != noSequence && slot.readySequence >= consumedSequences)
+		{
+			readyCount++;
+		}
+	}
+	return readyCount;
+}
+
+bool EasyCNN::DataLoader::claimBatch(Claim& claim)
+{
+	if (stopping || claimedAll)
+	{
+		return false;
+	}
+	const auto getUsableCount = [this](){ return config.dropLast ? epochIndices->size() / config.batchSize * config.batchSize : epochIndices->size(); };
+	while (epochIndices.get() == nullptr || claimOffset >= getUsableCount())
+	{
+		if (epochIndices.get() != nullptr)
+		{
+			claimEpoch++;
+		}
+		if (config.maxEpochs > 0 && claimEpoch >= config.maxEpochs)
+		{
+			claimedAll = true;
+			readyCondition.notify_all();
+			return false;
+		}
+		//the workers still assembling the last epoch's batches keep its indices alive
+		const std::shared_ptr<std::vector<size_t>> indices = std::make_shared<std::vector<size_t>>();
+		sampler->getEpochIndices(claimEpoch, *indices);
+		for (const size_t index : *indices)
+		{
+			easyAssert(index < dataset->getSampleCount(), "sampler's index is out of the dataset.");
+		}
+		epochIndices = indices;
+		claimOffset = 0;
+		easyAssert(getUsableCount() > 0, "epoch holds no batch.");
+	}
+	claim.sequence = claimedSequences++;
+	claim.epoch = claimEpoch;
+	claim.indices = epochIndices;
+	claim.begin = claimOffset;
+	claim.end = std::min(claimOffset + config.batchSize, getUsableCount());
+	claimOffset = claim.end;
+	return true;
+}
+
+void EasyCNN::DataLoader::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	Claim claim;
+	while (claimBatch(claim))
+	{
+		//the ring is full until the training thread is done with the batch prefetchBatches before this one
+		const auto isFree = [&](){ return claim.sequence < releasedSequences + slots.size(); };
+		if (!isFree())
+		{
+			const Clock::time_point startTime = Clock::now();
+			freeCondition.wait(lock, [&](){ return stopping || isFree(); });
+			stats.workerWaitSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+		}
+		if (stopping)
+		{
+			break;
+		}
+		Slot& slot = slots[claim.sequence % slots.size()];
+		lock.unlock();
+		const Clock::time_point startTime = Clock::now();
+		assemble(claim, slot);
+		const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		lock.lock();
+		stats.assembleSeconds += seconds;
+		slot.readySequence = claim.sequence;
+		slot.epoch = claim.epoch;
+		readyCondition.notify_all();
+	}
+}
+
+void EasyCNN::DataLoader::assemble(const Claim& claim, Slot& slot)
+{
+	const size_t number = claim.end - claim.begin;
+	slot.input->reshape(number);
+	slot.label->reshape(number);
+	float* inputData = slot.input->getData().get();
+	float* labelData = slot.label->getData().get();
+	const KernelTable& kernels = getKernels();
+	std::fill(labelData, labelData + number * classCount, 0.0f);
+	for (size_t i = 0; i < number; i++)
+	{
+		const size_t index = (*claim.indices)[claim.begin + i];
+		kernels.u8ToFloat(dataset->getImage(index), inputData + i * sampleSize, sampleSize, config.scale);
+		const size_t label = dataset->getLabel(index);
+		easyAssert(label < classCount, "label is out of range.");
+		labelData[i * classCount + label] = 1.0f;
+	}
+}
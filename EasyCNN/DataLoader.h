@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "Dataset.h"
+
+namespace EasyCNN
+{
+	struct DataLoaderConfig
+	{
+		size_t batchSize = 16;
+		//batches assembled ahead of training, the ring holds as many buffers
+		size_t prefetchBatches = 4;
+		size_t workerCount = 1;
+		//pixel * scale
+		float scale = 1.0f / 256.0f;
+		//an epoch's last batch is short when the batch size doesn't divide it, dropLast skips it instead
+		bool dropLast = false;
+		//epochs to load, 0 never stops
+		size_t maxEpochs = 0;
+	};
+
+	struct DataLoaderStats
+	{
+		uint64_t batches = 0;
+		uint64_t samples = 0;
+		//next found its batch still being assembled : input is the bottleneck
+		uint64_t stalls = 0;
+		double stallSeconds = 0;
+		//workers found the ring full : compute is the bottleneck
+		double workerWaitSeconds = 0;
+		//workers' time spent converting samples
+		double assembleSeconds = 0;
+		//queueDepths[n] : next found n batches ready, its own among them unless n is 0
+		std::vector<uint64_t> queueDepths;
+		double meanQueueDepth = 0;
+		//batches, stalls, stall time, worker wait and mean queue depth on one line
+		std::string toString() const;
+	};
+
+	//turns a dataset into training batches ahead of time. the workers take the sampler's indices batch after batch
+	//and assemble each into one buffer of a ring of prefetchBatches preallocated input (NCHW, pixels scaled) and
+	//one hot label buckets, the training thread takes them in order with next. nothing is allocated per batch.
+	class DataLoader
+	{
+	public:
+		DataLoader(std::shared_ptr<Dataset> dataset, std::shared_ptr<Sampler> sampler, const DataLoaderConfig& config = DataLoaderConfig());
+		virtual ~DataLoader();
+		const DataLoaderConfig& getConfig() const{ return config; }
+		//the next batch of the current epoch, or false (once) when the epoch is over : the next call starts the next epoch.
+		//false for good after maxEpochs. the buckets are the ring's, valid until the next call, not to be written.
+		bool next(std::shared_ptr<DataBucket>& inputDataBucket, std::shared_ptr<DataBucket>& labelDataBucket);
+		//epoch of the batches next returns
+		size_t getEpoch() const;
+		//stops the workers, next returns false from then on. stopping twice is fine.
+		void stop();
+		DataLoaderStats getStats() const;
+		void resetStats();
+	private:
+		typedef std::chrono::steady_clock Clock;
+		//one buffer of the ring, batch sequence s goes to slot s % prefetchBatches
+		struct Slot
+		{
+			std::shared_ptr<DataBucket> input;
+			std::shared_ptr<DataBucket> label;
+			//sequence of the batch it holds once assembled, noSequence before
+			uint64_t readySequence;
+			size_t epoch = 0;
+		};
+		//a batch a worker took : samples [begin, end) of its epoch's indices
+		struct Claim
+		{
+			uint64_t sequence = 0;
+			size_t epoch = 0;
+			std::shared_ptr<const std::vector<size_t>> indices;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+		DataLoader(const DataLoader&) = delete;
+		DataLoader& operator=(const DataLoader&) = delete;
+		void workerLoop();
+		//the next batch to assemble, false when stopping or every epoch is taken. called locked.
+		bool claimBatch(Claim& claim);
+		void assemble(const Claim& claim, Slot& slot);
+		//batches ready from the one next waits for on. called locked.
+		size_t getReadyCount() const;
+	private:
+		std::shared_ptr<Dataset> dataset;
+		std::shared_ptr<Sampler> sampler;
+		DataLoaderConfig config;
+		size_t sampleSize = 0;
+		size_t classCount = 0;
+		std::vector<Slot> slots;
+		std::vector<std::thread> workers;
+		mutable std::mutex mutex;
+		std::condition_variable readyCondition;
+		std::condition_variable freeCondition;
+		bool stopping = false;
+		//producer side
+		std::shared_ptr<const std::vector<size_t>> epochIndices;
+		size_t claimEpoch = 0;
+		size_t claimOffset = 0;
+		uint64_t claimedSequences = 0;
+		bool claimedAll = false;
+		//consumer side : sequences below released are free for the workers
+		uint64_t consumedSequences = 0;
+		uint64_t releasedSequences = 0;
+		size_t consumerEpoch = 0;
+		DataLoaderStats stats;
+	};
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include "DataParallelTrainer.h"
+#include "Blas.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "NetWork.h"
+
+//gradients are summed in runs of this many floats : a run of every replica stays in cache while the tree walks it
+static const size_t reduceGrain = 4096;
+
+EasyCNN::DataParallelTrainer::DataParallelTrainer(NetWork& network, const size_t workerCount, const bool pinThreads)
+	:network(network), threadPool(std::make_shared<ThreadPool>(workerCount, pinThreads))
+{
+	logVerbose("DataParallelTrainer constructed.");
+	easyAssert(network.getPhase() == Phase::Train, "data parallel trainer needs a network in train phase.");
+	easyAssert(network.lossFunctor.get() != nullptr, "loss functor can't be empty!");
+	for (size_t i = 0; i < threadPool->getThreadCount(); i++)
+	{
+		replicas.push_back(network.createReplica());
+	}
+	shardLosses.resize(replicas.size());
+}
+
+EasyCNN::DataParallelTrainer::~DataParallelTrainer()
+{
+	logVerbose("DataParallelTrainer destructed.");
+}
+
+size_t EasyCNN::DataParallelTrainer::getWorkerCount() const
+{
+	return replicas.size();
+}
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::DataParallelTrainer::getShard(const std::shared_ptr<DataBucket> bucket,
+	const size_t begin, const size_t end)
+{
+	DataSize size = bucket->getSize();
+	const size_t sampleSize = size._3DSize();
+	size.number = end - begin;
+	//aliases the whole batch's storage
+	const std::shared_ptr<float> data(bucket->getData(), bucket->getData().get() + begin * sampleSize);
+	return std::make_shared<DataBucket>(size, DataLayout::NCHW, data);
+}
+
+float EasyCNN::DataParallelTrainer::trainBatch(const std::shared_ptr<DataBucket> inputDataBucket,
+	const std::shared_ptr<DataBucket> labelDataBucket, const float learningRate)
+{
+	logVerbose("DataParallelTrainer trainBatch begin.");
+	easyAssert(network.getPhase() == Phase::Train, "phase must be train!");
+	const size_t number = inputDataBucket->getSize().number;
+	easyAssert(number > 0 && labelDataBucket->getSize().number == number, "label count must equals with input count.");
+	easyAssert(inputDataBucket->getLayout() == DataLayout::NCHW && labelDataBucket->getLayout() == DataLayout::NCHW,
+		"input and label layout must be NCHW.");
+
+	//shards differ by one sample at most, the non empty ones come first
+	const size_t shardCount = std::min(number, replicas.size());
+	parallelFor(threadPool.get(), shardCount, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t shard = begin; shard < end; shard++)
+		{
+			const size_t sampleBegin = number * shard / shardCount;
+			const size_t sampleEnd = number * (shard + 1) / shardCount;
+			NetWork& replica = *replicas[shard];
+			replica.forward(getShard(inputDataBucket, sampleBegin, sampleEnd));
+			shardLosses[shard] = replica.computeGradients(getShard(labelDataBucket, sampleBegin, sampleEnd)) * (sampleEnd - sampleBegin);
+		}
+	});
+	allReduceGradients(shardCount);
+
+	//one optimizer step of the network over the shared param arena, then every replica rebuilds what it derived
+	network.applyGradients(replicas[0]->gradientArena.get(), learningRate, number);
+	for (size_t i = 0; i < replicas.size(); i++)
+	{
+		replicas[i]->onParamsChanged();
+	}
+
+	float loss = 0.0f;
+	for (size_t shard = 0; shard < shardCount; shard++)
+	{
+		loss += shardLosses[shard];
+	}
+	logVerbose("DataParallelTrainer trainBatch end.");
+	return loss / number;
+}
+
+float EasyCNN::DataParallelTrainer::trainBatch(const float* inputData, const size_t number,
+	const std::shared_ptr<DataBucket> labelDataBucket, const float learningRate)
+{
+	return trainBatch(network.wrapInput(inputData, number), labelDataBucket, learningRate);
+}
+
+//every run of the arenas is summed pairwise : replica r takes r + 1, then r + 2, r + 4 ... (tree reduction).
+//the order of the additions depends on the replica count only.
+void EasyCNN::DataParallelTrainer::allReduceGradients(const size_t shardCount)
+{
+	const size_t size = replicas[0]->gradientArenaSize;
+	for (size_t i = 0; i < shardCount; i++)
+	{
+		easyAssert(replicas[i]->gradientArenaSize == size, "replica gradients are laid out differently.");
+	}
+	const BlasBackend& blas = getBlas();
+	parallelFor(threadPool.get(), size, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t stride = 1; stride < shardCount; stride *= 2)
+		{
+			for (size_t i = 0; i + stride < shardCount; i += 2 * stride)
+			{
+				blas.axpy(end - begin, 1.0f, replicas[i + stride]->gradientArena.get() + begin, replicas[i]->gradientArena.get() + begin);
+			}
+		}
+	}, reduceGrain);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	class NetWork;
+
+	//synchronous data parallel training on one node. every worker trains a replica of the network : the same
+	//layers over the network's own param buckets, with buckets, workspaces and gradients of its own.
+	//a batch is cut into one contiguous shard per worker, the workers run forward and backward of their shard
+	//at the same time, the gradients are summed over the workers and the update is applied once,
+	//as NetWork::trainBatch on the whole batch does. the sums go through a fixed tree, the trained model doesn't
+	//depend on scheduling and differs from single threaded large batch training by float rounding only.
+	class DataParallelTrainer
+	{
+	public:
+		//network in train phase with its layers and loss functor set, it must not change while the trainer lives
+		//(training it on its own in between is fine). workerCount 0 uses every hardware thread,
+		//every worker runs its replica on one thread, pinThreads binds worker i to core i.
+		explicit DataParallelTrainer(NetWork& network, const size_t workerCount = 0, const bool pinThreads = false);
+		virtual ~DataParallelTrainer();
+		size_t getWorkerCount() const;
+		//as NetWork::trainBatch : NCHW input and label, only read. returns the loss over the whole batch.
+		//batches smaller than the worker count leave some workers idle.
+		float trainBatch(const std::shared_ptr<DataBucket> inputDataBucket,
+			const std::shared_ptr<DataBucket> labelDataBucket, const float learningRate);
+		float trainBatch(const float* inputData, const size_t number,
+			const std::shared_ptr<DataBucket> labelDataBucket, const float learningRate);
+	private:
+		DataParallelTrainer(const DataParallelTrainer&) = delete;
+		DataParallelTrainer& operator=(const DataParallelTrainer&) = delete;
+		//shard's samples of bucket, a view
+		static std::shared_ptr<DataBucket> getShard(const std::shared_ptr<DataBucket> bucket, const size_t begin, const size_t end);
+		//the first shardCount replicas' gradients summed into the first one's
+		void allReduceGradients(const size_t shardCount);
+	private:
+		NetWork& network;
+		std::vector<std::shared_ptr<NetWork>> replicas;
+		std::shared_ptr<ThreadPool> threadPool;
+		std::vector<float> shardLosses;
+	};
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include "Dataset.h"
+#include "EasyAssert.h"
+
+//SequentialSampler
+EasyCNN::SequentialSampler::SequentialSampler(const size_t sampleCount)
+	:sampleCount(sampleCount)
+{
+}
+
+void EasyCNN::SequentialSampler::getEpochIndices(const size_t epoch, std::vector<size_t>& indices)
+{
+	indices.resize(sampleCount);
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		indices[i] = i;
+	}
+}
+
+//SubsetSampler
+EasyCNN::SubsetSampler::SubsetSampler(const std::vector<size_t>& indices)
+	:indices(indices)
+{
+}
+
+void EasyCNN::SubsetSampler::getEpochIndices(const size_t epoch, std::vector<size_t>& indices)
+{
+	indices = this->indices;
+}
+
+//PermutationSampler
+EasyCNN::PermutationSampler::PermutationSampler(const std::vector<size_t>& indices, const uint64_t seed)
+	:indices(indices), seed(seed)
+{
+}
+
+void EasyCNN::PermutationSampler::getEpochIndices(const size_t epoch, std::vector<size_t>& indices)
+{
+	indices = this->indices;
+	SampleRandom(seed, epoch).shuffle(indices);
+}
+
+//StratifiedSampler
+std::vector<std::vector<size_t>> EasyCNN::StratifiedSampler::groupByClass(const Dataset& dataset, const std::vector<size_t>& indices)
+{
+	std::vector<std::vector<size_t>> groups(dataset.getClassCount());
+	for (const size_t index : indices)
+	{
+		const size_t label = dataset.getLabel(index);
+		easyAssert(label < groups.size(), "label is out of range.");
+		groups[label].push_back(index);
+	}
+	groups.erase(std::remove_if(groups.begin(), groups.end(), [](const std::vector<size_t>& group){ return group.empty(); }), groups.end());
+	return groups;
+}
+
+EasyCNN::StratifiedSampler::StratifiedSampler(const Dataset& dataset, const std::vector<size_t>& indices, const uint64_t seed)
+	:classIndices(groupByClass(dataset, indices)), sampleCount(indices.size()), seed(seed)
+{
+}
+
+//the k-th of a class's n samples (shuffled) goes to position (k + offset) / n of the epoch, offset random per class.
+//merging the classes by position interleaves them evenly.
+void EasyCNN::StratifiedSampler::getEpochIndices(const size_t epoch, std::vector<size_t>& indices)
+{
+	SampleRandom random(seed, epoch);
+	std::vector<std::vector<size_t>> shuffled(classIndices);
+	std::vector<double> offsets(shuffled.size());
+	for (size_t c = 0; c < shuffled.size(); c++)
+	{
+		random.shuffle(shuffled[c]);
+		offsets[c] = random.uniform();
+	}
+	//(position, class) of every class's next sample, earliest first
+	typedef std::pair<double, size_t> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heads;
+	std::vector<size_t> taken(shuffled.size(), 0);
+	for (size_t c = 0; c < shuffled.size(); c++)
+	{
+		heads.push(Entry(offsets[c] / shuffled[c].size(), c));
+	}
+	indices.clear();
+	indices.reserve(sampleCount);
+	while (!heads.empty())
+	{
+		const size_t c = heads.top().second;
+		heads.pop();
+		indices.push_back(shuffled[c][taken[c]++]);
+		if (taken[c] < shuffled[c].size())
+		{
+			heads.push(Entry((taken[c] + offsets[c]) / shuffled[c].size(), c));
+		}
+	}
+}
+
+//WeightedSampler
+EasyCNN::WeightedSampler::WeightedSampler(const std::vector<size_t>& indices, const std::vector<double>& weights,
+	const size_t samplesPerEpoch, const uint64_t seed)
+	:indices(indices), samplesPerEpoch(samplesPerEpoch), seed(seed)
+{
+	easyAssert(!indices.empty() && weights.size() == indices.size(), "every index needs a weight.");
+	double sum = 0;
+	for (const double weight : weights)
+	{
+		easyAssert(weight >= 0, "weights can't be negative.");
+		sum += weight;
+	}
+	easyAssert(sum > 0, "weights can't all be 0.");
+	//vose : slots under the mean borrow the rest of their probability from one above it
+	const size_t count = weights.size();
+	probabilities.resize(count);
+	aliases.resize(count);
+	std::vector<size_t> small;
+	std::vector<size_t> large;
+	for (size_t i = 0; i < count; i++)
+	{
+		probabilities[i] = weights[i] * count / sum;
+		aliases[i] = i;
+		(probabilities[i] < 1.0 ? small : large).push_back(i);
+	}
+	while (!small.empty() && !large.empty())
+	{
+		const size_t less = small.back();
+		small.pop_back();
+		const size_t more = large.back();
+		aliases[less] = more;
+		probabilities[more] -= 1.0 - probabilities[less];
+		if (probabilities[more] < 1.0)
+		{
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+	//what's left is 1 up to rounding
+	for (const size_t i : large)
+	{
+		probabilities[i] = 1.0;
+	}
+	for (const size_t i : small)
+	{
+		probabilities[i] = 1.0;
+	}
+}
+
+void EasyCNN::WeightedSampler::getEpochIndices(const size_t epoch, std::vector<size_t>& indices)
+{
+	SampleRandom random(seed, epoch);
+	indices.resize(samplesPerEpoch);
+	for (size_t i = 0; i < samplesPerEpoch; i++)
+	{
+		const size_t slot = random.below(this->indices.size());
+		indices[i] = this->indices[random.uniform() < probabilities[slot] ? slot : aliases[slot]];
+	}
+}
+
+std::vector<double> EasyCNN::WeightedSampler::getClassBalancedWeights(const Dataset& dataset, const std::vector<size_t>& indices)
+{
+	std::vector<size_t> classSizes(dataset.getClassCount(), 0);
+	for (const size_t index : indices)
+	{
+		const size_t label = dataset.getLabel(index);
+		easyAssert(label < classSizes.size(), "label is out of range.");
+		classSizes[label]++;
+	}
+	std::vector<double> weights(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		weights[i] = 1.0 / classSizes[dataset.getLabel(indices[i])];
+	}
+	return weights;
+}
+
+//splitDataset
+void EasyCNN::splitDataset(const Dataset& dataset, const float validateFraction, const uint64_t seed, const bool stratified,
+	std::vector<size_t>& trainIndices, std::vector<size_t>& validateIndices)
+{
+	easyAssert(validateFraction >= 0.0f && validateFraction <= 1.0f, "validate fraction must be in [0, 1].");
+	const size_t sampleCount = dataset.getSampleCount();
+	std::vector<size_t> all(sampleCount);
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		all[i] = i;
+	}
+	SampleRandom random(seed, 0);
+	//a flag per sample, read back in order
+	std::vector<uint8_t> validate(sampleCount, 0);
+	const std::vector<std::vector<size_t>> groups = stratified ? StratifiedSampler::groupByClass(dataset, all) : std::vector<std::vector<size_t>>(1, all);
+	for (auto group : groups)
+	{
+		random.shuffle(group);
+		const size_t validateCount = (size_t)(group.size() * (double)validateFraction);
+		for (size_t i = 0; i < validateCount; i++)
+		{
+			validate[group[i]] = 1;
+		}
+	}
+	trainIndices.clear();
+	validateIndices.clear();
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		(validate[i] ? validateIndices : trainIndices).push_back(i);
+	}
+}
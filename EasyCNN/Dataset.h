@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+
+namespace EasyCNN
+{
+	//splitmix64 : the same numbers on every platform, which the standard distributions don't promise.
+	//every (seed, stream) pair gets a generator of its own, streams are epochs (or 0 for one off uses).
+	class SampleRandom
+	{
+	public:
+		SampleRandom(const uint64_t seed, const uint64_t stream)
+			:state(mix(seed) ^ mix(stream + 0x632BE59BD9B4E019ull))
+		{
+		}
+		uint64_t next()
+		{
+			return mix(state += 0x9E3779B97F4A7C15ull);
+		}
+		//uniform in [0, bound), bound > 0
+		size_t below(const size_t bound)
+		{
+			//values under threshold would make the low residues more likely
+			const uint64_t threshold = (0 - (uint64_t)bound) % bound;
+			uint64_t value = next();
+			while (value < threshold)
+			{
+				value = next();
+			}
+			return (size_t)(value % bound);
+		}
+		//uniform in [0, 1)
+		double uniform()
+		{
+			return (next() >> 11) * (1.0 / 9007199254740992.0);
+		}
+		//fisher yates
+		void shuffle(std::vector<size_t>& values)
+		{
+			for (size_t i = values.size(); i > 1; i--)
+			{
+				std::swap(values[i - 1], values[below(i)]);
+			}
+		}
+	private:
+		static uint64_t mix(uint64_t value)
+		{
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+			return value ^ (value >> 31);
+		}
+	private:
+		uint64_t state = 0;
+	};
+
+	//labelled uint8 samples (images with a class index) a DataLoader reads. its worker threads read
+	//different samples at the same time, reading must be thread safe.
+	class Dataset
+	{
+	public:
+		virtual ~Dataset() {}
+		virtual size_t getSampleCount() const = 0;
+		//one sample's size (number 1), every sample has getSampleSize()._3DSize() bytes
+		virtual DataSize getSampleSize() const = 0;
+		//labels are in [0, getClassCount())
+		virtual size_t getClassCount() const = 0;
+		//valid as long as the dataset lives
+		virtual const uint8_t* getImage(const size_t index) const = 0;
+		virtual size_t getLabel(const size_t index) const = 0;
+	};
+
+	//the order samples are visited in : every epoch is a list of sample indices. called from one thread at a time,
+	//epochs in increasing order, possibly ahead of the epoch being trained.
+	class Sampler
+	{
+	public:
+		virtual ~Sampler() {}
+		//indices is cleared and filled with the epoch's sample indices
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) = 0;
+	};
+
+	//0, 1, ... sampleCount - 1, every epoch
+	class SequentialSampler : public Sampler
+	{
+	public:
+		explicit SequentialSampler(const size_t sampleCount);
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) override;
+	private:
+		size_t sampleCount = 0;
+	};
+
+	//the given indices in their order, every epoch : a fixed part of a dataset
+	class SubsetSampler : public Sampler
+	{
+	public:
+		explicit SubsetSampler(const std::vector<size_t>& indices);
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) override;
+	private:
+		std::vector<size_t> indices;
+	};
+
+	//every sampler below is seeded : the same seed gives the same indices for an epoch on every platform,
+	//whatever order epochs are asked in. only indices are moved, never sample bytes.
+
+	//a fresh random permutation of the given indices every epoch
+	class PermutationSampler : public Sampler
+	{
+	public:
+		PermutationSampler(const std::vector<size_t>& indices, const uint64_t seed);
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) override;
+	private:
+		std::vector<size_t> indices;
+		uint64_t seed = 0;
+	};
+
+	//a random permutation every epoch with the classes spread evenly : any run of the epoch holds every class
+	//in about its share of the given indices, so every batch sees the class mix of the whole set.
+	class StratifiedSampler : public Sampler
+	{
+	public:
+		//reads the labels of indices once
+		StratifiedSampler(const Dataset& dataset, const std::vector<size_t>& indices, const uint64_t seed);
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) override;
+		//indices grouped by label in their order, classes without samples left out
+		static std::vector<std::vector<size_t>> groupByClass(const Dataset& dataset, const std::vector<size_t>& indices);
+	private:
+		//the indices of every class present
+		std::vector<std::vector<size_t>> classIndices;
+		size_t sampleCount = 0;
+		uint64_t seed = 0;
+	};
+
+	//samplesPerEpoch indices drawn with replacement, indices[i] with probability weights[i] / sum of weights
+	//(alias method : building is linear, every draw constant time)
+	class WeightedSampler : public Sampler
+	{
+	public:
+		WeightedSampler(const std::vector<size_t>& indices, const std::vector<double>& weights,
+			const size_t samplesPerEpoch, const uint64_t seed);
+		virtual void getEpochIndices(const size_t epoch, std::vector<size_t>& indices) override;
+		//1 / the size of its class for each of indices : every class is drawn equally often
+		static std::vector<double> getClassBalancedWeights(const Dataset& dataset, const std::vector<size_t>& indices);
+	private:
+		std::vector<size_t> indices;
+		//alias table : slot i keeps indices[i] with probability probabilities[i], else takes indices[aliases[i]]
+		std::vector<double> probabilities;
+		std::vector<size_t> aliases;
+		size_t samplesPerEpoch = 0;
+		uint64_t seed = 0;
+	};
+
+	//splits the dataset's samples in two, validateFraction of them (rounded down) to validate, seeded.
+	//stratified takes validateFraction of every class instead, so both parts keep the classes' shares. both parts come back in increasing order,
+	//which reads a mapped dataset front to back.
+	void splitDataset(const Dataset& dataset, const float validateFraction, const uint64_t seed, const bool stratified,
+		std::vector<size_t>& trainIndices, std::vector<size_t>& validateIndices);
+}
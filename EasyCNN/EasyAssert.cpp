@@ -31,7 +31,7 @@ static std::string formatString(const char* fmt, ...)
 	}
 	return s;
 }
-void EasyCNN::easyAssertCore(const std::string& file, const std::string& function, const long line,
+void EasyCNN::easyAssertCore(const char* file, const char* function, const long line,
 	const bool condition, const char* fmt, ...)
 {
 	if (!condition)
@@ -39,7 +39,7 @@ void EasyCNN::easyAssertCore(const std::string& file, const std::string& functio
 		va_list args;
 		va_start(args, fmt);
 		const std::string errorStr = formatString(fmt, args);
-		logFatal("FILE:%s,FUNCTION:%s,LINE:%d", file.c_str(), function.c_str(), line);
+		logFatal("FILE:%s,FUNCTION:%s,LINE:%d", file, function, line);
 		logFatal(fmt, args);
 		va_end(args);
 		if (globalAssertFatalCB)
@@ -8,7 +8,8 @@ namespace EasyCNN
 {
 	void setAssertFatalCallback(void(*cb)(void* userData, const std::string& errorStr), void* userData);
 
-	void easyAssertCore(const std::string& file, const std::string& function, const long line,
+	//file and function stay raw literals, a passing assert costs a branch and nothing else
+	void easyAssertCore(const char* file, const char* function, const long line,
 		const bool condition, const char* fmt, ...);
 
 #define easyAssert(condition,fmt,...) \
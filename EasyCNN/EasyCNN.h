@@ -5,6 +5,9 @@
 #include "EasyLogger.h"
 #include "EasyAssert.h"
 #include "CommonTools.h"
+#include "Kernels.h"
+#include "Blas.h"
+#include "Allocator.h"
 //layers
 #include "Layer.h"
 #include "DataBucket.h"
@@ -15,6 +18,19 @@
 #include "PoolingLayer.h"
 #include "FullconnectLayer.h"
 #include "SoftmaxLayer.h"
+#include "SoftmaxCrossEntropyLayer.h"
 //network
+#include "ModelFile.h"
+#include "Optimizer.h"
 #include "NetWork.h"
+#include "ExecutionContext.h"
+#include "InferenceServer.h"
+#include "UnixSocketEndpoint.h"
+#include "DataParallelTrainer.h"
+#include "Dataset.h"
+#include "IdxFile.h"
+#include "IdxDataset.h"
+#include "DataLoader.h"
+#include "ShardFile.h"
+#include "ShardReader.h"
 //test
@@ -16,11 +16,16 @@ namespace EasyCNN
 	static std::string formatString(const char* fmt, va_list args)
 	{
 		std::string content;
+		//measuring consumes a va_list, the formatting pass gets its own copy
+		va_list formatArgs;
+		va_copy(formatArgs, args);
 		const int size = vsnprintf(NULL, 0, fmt, args);
 		if (size > 0) {
+			content.resize(size + 1);
+			vsnprintf(&content[0], content.size(), fmt, formatArgs);
 			content.resize(size);
-			vsprintf(const_cast<char*>(content.data()), fmt, args);
 		}
+		va_end(formatArgs);
 		return content;
 	}
 	static std::string level2str(const LogLevel level)
@@ -0,0 +1,125 @@
+#include "ExecutionContext.h"
+#include "MemoryPlan.h"
+#include "NetWork.h"
+
+//the context starts out on the network's own buckets, they only tell sizes and layouts :
+//the first batch replaces every one of them by a view into the context's arena
+EasyCNN::ExecutionContext::ExecutionContext(NetWork& network, const size_t threadCount, const bool pinThreads)
+	:layers(network.layers), dataBuckets(network.dataBuckets), reorderBuckets(network.reorderBuckets),
+	outputBucket(network.outputBucket), inPlace(network.getInPlaceLayers())
+{
+	logVerbose("ExecutionContext constructed.");
+	easyAssert(network.getPhase() == Phase::Test, "execution context needs a network in test phase.");
+	easyAssert(layers.size() > 1 && dataBuckets.size() == layers.size() + 1, "network is not ready.");
+	if (threadCount != 1)
+	{
+		threadPool = std::make_shared<ThreadPool>(threadCount, pinThreads);
+	}
+	//everything the layers derive from their params is built now, forward only reads them later
+	for (const auto& layer : layers)
+	{
+		layer->prepareForward();
+		workspaces.push_back(layer->createWorkspace());
+	}
+}
+
+EasyCNN::ExecutionContext::~ExecutionContext()
+{
+	logVerbose("ExecutionContext destructed.");
+}
+
+size_t EasyCNN::ExecutionContext::getThreadCount() const
+{
+	return EasyCNN::getThreadCount(threadPool.get());
+}
+
+EasyCNN::DataSize EasyCNN::ExecutionContext::getInputSize() const
+{
+	DataSize size = dataBuckets.front()->getSize();
+	size.number = 1;
+	return size;
+}
+
+EasyCNN::DataSize EasyCNN::ExecutionContext::getOutputSize() const
+{
+	DataSize size = (outputBucket.get() != nullptr ? outputBucket : dataBuckets.back())->getSize();
+	size.number = 1;
+	return size;
+}
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::ExecutionContext::testBatch(const std::shared_ptr<DataBucket> inputDataBucket)
+{
+	const size_t oldNumber = dataBuckets.back()->getSize().number;
+	const size_t newNumber = inputDataBucket->getSize().number;
+	bindInput(inputDataBucket);
+	//the arena is replanned only past the largest batch it was planned for
+	if (activationArena.get() == nullptr || newNumber > activationNumber)
+	{
+		activationArena.reset();
+		activationArena = planForwardMemory(dataBuckets, reorderBuckets, outputBucket, inPlace, newNumber);
+		activationNumber = newNumber;
+	}
+	else if (newNumber != oldNumber)
+	{
+		reshapeActivations(newNumber);
+	}
+
+	ThreadPool* pool = threadPool.get();
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		std::shared_ptr<DataBucket> layerInput = dataBuckets[i];
+		if (reorderBuckets[i].get() != nullptr)
+		{
+			layerInput->convertTo(*reorderBuckets[i], pool);
+			layerInput = reorderBuckets[i];
+		}
+		layers[i]->forward(layerInput, dataBuckets[i + 1], workspaces[i].get(), pool);
+	}
+	if (outputBucket.get() == nullptr)
+	{
+		return dataBuckets.back();
+	}
+	dataBuckets.back()->convertTo(*outputBucket, pool);
+	return outputBucket;
+}
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::ExecutionContext::testBatch(const float* inputData, const size_t number)
+{
+	return testBatch(bindInputView(inputView, dataBuckets[0]->getSize(), inputData, number));
+}
+
+void EasyCNN::ExecutionContext::bindInput(const std::shared_ptr<DataBucket> inputDataBucket)
+{
+	const DataSize inputSize = inputDataBucket->getSize();
+	const DataSize expectedSize = dataBuckets[0]->getSize();
+	easyAssert(inputSize.channels == expectedSize.channels && inputSize.height == expectedSize.height && inputSize.width == expectedSize.width &&
+		inputSize.number > 0, "input size is invalidate.");
+	easyAssert(inputDataBucket->getLayout() == DataLayout::NCHW, "input layout must be NCHW.");
+	const std::shared_ptr<DataBucket> previousInput = dataBuckets[0];
+	for (size_t i = 0; i < dataBuckets.size() && dataBuckets[i] == previousInput; i++)
+	{
+		dataBuckets[i] = inputDataBucket;
+	}
+}
+
+void EasyCNN::ExecutionContext::reshapeActivations(const size_t number)
+{
+	for (size_t i = 1; i < dataBuckets.size(); i++)
+	{
+		if (dataBuckets[i] != dataBuckets[0])
+		{
+			dataBuckets[i]->reshape(number);
+		}
+	}
+	for (auto& bucket : reorderBuckets)
+	{
+		if (bucket.get() != nullptr)
+		{
+			bucket->reshape(number);
+		}
+	}
+	if (outputBucket.get() != nullptr)
+	{
+		outputBucket->reshape(number);
+	}
+}
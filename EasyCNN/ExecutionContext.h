@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Configure.h"
+#include "Layer.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	class NetWork;
+
+	//the state of inference requests on a network : activation buckets in one arena (sized for the largest
+	//batch so far), a workspace per layer and a thread pool. the layers and their params are shared with the
+	//network and only read, so any number of contexts may run testBatch at the same time, each from one thread.
+	//a context keeps the layers alive, but the network must not change (train, addLayer, loadModel) while it exists.
+	class ExecutionContext
+	{
+	public:
+		//network must be in test phase. threadCount 1 runs every layer on the calling thread,
+		//0 uses every hardware thread.
+		explicit ExecutionContext(NetWork& network, const size_t threadCount = 1, const bool pinThreads = false);
+		virtual ~ExecutionContext();
+		size_t getThreadCount() const;
+		//one sample's input / output size (number 1), outputs are NCHW
+		DataSize getInputSize() const;
+		DataSize getOutputSize() const;
+		//as NetWork::testBatch, the result stays valid until the next call on this context
+		std::shared_ptr<DataBucket> testBatch(const std::shared_ptr<DataBucket> inputDataBucket);
+		std::shared_ptr<DataBucket> testBatch(const float* inputData, const size_t number);
+	private:
+		ExecutionContext(const ExecutionContext&) = delete;
+		ExecutionContext& operator=(const ExecutionContext&) = delete;
+		void bindInput(const std::shared_ptr<DataBucket> inputDataBucket);
+		void reshapeActivations(const size_t number);
+	private:
+		std::vector<std::shared_ptr<Layer>> layers;
+		std::vector<std::shared_ptr<LayerWorkspace>> workspaces;
+		//laid out as the network's : layer i reads dataBuckets[i] (through reorderBuckets[i] when it has one)
+		//and writes dataBuckets[i + 1], the same bucket when inPlace[i].
+		std::vector<std::shared_ptr<DataBucket>> dataBuckets;
+		std::vector<std::shared_ptr<DataBucket>> reorderBuckets;
+		std::shared_ptr<DataBucket> outputBucket;
+		//the view testBatch binds a caller's buffer through
+		std::shared_ptr<DataBucket> inputView;
+		std::vector<bool> inPlace;
+		std::shared_ptr<float> activationArena;
+		size_t activationNumber = 0;
+		std::shared_ptr<ThreadPool> threadPool;
+	};
+}
@@ -0,0 +1,188 @@
+#include <cmath>
+#include <algorithm>
+#include "FFT.h"
+#include "EasyAssert.h"
+
+//std::complex multiply checks for inf/nan on some compilers, spell it out.
+static inline EasyCNN::Complex complexMul(const EasyCNN::Complex a, const EasyCNN::Complex b)
+{
+	return EasyCNN::Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+EasyCNN::ComplexFFT::ComplexFFT(const size_t length)
+{
+	easyAssert(length > 0 && (length & (length - 1)) == 0, "fft length must be a power of two.");
+	this->length = length;
+	const double pi = 3.14159265358979323846;
+	twiddles.resize(length / 2);
+	for (size_t k = 0; k < length / 2; k++)
+	{
+		const double angle = -2.0 * pi * (double)k / (double)length;
+		twiddles[k] = Complex((float)std::cos(angle), (float)std::sin(angle));
+	}
+	size_t bits = 0;
+	while (((size_t)1 << bits) < length)
+	{
+		bits++;
+	}
+	bitReverse.resize(length);
+	for (size_t i = 0; i < length; i++)
+	{
+		size_t reversed = 0;
+		for (size_t b = 0; b < bits; b++)
+		{
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		bitReverse[i] = reversed;
+	}
+}
+
+void EasyCNN::ComplexFFT::transform(Complex* data, const bool inverse) const
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		const size_t j = bitReverse[i];
+		if (i < j)
+		{
+			std::swap(data[i], data[j]);
+		}
+	}
+	//iterative decimation in time butterflies
+	for (size_t size = 2; size <= length; size <<= 1)
+	{
+		const size_t half = size / 2;
+		const size_t step = length / size;
+		for (size_t start = 0; start < length; start += size)
+		{
+			Complex* lo = data + start;
+			Complex* hi = lo + half;
+			for (size_t k = 0; k < half; k++)
+			{
+				const Complex w = inverse ? std::conj(twiddles[k * step]) : twiddles[k * step];
+				const Complex t = complexMul(hi[k], w);
+				hi[k] = lo[k] - t;
+				lo[k] = lo[k] + t;
+			}
+		}
+	}
+}
+
+EasyCNN::RealFFT2D::RealFFT2D(const size_t height, const size_t width)
+	:height(height), width(width), rowFFT(width / 2), columnFFT(height)
+{
+	easyAssert(width >= 2, "fft width must be at least 2.");
+	const double pi = 3.14159265358979323846;
+	rowTwiddles.resize(width / 2 + 1);
+	for (size_t k = 0; k <= width / 2; k++)
+	{
+		const double angle = -2.0 * pi * (double)k / (double)width;
+		rowTwiddles[k] = Complex((float)std::cos(angle), (float)std::sin(angle));
+	}
+	scratch.resize(std::max(width / 2, height));
+}
+
+//X[k] = E[k] + w^k * O[k] where E/O are the spectra of the even/odd samples,
+//both recovered from Z = FFT(even + i * odd).
+void EasyCNN::RealFFT2D::forwardRow(const float* row, const size_t rowWidth, Complex* bins)
+{
+	const size_t half = width / 2;
+	Complex* z = &scratch[0];
+	for (size_t k = 0; k < half; k++)
+	{
+		const float even = 2 * k < rowWidth ? row[2 * k] : 0.0f;
+		const float odd = 2 * k + 1 < rowWidth ? row[2 * k + 1] : 0.0f;
+		z[k] = Complex(even, odd);
+	}
+	rowFFT.transform(z, false);
+	for (size_t k = 0; k <= half; k++)
+	{
+		const Complex zk = z[k % half];
+		const Complex zc = std::conj(z[(half - k) % half]);
+		const Complex even = (zk + zc) * 0.5f;
+		const Complex diff = zk - zc;
+		//(zk - zc) / 2i
+		const Complex odd(diff.imag() * 0.5f, -diff.real() * 0.5f);
+		bins[k] = even + complexMul(rowTwiddles[k], odd);
+	}
+}
+
+void EasyCNN::RealFFT2D::inverseRow(const Complex* bins, float* row, const size_t rowWidth)
+{
+	const size_t half = width / 2;
+	Complex* z = &scratch[0];
+	for (size_t k = 0; k < half; k++)
+	{
+		const Complex xk = bins[k];
+		const Complex xc = std::conj(bins[half - k]);
+		const Complex even = (xk + xc) * 0.5f;
+		const Complex odd = complexMul(xk - xc, std::conj(rowTwiddles[k])) * 0.5f;
+		//even + i * odd
+		z[k] = Complex(even.real() - odd.imag(), even.imag() + odd.real());
+	}
+	rowFFT.transform(z, true);
+	for (size_t k = 0; k < half; k++)
+	{
+		if (2 * k < rowWidth)
+		{
+			row[2 * k] = z[k].real();
+		}
+		if (2 * k + 1 < rowWidth)
+		{
+			row[2 * k + 1] = z[k].imag();
+		}
+	}
+}
+
+void EasyCNN::RealFFT2D::forward(const float* plane, const size_t planeHeight, const size_t planeWidth, Complex* spectrum)
+{
+	easyAssert(planeHeight <= height && planeWidth <= width, "plane is larger than fft size.");
+	const size_t bins = width / 2 + 1;
+	for (size_t r = 0; r < planeHeight; r++)
+	{
+		forwardRow(plane + r * planeWidth, planeWidth, spectrum + r * bins);
+	}
+	std::fill(spectrum + planeHeight * bins, spectrum + height * bins, Complex(0.0f, 0.0f));
+	Complex* column = &scratch[0];
+	for (size_t c = 0; c < bins; c++)
+	{
+		for (size_t r = 0; r < height; r++)
+		{
+			column[r] = spectrum[r * bins + c];
+		}
+		columnFFT.transform(column, false);
+		for (size_t r = 0; r < height; r++)
+		{
+			spectrum[r * bins + c] = column[r];
+		}
+	}
+}
+
+void EasyCNN::RealFFT2D::inverse(Complex* spectrum, float* plane, const size_t planeHeight, const size_t planeWidth)
+{
+	easyAssert(planeHeight <= height && planeWidth <= width, "plane is larger than fft size.");
+	const size_t bins = width / 2 + 1;
+	Complex* column = &scratch[0];
+	for (size_t c = 0; c < bins; c++)
+	{
+		for (size_t r = 0; r < height; r++)
+		{
+			column[r] = spectrum[r * bins + c];
+		}
+		columnFFT.transform(column, true);
+		for (size_t r = 0; r < height; r++)
+		{
+			spectrum[r * bins + c] = column[r];
+		}
+	}
+	//both inverse passes are unnormalized, rows run at half length
+	const float scale = 1.0f / (float)(height * (width / 2));
+	for (size_t r = 0; r < planeHeight; r++)
+	{
+		float* row = plane + r * planeWidth;
+		inverseRow(spectrum + r * bins, row, planeWidth);
+		for (size_t c = 0; c < planeWidth; c++)
+		{
+			row[c] *= scale;
+		}
+	}
+}
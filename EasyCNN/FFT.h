@@ -0,0 +1,64 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	typedef std::complex<float> Complex;
+
+	//in place radix-2 complex FFT, length must be a power of two.
+	class ComplexFFT
+	{
+	public:
+		ComplexFFT() = default;
+		explicit ComplexFFT(const size_t length);
+		size_t getLength() const { return length; }
+		//inverse is not normalized.
+		void transform(Complex* data, const bool inverse) const;
+	private:
+		size_t length = 0;
+		std::vector<Complex> twiddles;
+		std::vector<size_t> bitReverse;
+	};
+
+	//2D FFT of real planes, both edges powers of two.
+	//a height x width real plane maps to height x (width / 2 + 1) complex bins,
+	//rows use the half length complex transform of the packed even/odd samples.
+	class RealFFT2D
+	{
+	public:
+		RealFFT2D() = default;
+		RealFFT2D(const size_t height, const size_t width);
+		size_t getHeight() const { return height; }
+		size_t getWidth() const { return width; }
+		size_t getSpectrumSize() const { return height * (width / 2 + 1); }
+		//plane is planeHeight x planeWidth (at most height x width) and is zero padded up to the transform size.
+		void forward(const float* plane, const size_t planeHeight, const size_t planeWidth, Complex* spectrum);
+		//writes the top-left planeHeight x planeWidth corner of the normalized inverse transform.
+		//spectrum is used as scratch.
+		void inverse(Complex* spectrum, float* plane, const size_t planeHeight, const size_t planeWidth);
+	private:
+		void forwardRow(const float* row, const size_t rowWidth, Complex* bins);
+		void inverseRow(const Complex* bins, float* row, const size_t rowWidth);
+	private:
+		size_t height = 0;
+		size_t width = 0;
+		ComplexFFT rowFFT;
+		ComplexFFT columnFFT;
+		//exp(-2*pi*i*k/width), k in [0, width/2]
+		std::vector<Complex> rowTwiddles;
+		std::vector<Complex> scratch;
+	};
+
+	inline size_t nextPowerOfTwo(const size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include "FFTConvolver.h"
+#include "EasyAssert.h"
+
+//acc += a * b, or a * conj(b)
+static void multiplyAccumulate(const EasyCNN::Complex* a, const EasyCNN::Complex* b, EasyCNN::Complex* acc,
+	const size_t size, const bool conjugate)
+{
+	const float* pa = reinterpret_cast<const float*>(a);
+	const float* pb = reinterpret_cast<const float*>(b);
+	float* pacc = reinterpret_cast<float*>(acc);
+	const float sign = conjugate ? -1.0f : 1.0f;
+	for (size_t i = 0; i < size; i++)
+	{
+		const float ar = pa[2 * i], ai = pa[2 * i + 1];
+		const float br = pb[2 * i], bi = sign * pb[2 * i + 1];
+		pacc[2 * i] += ar * br - ai * bi;
+		pacc[2 * i + 1] += ar * bi + ai * br;
+	}
+}
+
+bool EasyCNN::FFTConvolver::setShape(const size_t inChannels, const size_t outChannels, const size_t height, const size_t width,
+	const size_t kernelHeight, const size_t kernelWidth)
+{
+	easyAssert(kernelHeight <= height && kernelWidth <= width, "input is smaller than kernel.");
+	if (this->inChannels == inChannels && this->outChannels == outChannels && this->height == height && this->width == width &&
+		this->kernelHeight == kernelHeight && this->kernelWidth == kernelWidth)
+	{
+		return false;
+	}
+	this->inChannels = inChannels;
+	this->outChannels = outChannels;
+	this->height = height;
+	this->width = width;
+	this->kernelHeight = kernelHeight;
+	this->kernelWidth = kernelWidth;
+	plan = RealFFT2D(nextPowerOfTwo(height), std::max<size_t>(nextPowerOfTwo(width), 2));
+	kernelSpectra.clear();
+	return true;
+}
+
+void EasyCNN::FFTConvolver::prepareWorkspace(Workspace& workspace, ThreadPool* pool) const
+{
+	const size_t threadCount = getThreadCount(pool);
+	//a plan of another shape means the workspace was used before a setShape
+	if (!workspace.ffts.empty() && (workspace.ffts[0].getHeight() != plan.getHeight() || workspace.ffts[0].getWidth() != plan.getWidth()))
+	{
+		workspace.ffts.clear();
+		workspace.inputNumber = 0;
+	}
+	if (workspace.ffts.size() < threadCount)
+	{
+		workspace.ffts.resize(threadCount, plan);
+	}
+	workspace.accumulators.resize(threadCount);
+	for (auto& accumulator : workspace.accumulators)
+	{
+		accumulator.resize(plan.getSpectrumSize());
+	}
+}
+
+void EasyCNN::FFTConvolver::setKernel(const float* kernel)
+{
+	easyAssert(plan.getHeight() > 0, "fft shape is not set.");
+	RealFFT2D& fft = plan;
+	const size_t spectrumSize = fft.getSpectrumSize();
+	const size_t kernelPlaneSize = kernelHeight * kernelWidth;
+	kernelSpectra.resize(outChannels * inChannels * spectrumSize);
+	for (size_t i = 0; i < outChannels * inChannels; i++)
+	{
+		fft.forward(kernel + i * kernelPlaneSize, kernelHeight, kernelWidth, &kernelSpectra[0] + i * spectrumSize);
+	}
+}
+
+void EasyCNN::FFTConvolver::forward(const float* input, const size_t number, float* output, Workspace& workspace, ThreadPool* pool) const
+{
+	easyAssert(!kernelSpectra.empty(), "fft kernel is not set.");
+	prepareWorkspace(workspace, pool);
+	std::vector<RealFFT2D>& ffts = workspace.ffts;
+	std::vector<Complex>& inputSpectra = workspace.inputSpectra;
+	const size_t spectrumSize = plan.getSpectrumSize();
+	const size_t outHeight = height - kernelHeight + 1;
+	const size_t outWidth = width - kernelWidth + 1;
+	inputSpectra.resize(number * inChannels * spectrumSize);
+	parallelFor(pool, number * inChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			ffts[threadIdx].forward(input + i * height * width, height, width, &inputSpectra[0] + i * spectrumSize);
+		}
+	});
+	workspace.inputNumber = number;
+
+	//correlation is the product with the conjugated kernel spectrum, summed over input channels
+	parallelFor(pool, number * outChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		std::vector<Complex>& accumulator = workspace.accumulators[threadIdx];
+		for (size_t planeIdx = begin; planeIdx < end; planeIdx++)
+		{
+			const size_t nn = planeIdx / outChannels;
+			const size_t oc = planeIdx % outChannels;
+			std::fill(accumulator.begin(), accumulator.end(), Complex(0.0f, 0.0f));
+			for (size_t ic = 0; ic < inChannels; ic++)
+			{
+				multiplyAccumulate(&inputSpectra[0] + (nn * inChannels + ic) * spectrumSize,
+					&kernelSpectra[0] + (oc * inChannels + ic) * spectrumSize, &accumulator[0], spectrumSize, true);
+			}
+			ffts[threadIdx].inverse(&accumulator[0], output + planeIdx * outHeight * outWidth, outHeight, outWidth);
+		}
+	});
+}
+
+void EasyCNN::FFTConvolver::backward(const float* outputDiff, const size_t number, float* inputDiff, float* kernelDiff, Workspace& workspace, ThreadPool* pool) const
+{
+	easyAssert(!kernelSpectra.empty(), "fft kernel is not set.");
+	easyAssert(workspace.inputNumber == number, "backward must follow forward of the same batch.");
+	prepareWorkspace(workspace, pool);
+	std::vector<RealFFT2D>& ffts = workspace.ffts;
+	const std::vector<Complex>& inputSpectra = workspace.inputSpectra;
+	std::vector<Complex>& diffSpectra = workspace.diffSpectra;
+	const size_t spectrumSize = plan.getSpectrumSize();
+	const size_t outHeight = height - kernelHeight + 1;
+	const size_t outWidth = width - kernelWidth + 1;
+	diffSpectra.resize(number * outChannels * spectrumSize);
+	parallelFor(pool, number * outChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			ffts[threadIdx].forward(outputDiff + i * outHeight * outWidth, outHeight, outWidth, &diffSpectra[0] + i * spectrumSize);
+		}
+	});
+
+	//inputDiff : full convolution, summed over output channels
+	parallelFor(pool, number * inChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		std::vector<Complex>& accumulator = workspace.accumulators[threadIdx];
+		for (size_t planeIdx = begin; planeIdx < end; planeIdx++)
+		{
+			const size_t nn = planeIdx / inChannels;
+			const size_t ic = planeIdx % inChannels;
+			std::fill(accumulator.begin(), accumulator.end(), Complex(0.0f, 0.0f));
+			for (size_t oc = 0; oc < outChannels; oc++)
+			{
+				multiplyAccumulate(&diffSpectra[0] + (nn * outChannels + oc) * spectrumSize,
+					&kernelSpectra[0] + (oc * inChannels + ic) * spectrumSize, &accumulator[0], spectrumSize, false);
+			}
+			ffts[threadIdx].inverse(&accumulator[0], inputDiff + planeIdx * height * width, height, width);
+		}
+	});
+
+	//kernelDiff : correlation of input with outputDiff, summed over the batch in the frequency domain,
+	//every kernel plane is owned by one task so no reduction is needed
+	parallelFor(pool, outChannels * inChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		std::vector<Complex>& accumulator = workspace.accumulators[threadIdx];
+		for (size_t kernelIdx = begin; kernelIdx < end; kernelIdx++)
+		{
+			const size_t oc = kernelIdx / inChannels;
+			const size_t ic = kernelIdx % inChannels;
+			std::fill(accumulator.begin(), accumulator.end(), Complex(0.0f, 0.0f));
+			for (size_t nn = 0; nn < number; nn++)
+			{
+				multiplyAccumulate(&inputSpectra[0] + (nn * inChannels + ic) * spectrumSize,
+					&diffSpectra[0] + (nn * outChannels + oc) * spectrumSize, &accumulator[0], spectrumSize, true);
+			}
+			ffts[threadIdx].inverse(&accumulator[0], kernelDiff + kernelIdx * kernelHeight * kernelWidth, kernelHeight, kernelWidth);
+		}
+	});
+}
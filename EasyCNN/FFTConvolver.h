@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include "Configure.h"
+#include "FFT.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	//stride 1 convolution through the frequency domain.
+	//every plane is zero padded to the next power of two of the input edges, which is large enough
+	//for the circular products to match the valid correlation, the full convolution of the data gradient
+	//and the correlation of the kernel gradient without wrap around.
+	//costs O(H*W*log(H*W)) per plane plus one complex multiply-add per bin and channel pair,
+	//independent of the kernel size, so it pays off for large kernels on large planes.
+	class FFTConvolver
+	{
+	public:
+		FFTConvolver() = default;
+		//replans only when the shape changed, returns true if it did (the kernel must be set again).
+		bool setShape(const size_t inChannels, const size_t outChannels, const size_t height, const size_t width,
+			const size_t kernelHeight, const size_t kernelWidth);
+		//kernel is outChannels x inChannels x kernelHeight x kernelWidth, its spectra are cached.
+		void setKernel(const float* kernel);
+		//scratch of one forward / backward pass : a transform plan and an accumulator per pool thread, the spectra.
+		//several passes may run at the same time, each on its own workspace.
+		struct Workspace
+		{
+			std::vector<RealFFT2D> ffts;
+			//number x inChannels x spectrum
+			std::vector<Complex> inputSpectra;
+			//number x outChannels x spectrum
+			std::vector<Complex> diffSpectra;
+			std::vector<std::vector<Complex>> accumulators;
+			size_t inputNumber = 0;
+		};
+		//output = input (*) kernel, input is number x inChannels x height x width,
+		//output is number x outChannels x (height - kernelHeight + 1) x (width - kernelWidth + 1).
+		//the input spectra are kept in workspace for backward.
+		void forward(const float* input, const size_t number, float* output, Workspace& workspace, ThreadPool* pool = nullptr) const;
+		//inputDiff is the full convolution of outputDiff with the kernel,
+		//kernelDiff is the sum over the batch of input (*) outputDiff.
+		//must follow forward of the same batch on the same workspace.
+		//planes and channel pairs are spread over pool.
+		void backward(const float* outputDiff, const size_t number, float* inputDiff, float* kernelDiff, Workspace& workspace, ThreadPool* pool = nullptr) const;
+	private:
+		//one transform plan and accumulator per pool thread, copied from plan
+		void prepareWorkspace(Workspace& workspace, ThreadPool* pool) const;
+	private:
+		size_t inChannels = 0;
+		size_t outChannels = 0;
+		size_t height = 0;
+		size_t width = 0;
+		size_t kernelHeight = 0;
+		size_t kernelWidth = 0;
+		RealFFT2D plan;
+		//outChannels x inChannels x spectrum
+		std::vector<Complex> kernelSpectra;
+	};
+}
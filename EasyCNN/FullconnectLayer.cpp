@@ -1,4 +1,7 @@
+#include <algorithm>
 #include "FullconnectLayer.h"
+#include "Kernels.h"
+#include "Blas.h"
 #include "CommonTools.h"
 
 EasyCNN::FullconnectLayer::FullconnectLayer()
@@ -12,7 +15,7 @@ EasyCNN::FullconnectLayer::~FullconnectLayer()
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::FullconnectLayer, "FullconnectLayer");
-std::string EasyCNN::FullconnectLayer::getLayerType() const
+const std::string& EasyCNN::FullconnectLayer::getLayerType() const
 {
 	return layerType;
 }
@@ -34,9 +37,7 @@ std::string EasyCNN::FullconnectLayer::serializeToString() const
 	const std::string spliter = " ";
 	std::stringstream ss;
 	//layer desc
-	ss << getLayerType() << spliter
-		<< outMapSize.number << spliter << outMapSize.channels << spliter << outMapSize.width << spliter << outMapSize.height << spliter
-		<< enabledBias << spliter;
+	ss << serializeDescToString();
 	//weight
 	const auto weight = weightsData->getData().get();
 	const auto weightSize = weightsData->getSize();
@@ -61,17 +62,7 @@ void EasyCNN::FullconnectLayer::serializeFromString(const std::string content)
 {
 	std::stringstream ss(content);
 	//layer desc
-	std::string _layerType;
-	ss >> _layerType
-		>> outMapSize.number >> outMapSize.channels >> outMapSize.width >> outMapSize.height
-		>> enabledBias;
-	easyAssert(_layerType == getLayerType(), "layer type is invalidate.");
-	DataSize outputSize;
-	outputSize.number = outMapSize.number;
-	outputSize.channels = outMapSize.channels;
-	outputSize.width = outMapSize.width;
-	outputSize.height = outMapSize.height;
-	setOutpuBuckerSize(outputSize);
+	readDesc(ss);
 	solveInnerParams();
 	//weight
 	const auto weight = weightsData->getData().get();
@@ -90,6 +81,67 @@ void EasyCNN::FullconnectLayer::serializeFromString(const std::string content)
 			ss >> bias[i];
 		}
 	}
+	packedWeightsReady = false;
+}
+
+std::string EasyCNN::FullconnectLayer::serializeDescToString() const
+{
+	const std::string spliter = " ";
+	std::stringstream ss;
+	ss << getLayerType() << spliter
+		<< outMapSize.number << spliter << outMapSize.channels << spliter << outMapSize.width << spliter << outMapSize.height << spliter
+		<< enabledBias << spliter;
+	return ss.str();
+}
+
+void EasyCNN::FullconnectLayer::serializeDescFromString(const std::string content)
+{
+	std::stringstream ss(content);
+	readDesc(ss);
+}
+
+void EasyCNN::FullconnectLayer::readDesc(std::istream& is)
+{
+	std::string _layerType;
+	is >> _layerType
+		>> outMapSize.number >> outMapSize.channels >> outMapSize.width >> outMapSize.height
+		>> enabledBias;
+	easyAssert(_layerType == getLayerType(), "layer type is invalidate.");
+	DataSize outputSize;
+	outputSize.number = outMapSize.number;
+	outputSize.channels = outMapSize.channels;
+	outputSize.width = outMapSize.width;
+	outputSize.height = outMapSize.height;
+	setOutpuBuckerSize(outputSize);
+}
+
+std::vector<std::shared_ptr<EasyCNN::ParamBucket>> EasyCNN::FullconnectLayer::getParamBuckets() const
+{
+	std::vector<std::shared_ptr<ParamBucket>> buckets;
+	buckets.push_back(weightsData);
+	if (enabledBias)
+	{
+		buckets.push_back(biasData);
+	}
+	return buckets;
+}
+
+void EasyCNN::FullconnectLayer::setParamBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets)
+{
+	easyAssert(buckets.size() == (enabledBias ? 2 : 1), "param bucket count is invalidate.");
+	weightsData = buckets[0];
+	biasData = enabledBias ? buckets[1] : nullptr;
+	packedWeightsReady = false;
+}
+
+std::vector<EasyCNN::ParamSize> EasyCNN::FullconnectLayer::getGradientSizes() const
+{
+	std::vector<ParamSize> sizes(1, weightsData->getSize());
+	if (enabledBias)
+	{
+		sizes.push_back(biasData->getSize());
+	}
+	return sizes;
 }
 
 void EasyCNN::FullconnectLayer::solveInnerParams()
@@ -105,6 +157,7 @@ void EasyCNN::FullconnectLayer::solveInnerParams()
 		weightsData.reset(new ParamBucket(ParamSize(1, inputSize._3DSize()*outputSize._3DSize(), 1, 1)));
 		normal_distribution_init(weightsData->getData().get(), weightsData->getSize()._4DSize(), 0.0f, 0.1f);
 	}
+	easyAssert(weightsData->getSize() == ParamSize(1, inputSize._3DSize()*outputSize._3DSize(), 1, 1), "weight param size is invalidate.");
 	if (enabledBias)
 	{
 		if (biasData.get() == nullptr)
@@ -112,10 +165,24 @@ void EasyCNN::FullconnectLayer::solveInnerParams()
 			biasData.reset(new ParamBucket(ParamSize(1, outputSize.channels, 1, 1)));
 			const_distribution_init(biasData->getData().get(), biasData->getSize()._4DSize(), 0.0f);
 		}
+		easyAssert(biasData->getSize() == ParamSize(1, outputSize.channels, 1, 1), "bias param size is invalidate.");
 	}
 }
+//the packed weights are only used by the builtin blas
+void EasyCNN::FullconnectLayer::prepareForward()
+{
+	if (!packedWeightsReady && getBlas().getName() == "builtin")
+	{
+		const size_t inSize = getInputBucketSize()._3DSize();
+		const size_t outSize = getOutputBucketSize()._3DSize();
+		packMatrix(true, weightsData->getData().get(), inSize, inSize, outSize, packedWeights);
+		packedWeightsReady = true;
+	}
+}
+
 //FullconnectLayer forward
-void EasyCNN::FullconnectLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::FullconnectLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
@@ -124,36 +191,46 @@ void EasyCNN::FullconnectLayer::forward(const std::shared_ptr<DataBucket> prevDa
 	float* nextData = nextDataBucket->getData().get();
 	const float* weights = weightsData->getData().get();
 	const float* bias = enabledBias ? biasData->getData().get() : nullptr;
+	const size_t inSize = prevDataSize._3DSize();
+	const size_t outSize = nextDataSize._3DSize();
+
+	//a single sample is a matrix vector product, larger batches run against the packed weights when the builtin blas is in use
+	const BlasBackend& blas = getBlas();
+	const bool usePacked = nextDataSize.number > 1 && packedWeightsReady;
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	//next = prev(number x in) * weight'(in x out) + bias, threads own disjoint runs of gemmNR wide column panels
+	const size_t panels = (outSize + gemmNR - 1) / gemmNR;
+	parallelFor(pool, panels, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		const size_t nBegin = begin * gemmNR;
+		const size_t nEnd = std::min(end * gemmNR, outSize);
+		for (size_t nn = 0; nn < nextDataSize.number; nn++)
 		{
-			float sum = 0;
-
-			for (size_t pc = 0; pc < prevDataSize.channels; pc++)
+			float* row = nextData + nn * outSize;
+			if (enabledBias)
 			{
-				for (size_t ph = 0; ph < prevDataSize.height; ph++)
-				{
-					for (size_t pw = 0; pw < prevDataSize.width; pw++)
-					{
-						const size_t prevDataIdx = prevDataSize.getIndex(nn, pc, ph, pw);
-						const size_t weightsIdx = nc * prevDataSize._3DSize() + prevDataSize.getIndex(pc, ph, pw);
-						sum += prevData[prevDataIdx] * weights[weightsIdx];
-					}
-				}
+				std::copy(bias + nBegin, bias + nEnd, row + nBegin);
 			}
-
-			if (enabledBias)
+			else
 			{
-				const size_t biasIdx = nc;
-				sum += bias[biasIdx];
+				std::fill(row + nBegin, row + nEnd, 0.0f);
 			}
-
-			const size_t nextDataIdx = nn * nextDataSize._3DSize() + nc;
-			nextData[nextDataIdx] = sum;
 		}
-	}
+		if (nextDataSize.number == 1)
+		{
+			blas.gemv(false, nEnd - nBegin, inSize, 1.0f, weights + nBegin * inSize, inSize, prevData, 1.0f, nextData + nBegin);
+		}
+		else if (usePacked)
+		{
+			sgemmPacked(false, nextDataSize.number, nBegin, nEnd, 1.0f, prevData, inSize, packedWeights, 1.0f, nextData, outSize);
+		}
+		else
+		{
+			blas.gemm(false, true, nextDataSize.number, nEnd - nBegin, inSize,
+				1.0f, prevData, inSize, weights + nBegin * inSize, inSize,
+				1.0f, nextData + nBegin, outSize);
+		}
+	});
 }
 
 void EasyCNN::FullconnectLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
@@ -165,11 +242,9 @@ void EasyCNN::FullconnectLayer::backward(std::shared_ptr<DataBucket> prevDataBuc
 	const ParamSize weightSize = weightsData->getSize();
 	const ParamSize biasSize = enabledBias ? biasData->getSize() : ParamSize();
 	const float* prevData = prevDataBucket->getData().get();
-	const float* nextData = nextDataBucket->getData().get();
 	const float* nextDiff = nextDiffBucket->getData().get();
 
-	float* weight = weightsData->getData().get();
-	float* bias = enabledBias ? biasData->getData().get() : nullptr;
+	const float* weight = weightsData->getData().get();
 	easyAssert(nextDataSize.width == 1 && nextDataSize.height == 1, "use channel only!");
 	easyAssert(weightSize._4DSize() == prevDataSize._3DSize() * nextDataSize._3DSize(), "weight size is invalidate!");
 
@@ -178,85 +253,70 @@ void EasyCNN::FullconnectLayer::backward(std::shared_ptr<DataBucket> prevDataBuc
 		easyAssert(biasSize._4DSize() == nextDataSize._3DSize(), "bias size is invalidate!");
 	}
 
-	//update prevDiff data
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
+	//prevDiff and params' diff buckets come from the network's arenas
+	const std::shared_ptr<DataBucket> prevDiffBucket = getDiffBucket(prevDataSize, DataLayout::NCHW);
 	float* prevDiff = prevDiffBucket->getData().get();
+	float* weightDiff = getGradientBucket(0)->getData().get();
+	const size_t inSize = prevDataSize._3DSize();
+	const size_t outSize = nextDiffSize._3DSize();
 
-	//calculate current inner diff && multiply next diff
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	ThreadPool* pool = getThreadPool();
+	const size_t threads = getThreadCount(pool);
+	const BlasBackend& blas = getBlas();
+	//prevDiff(number x in) = nextDiff(number x out) * weight(out x in), threads split the input columns
+	const size_t inTiles = std::min(threads, inSize);
+	parallelFor(pool, inTiles, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t pc = 0; pc < prevDiffSize.channels; pc++)
+		for (size_t tile = begin; tile < end; tile++)
 		{
-			for (size_t ph = 0; ph < prevDiffSize.height; ph++)
-			{
-				for (size_t pw = 0; pw < prevDiffSize.width; pw++)
-				{
-					const size_t prevDiffIdx = prevDiffSize.getIndex(pn, pc, ph, pw);
-
-					for (size_t nc = 0; nc < nextDiffSize.channels; nc++)
-					{
-						const size_t weightIdx = nc * prevDataSize._3DSize() + prevDataSize.getIndex(pc, ph, pw);
-						const size_t nextDiffIdx = pn * nextDiffSize._3DSize() + nc;
-						prevDiff[prevDiffIdx] += weight[weightIdx] * nextDiff[nextDiffIdx];
-					}
-				}
-			}
+			const size_t cBegin = inSize * tile / inTiles;
+			const size_t cEnd = inSize * (tile + 1) / inTiles;
+			blas.gemm(false, false, prevDataSize.number, cEnd - cBegin, outSize,
+				1.0f, nextDiff, outSize, weight + cBegin, inSize,
+				0.0f, prevDiff + cBegin, inSize);
 		}
-	}
-
-	//update this layer's param
-	//update weight
-	//get weight diff
-	std::shared_ptr<ParamBucket> weightDiffBucket(std::make_shared<ParamBucket>(weightSize));
-	weightDiffBucket->fillData(0.0f);
-	float* weightDiff = weightDiffBucket->getData().get();
+	});
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	//weightDiff(out x in) = nextDiff'(out x number) * prev(number x in), threads split the output rows
+	const size_t outTiles = std::min(threads, outSize);
+	parallelFor(pool, outTiles, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		for (size_t tile = begin; tile < end; tile++)
 		{
-			const size_t nextDiffIdx = nn * nextDiffSize._3DSize() + nc;
-
-			for (size_t prevData3DIdx = 0; prevData3DIdx < prevDataSize._3DSize(); prevData3DIdx++)
-			{
-				const size_t weightDiffIdx = nc * prevDiffSize._3DSize() + prevData3DIdx;
-				const size_t prevDataIdx = nn * prevDataSize._3DSize() + prevData3DIdx;
-				weightDiff[weightDiffIdx] += prevData[prevDataIdx] * nextDiff[nextDiffIdx];
-			}
+			const size_t rBegin = outSize * tile / outTiles;
+			const size_t rEnd = outSize * (tile + 1) / outTiles;
+			blas.gemm(true, false, rEnd - rBegin, inSize, nextDataSize.number,
+				1.0f, nextDiff + rBegin, outSize, prevData, inSize,
+				0.0f, weightDiff + rBegin * inSize, inSize);
 		}
-	}
+	});
 
-	//apply change
-	for (size_t weightIdx = 0; weightIdx < weightSize._4DSize(); weightIdx++)
-	{
-		weight[weightIdx] -= getLearningRate() * weightDiff[weightIdx] / nextDataSize.number;
-	}
-
-	//update bias
+	//bias diff
 	if (enabledBias)
 	{
 		//get bias diff
-		std::shared_ptr<ParamBucket> biasDiffBucket(std::make_shared<ParamBucket>(biasSize));
-		biasDiffBucket->fillData(0.0f);
-		float* biasDiff = biasDiffBucket->getData().get();
+		float* biasDiff = getGradientBucket(1)->getData().get();
+		prepareThreadBuffers(pool, threadBiasDiffs, biasSize._4DSize());
 
-		for (size_t nn = 0; nn < nextDataSize.number; nn++)
+		parallelFor(pool, nextDataSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
 		{
-			for (size_t biasDiffIdx = 0; biasDiffIdx < biasSize._3DSize(); biasDiffIdx++)
+			float* localDiff = &threadBiasDiffs[threadIdx][0];
+			for (size_t nn = begin; nn < end; nn++)
 			{
-				biasDiff[biasDiffIdx] += 1.0f * nextDiff[nn*biasSize._3DSize() + biasDiffIdx];
+				for (size_t biasDiffIdx = 0; biasDiffIdx < biasSize._3DSize(); biasDiffIdx++)
+				{
+					localDiff[biasDiffIdx] += 1.0f * nextDiff[nn*biasSize._3DSize() + biasDiffIdx];
+				}
 			}
-		}
-
-		//apply change
-		for (size_t biasDiffIdx = 0; biasDiffIdx < biasSize._4DSize(); biasDiffIdx++)
-		{
-			bias[biasDiffIdx] -= getLearningRate() * biasDiff[biasDiffIdx] / nextDataSize.number;
-		}
+		});
+		reduceThreadBuffers(pool, threadBiasDiffs, biasDiff);
 	}
 
 	//chain goto previous layer
 	nextDiffBucket = prevDiffBucket;
-}
\ No newline at end of file
+}
+
+void EasyCNN::FullconnectLayer::onParamsChanged()
+{
+	packedWeightsReady = false;
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <iosfwd>
+#include <vector>
 #include "Configure.h"
 #include "Layer.h"
+#include "Gemm.h"
 
 namespace EasyCNN
 {
@@ -16,15 +19,31 @@ namespace EasyCNN
 	protected:
 		virtual std::string serializeToString() const override;
 		virtual void serializeFromString(const std::string content) override;
+		virtual std::string serializeDescToString() const override;
+		virtual void serializeDescFromString(const std::string content) override;
+		virtual std::vector<std::shared_ptr<ParamBucket>> getParamBuckets() const override;
+		virtual void setParamBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets) override;
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
+		virtual const std::string& getLayerType() const override;
 		virtual void solveInnerParams() override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual std::vector<ParamSize> getGradientSizes() const override;
+		virtual void prepareForward() override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
+		virtual void onParamsChanged() override;
+	private:
+		//layer desc, shared by the text and the binary model
+		void readDesc(std::istream& is);
 	private:
 		ParamSize outMapSize;
 		std::shared_ptr<ParamBucket> weightsData;
 		bool enabledBias = false;
 		std::shared_ptr<ParamBucket> biasData;
+		//weights packed as the B operand of X * W', rebuilt by prepareForward after every weight change
+		PackedMatrix packedWeights;
+		bool packedWeightsReady = false;
+		//per thread partial gradients
+		std::vector<std::vector<float>> threadBiasDiffs;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <vector>
+#include "Gemm.h"
+#include "Kernels.h"
+#include "EasyAssert.h"
+
+//blocking parameters.
+//a (MR x KC) panel of A and a (KC x NR) panel of B stay in L1,
+//the packed (MC x KC) block of A stays in L2 while it sweeps over a (KC x NC) block of B.
+//the MR x NR register tile is the micro kernel's, one variant per isa.
+static const size_t MR = EasyCNN::gemmMR;
+static const size_t NR = EasyCNN::gemmNR;
+static const size_t MC = 120;
+static const size_t KC = 256;
+static const size_t NC = 2048;
+
+//pack op(A)[mc x kc] into MR-row panels, k major inside each panel.
+//rows beyond mc are zero padded so the micro kernel never needs edge handling.
+static void packA(const bool transA, const float* A, const size_t lda,
+	const size_t mc, const size_t kc, float* packed)
+{
+	for (size_t ip = 0; ip < mc; ip += MR)
+	{
+		const size_t mr = std::min(MR, mc - ip);
+		for (size_t k = 0; k < kc; k++)
+		{
+			for (size_t i = 0; i < mr; i++)
+			{
+				*packed++ = transA ? A[k * lda + ip + i] : A[(ip + i) * lda + k];
+			}
+			for (size_t i = mr; i < MR; i++)
+			{
+				*packed++ = 0.0f;
+			}
+		}
+	}
+}
+
+//pack op(B)[kc x nc] into NR-column panels, k major inside each panel.
+static void packB(const bool transB, const float* B, const size_t ldb,
+	const size_t kc, const size_t nc, float* packed)
+{
+	for (size_t jp = 0; jp < nc; jp += NR)
+	{
+		const size_t nr = std::min(NR, nc - jp);
+		for (size_t k = 0; k < kc; k++)
+		{
+			if (!transB && nr == NR)
+			{
+				const float* src = B + k * ldb + jp;
+				for (size_t j = 0; j < NR; j++)
+				{
+					packed[j] = src[j];
+				}
+				packed += NR;
+				continue;
+			}
+			for (size_t j = 0; j < nr; j++)
+			{
+				*packed++ = transB ? B[(jp + j) * ldb + k] : B[k * ldb + jp + j];
+			}
+			for (size_t j = nr; j < NR; j++)
+			{
+				*packed++ = 0.0f;
+			}
+		}
+	}
+}
+
+//C(MxN) *= beta, every K block accumulates afterwards
+static void scaleC(const size_t M, const size_t N, const float beta, float* C, const size_t ldc)
+{
+	for (size_t i = 0; i < M; i++)
+	{
+		float* c = C + i * ldc;
+		if (beta == 0.0f)
+		{
+			std::fill(c, c + N, 0.0f);
+		}
+		else if (beta != 1.0f)
+		{
+			for (size_t j = 0; j < N; j++)
+			{
+				c[j] *= beta;
+			}
+		}
+	}
+}
+
+//C(M x nc) += alpha * op(A)(M x kc) * packed panels of B (kc x nc), A is packed MC rows at a time.
+static void multiplyPanels(const bool transA, const size_t M, const size_t kc, const size_t nc,
+	const float alpha, const float* A, const size_t lda, const float* packedB, float* C, const size_t ldc)
+{
+	thread_local std::vector<float> packedA;
+	packedA.resize(std::max(packedA.size(), ((MC + MR - 1) / MR) * MR * KC));
+	const auto microKernel = EasyCNN::getKernels().gemmMicroKernel;
+	for (size_t ic = 0; ic < M; ic += MC)
+	{
+		const size_t mc = std::min(MC, M - ic);
+		const float* Ablock = transA ? A + ic : A + ic * lda;
+		packA(transA, Ablock, lda, mc, kc, &packedA[0]);
+		for (size_t jr = 0; jr < nc; jr += NR)
+		{
+			const size_t nr = std::min(NR, nc - jr);
+			const float* b = packedB + jr * kc;
+			for (size_t ir = 0; ir < mc; ir += MR)
+			{
+				const size_t mr = std::min(MR, mc - ir);
+				const float* a = &packedA[0] + ir * kc;
+				microKernel(kc, alpha, a, b, C + (ic + ir) * ldc + jr, ldc, mr, nr);
+			}
+		}
+	}
+}
+
+void EasyCNN::sgemm(const bool transA, const bool transB,
+	const size_t M, const size_t N, const size_t K,
+	const float alpha, const float* A, const size_t lda,
+	const float* B, const size_t ldb,
+	const float beta, float* C, const size_t ldc)
+{
+	if (M == 0 || N == 0)
+	{
+		return;
+	}
+	scaleC(M, N, beta, C, ldc);
+	if (K == 0 || alpha == 0.0f)
+	{
+		return;
+	}
+
+	//packing buffers are kept per thread and only grow
+	thread_local std::vector<float> packedB;
+	packedB.resize(std::max(packedB.size(), ((NC + NR - 1) / NR) * NR * KC));
+
+	for (size_t jc = 0; jc < N; jc += NC)
+	{
+		const size_t nc = std::min(NC, N - jc);
+		for (size_t pc = 0; pc < K; pc += KC)
+		{
+			const size_t kc = std::min(KC, K - pc);
+			const float* Bblock = transB ? B + jc * ldb + pc : B + pc * ldb + jc;
+			packB(transB, Bblock, ldb, kc, nc, &packedB[0]);
+			const float* Ablock = transA ? A + pc * lda : A + pc;
+			multiplyPanels(transA, M, kc, nc, alpha, Ablock, lda, &packedB[0], C + jc, ldc);
+		}
+	}
+}
+
+void EasyCNN::packMatrix(const bool transB, const float* B, const size_t ldb,
+	const size_t K, const size_t N, PackedMatrix& packed)
+{
+	packed.rows = K;
+	packed.cols = N;
+	packed.paddedCols = (N + NR - 1) / NR * NR;
+	packed.data.resize(K * packed.paddedCols);
+	for (size_t pc = 0; pc < K; pc += KC)
+	{
+		const size_t kc = std::min(KC, K - pc);
+		const float* Bblock = transB ? B + pc : B + pc * ldb;
+		packB(transB, Bblock, ldb, kc, N, &packed.data[0] + pc * packed.paddedCols);
+	}
+}
+
+void EasyCNN::sgemmPacked(const bool transA, const size_t M, const size_t nBegin, const size_t nEnd,
+	const float alpha, const float* A, const size_t lda,
+	const PackedMatrix& B,
+	const float beta, float* C, const size_t ldc)
+{
+	easyAssert(nBegin % NR == 0 && nBegin <= nEnd && nEnd <= B.cols, "packed column range is invalidate.");
+	if (M == 0 || nBegin == nEnd)
+	{
+		return;
+	}
+	scaleC(M, nEnd - nBegin, beta, C + nBegin, ldc);
+	if (B.rows == 0 || alpha == 0.0f)
+	{
+		return;
+	}
+	for (size_t pc = 0; pc < B.rows; pc += KC)
+	{
+		const size_t kc = std::min(KC, B.rows - pc);
+		const float* panels = &B.data[0] + pc * B.paddedCols + nBegin * kc;
+		const float* Ablock = transA ? A + pc * lda : A + pc;
+		multiplyPanels(transA, M, kc, nEnd - nBegin, alpha, Ablock, lda, panels, C + nBegin, ldc);
+	}
+}
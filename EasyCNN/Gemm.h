@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//single precision general matrix multiply, all matrices are row major.
+	//C(MxN) = alpha * op(A)(MxK) * op(B)(KxN) + beta * C
+	//op(X) is X or X' depends on transX.
+	void sgemm(const bool transA, const bool transB,
+		const size_t M, const size_t N, const size_t K,
+		const float alpha, const float* A, const size_t lda,
+		const float* B, const size_t ldb,
+		const float beta, float* C, const size_t ldc);
+
+	//op(B) packed once for operands that are multiplied many times, e.g. layer weights.
+	//same panels sgemm builds on the fly : KC row blocks one after another, each cut into NR column panels.
+	struct PackedMatrix
+	{
+		size_t rows = 0;
+		size_t cols = 0;
+		size_t paddedCols = 0;
+		std::vector<float> data;
+	};
+	void packMatrix(const bool transB, const float* B, const size_t ldb,
+		const size_t K, const size_t N, PackedMatrix& packed);
+	//columns [nBegin, nEnd) of C(MxN) = alpha * op(A)(MxK) * B(KxN) + beta * C, B packed by packMatrix.
+	//nBegin must be a multiple of gemmNR, so threads can split the columns without repacking.
+	void sgemmPacked(const bool transA, const size_t M, const size_t nBegin, const size_t nEnd,
+		const float alpha, const float* A, const size_t lda,
+		const PackedMatrix& B,
+		const float beta, float* C, const size_t ldc);
+}
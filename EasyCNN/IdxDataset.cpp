@@ -0,0 +1,70 @@
+#include <algorithm>
+#include "IdxDataset.h"
+#include "EasyLogger.h"
+
+std::shared_ptr<EasyCNN::IdxDataset> EasyCNN::IdxDataset::open(const std::string& imagesPath, const std::string& labelsPath)
+{
+	std::string error;
+	std::shared_ptr<IdxDataset> dataset(new IdxDataset());
+	dataset->images = IdxFile::open(imagesPath, &error);
+	if (dataset->images.get() == nullptr)
+	{
+		logCritical("can't open IDX images : %s.", error.c_str());
+		return nullptr;
+	}
+	dataset->labels = IdxFile::open(labelsPath, &error);
+	if (dataset->labels.get() == nullptr)
+	{
+		logCritical("can't open IDX labels : %s.", error.c_str());
+		return nullptr;
+	}
+	const std::vector<size_t>& dimensions = dataset->images->getDimensions();
+	if (dimensions.size() == 3)
+	{
+		dataset->sampleSize = DataSize(1, 1, dimensions[2], dimensions[1]);
+	}
+	else if (dimensions.size() == 4)
+	{
+		dataset->sampleSize = DataSize(1, dimensions[1], dimensions[3], dimensions[2]);
+	}
+	else
+	{
+		logCritical("IDX images %s must have 3 or 4 dimensions.", imagesPath.c_str());
+		return nullptr;
+	}
+	if (dataset->labels->getDimensions().size() != 1 || dataset->labels->getItemCount() != dataset->images->getItemCount())
+	{
+		logCritical("IDX labels %s don't match the images.", labelsPath.c_str());
+		return nullptr;
+	}
+	//the only pass over the labels, a few bytes per sample
+	const uint8_t* labelData = dataset->labels->getData();
+	const size_t count = dataset->labels->getItemCount();
+	dataset->classCount = count == 0 ? 0 : (size_t)*std::max_element(labelData, labelData + count) + 1;
+	return dataset;
+}
+
+size_t EasyCNN::IdxDataset::getSampleCount() const
+{
+	return images->getItemCount();
+}
+
+EasyCNN::DataSize EasyCNN::IdxDataset::getSampleSize() const
+{
+	return sampleSize;
+}
+
+size_t EasyCNN::IdxDataset::getClassCount() const
+{
+	return classCount;
+}
+
+const uint8_t* EasyCNN::IdxDataset::getImage(const size_t index) const
+{
+	return images->getItem(index);
+}
+
+size_t EasyCNN::IdxDataset::getLabel(const size_t index) const
+{
+	return labels->getData()[index];
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "Configure.h"
+#include "Dataset.h"
+#include "IdxFile.h"
+
+namespace EasyCNN
+{
+	//an IDX image file (count x height x width, or count x channels x height x width) and its IDX label file,
+	//both mapped. opening reads the headers and the labels, images are read from the page cache as they are used
+	//and are never copied : getImage points into the mapping, images are getSampleSize()._3DSize() bytes apart.
+	class IdxDataset : public Dataset
+	{
+	public:
+		//null (the reason logged) when a file can't be opened or they don't match
+		static std::shared_ptr<IdxDataset> open(const std::string& imagesPath, const std::string& labelsPath);
+		virtual size_t getSampleCount() const override;
+		virtual DataSize getSampleSize() const override;
+		//the largest label + 1
+		virtual size_t getClassCount() const override;
+		virtual const uint8_t* getImage(const size_t index) const override;
+		virtual size_t getLabel(const size_t index) const override;
+		//every image, one after another
+		inline const uint8_t* getImages() const{ return images->getData(); }
+		inline const uint8_t* getLabels() const{ return labels->getData(); }
+	private:
+		IdxDataset() = default;
+	private:
+		std::shared_ptr<IdxFile> images;
+		std::shared_ptr<IdxFile> labels;
+		DataSize sampleSize;
+		size_t classCount = 0;
+	};
+}
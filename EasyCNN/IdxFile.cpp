@@ -0,0 +1,73 @@
+#include "IdxFile.h"
+
+//the only item type the datasets use
+static const uint8_t unsignedByteType = 0x08;
+
+static uint32_t readBigEndian(const uint8_t* bytes)
+{
+	return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static std::shared_ptr<EasyCNN::IdxFile> fail(std::string* error, const std::string& reason)
+{
+	if (error != nullptr)
+	{
+		*error = reason;
+	}
+	return nullptr;
+}
+
+std::shared_ptr<EasyCNN::IdxFile> EasyCNN::IdxFile::open(const std::string& path, std::string* error)
+{
+	const std::shared_ptr<MappedFile> file = MappedFile::open(path);
+	if (file.get() == nullptr)
+	{
+		return fail(error, "can't map " + path);
+	}
+	const uint8_t* bytes = (const uint8_t*)file->getData();
+	const size_t fileSize = file->getSize();
+	if (fileSize < 4 || bytes[0] != 0 || bytes[1] != 0)
+	{
+		return fail(error, path + " has no IDX magic number");
+	}
+	if (bytes[2] != unsignedByteType)
+	{
+		return fail(error, path + " doesn't hold unsigned bytes");
+	}
+	const size_t dimensionCount = bytes[3];
+	const size_t headerSize = 4 + 4 * dimensionCount;
+	if (dimensionCount == 0 || fileSize < headerSize)
+	{
+		return fail(error, path + " has an invalid header");
+	}
+	//every product is checked against the data's size before it's taken, nothing overflows.
+	//a file without items may have any item size
+	const size_t dataSize = fileSize - headerSize;
+	std::shared_ptr<IdxFile> result(new IdxFile());
+	result->itemSize = 1;
+	for (size_t i = 0; i < dimensionCount; i++)
+	{
+		const size_t dimension = readBigEndian(bytes + 4 + 4 * i);
+		result->dimensions.push_back(dimension);
+		if (i == 0)
+		{
+			continue;
+		}
+		if (dimension == 0)
+		{
+			return fail(error, path + " has an empty dimension");
+		}
+		if (result->dimensions[0] > 0 && result->itemSize > dataSize / dimension)
+		{
+			return fail(error, path + " is shorter than its header says");
+		}
+		result->itemSize *= dimension;
+	}
+	if (result->dimensions[0] > dataSize / result->itemSize)
+	{
+		return fail(error, path + " is shorter than its header says");
+	}
+	result->file = file;
+	result->data = bytes + headerSize;
+	return result;
+}
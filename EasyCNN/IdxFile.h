@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Configure.h"
+#include "MappedFile.h"
+
+namespace EasyCNN
+{
+	//an IDX file (the mnist format) of unsigned bytes, mapped : big endian header 0 0 0x08 dimensionCount,
+	//one uint32 per dimension, then the items one after another. the header is checked once by open,
+	//items are views into the mapping, nothing is read or copied before they are touched.
+	//only depends on MappedFile, other projects can build it on its own.
+	class IdxFile
+	{
+	public:
+		//null when the file can't be mapped or isn't an unsigned byte IDX file holding all of its items,
+		//the reason goes to error when it's given
+		static std::shared_ptr<IdxFile> open(const std::string& path, std::string* error = nullptr);
+		//the first dimension counts the items, the others make up an item
+		inline const std::vector<size_t>& getDimensions() const{ return dimensions; }
+		inline size_t getItemCount() const{ return dimensions[0]; }
+		inline size_t getItemSize() const{ return itemSize; }
+		//item i starts at getData() + i * getItemSize()
+		inline const uint8_t* getData() const{ return data; }
+		inline const uint8_t* getItem(const size_t index) const{ return data + index * itemSize; }
+	private:
+		IdxFile() = default;
+		IdxFile(const IdxFile&) = delete;
+		IdxFile& operator=(const IdxFile&) = delete;
+	private:
+		std::shared_ptr<MappedFile> file;
+		std::vector<size_t> dimensions;
+		size_t itemSize = 0;
+		const uint8_t* data = nullptr;
+	};
+}
@@ -0,0 +1,63 @@
+#include "Im2Col.h"
+
+void EasyCNN::im2col(const float* im, const size_t channels, const size_t height, const size_t width,
+	const size_t kernelHeight, const size_t kernelWidth, const size_t heightStep, const size_t widthStep,
+	const size_t outHeight, const size_t outWidth, float* col, const size_t ldc)
+{
+	for (size_t c = 0; c < channels; c++)
+	{
+		const float* plane = im + c * height * width;
+		for (size_t kh = 0; kh < kernelHeight; kh++)
+		{
+			for (size_t kw = 0; kw < kernelWidth; kw++)
+			{
+				float* row = col + ((c * kernelHeight + kh) * kernelWidth + kw) * ldc;
+				for (size_t oh = 0; oh < outHeight; oh++)
+				{
+					const float* src = plane + (oh * heightStep + kh) * width + kw;
+					float* dst = row + oh * outWidth;
+					if (widthStep == 1)
+					{
+						for (size_t ow = 0; ow < outWidth; ow++)
+						{
+							dst[ow] = src[ow];
+						}
+					}
+					else
+					{
+						for (size_t ow = 0; ow < outWidth; ow++)
+						{
+							dst[ow] = src[ow * widthStep];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void EasyCNN::col2im(const float* col, const size_t ldc, const size_t channels, const size_t height, const size_t width,
+	const size_t kernelHeight, const size_t kernelWidth, const size_t heightStep, const size_t widthStep,
+	const size_t outHeight, const size_t outWidth, float* im)
+{
+	for (size_t c = 0; c < channels; c++)
+	{
+		float* plane = im + c * height * width;
+		for (size_t kh = 0; kh < kernelHeight; kh++)
+		{
+			for (size_t kw = 0; kw < kernelWidth; kw++)
+			{
+				const float* row = col + ((c * kernelHeight + kh) * kernelWidth + kw) * ldc;
+				for (size_t oh = 0; oh < outHeight; oh++)
+				{
+					float* dst = plane + (oh * heightStep + kh) * width + kw;
+					const float* src = row + oh * outWidth;
+					for (size_t ow = 0; ow < outWidth; ow++)
+					{
+						dst[ow * widthStep] += src[ow];
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//unfold one CHW image into a (channels*kernelHeight*kernelWidth) x (outHeight*outWidth) matrix.
+	//row (c,kh,kw) is written at col + row * ldc, so several images can share one matrix side by side.
+	void im2col(const float* im, const size_t channels, const size_t height, const size_t width,
+		const size_t kernelHeight, const size_t kernelWidth, const size_t heightStep, const size_t widthStep,
+		const size_t outHeight, const size_t outWidth, float* col, const size_t ldc);
+	//fold a column matrix laid out as im2col writes it back onto one CHW image.
+	//overlapped windows are summed, im must be zero filled by the caller.
+	void col2im(const float* col, const size_t ldc, const size_t channels, const size_t height, const size_t width,
+		const size_t kernelHeight, const size_t kernelWidth, const size_t heightStep, const size_t widthStep,
+		const size_t outHeight, const size_t outWidth, float* im);
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include "InferenceServer.h"
+#include "Allocator.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "NetWork.h"
+
+//values below 8 get a bucket each, then every power of two is split into 8
+static const size_t subBucketBits = 3;
+static const size_t subBuckets = (size_t)1 << subBucketBits;
+static const size_t histogramBuckets = subBuckets + (64 - subBucketBits) * subBuckets;
+
+//LatencyHistogram
+EasyCNN::LatencyHistogram::LatencyHistogram()
+	:buckets(histogramBuckets, 0)
+{
+}
+
+size_t EasyCNN::LatencyHistogram::getBucketIndex(const uint64_t microseconds)
+{
+	if (microseconds < subBuckets)
+	{
+		return (size_t)microseconds;
+	}
+	size_t exponent = subBucketBits;
+	while (exponent < 63 && (microseconds >> (exponent + 1)) != 0)
+	{
+		exponent++;
+	}
+	const size_t sub = (size_t)(microseconds >> (exponent - subBucketBits)) & (subBuckets - 1);
+	return subBuckets + (exponent - subBucketBits) * subBuckets + sub;
+}
+
+uint64_t EasyCNN::LatencyHistogram::getBucketUpperBound(const size_t index)
+{
+	if (index < subBuckets)
+	{
+		return index;
+	}
+	const size_t shift = (index - subBuckets) / subBuckets;
+	const uint64_t sub = (index - subBuckets) % subBuckets;
+	return ((subBuckets + sub + 1) << shift) - 1;
+}
+
+void EasyCNN::LatencyHistogram::record(const uint64_t microseconds)
+{
+	buckets[getBucketIndex(microseconds)]++;
+	count++;
+	sum += microseconds;
+	maxValue = std::max(maxValue, microseconds);
+}
+
+void EasyCNN::LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	sum += other.sum;
+	maxValue = std::max(maxValue, other.maxValue);
+}
+
+void EasyCNN::LatencyHistogram::reset()
+{
+	std::fill(buckets.begin(), buckets.end(), 0);
+	count = 0;
+	sum = 0;
+	maxValue = 0;
+}
+
+double EasyCNN::LatencyHistogram::getMean() const
+{
+	return count == 0 ? 0.0 : (double)sum / count;
+}
+
+uint64_t EasyCNN::LatencyHistogram::getPercentile(const double percentile) const
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+	const double clamped = std::min(100.0, std::max(0.0, percentile));
+	const uint64_t rank = std::max((uint64_t)1, (uint64_t)std::ceil(clamped / 100.0 * count));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			return std::min(getBucketUpperBound(i), maxValue);
+		}
+	}
+	return maxValue;
+}
+
+std::string EasyCNN::LatencyHistogram::toString() const
+{
+	char line[256] = { 0 };
+	snprintf(line, sizeof(line), "count %llu mean %.1fus p50 %lluus p90 %lluus p99 %lluus p99.9 %lluus max %lluus",
+		(unsigned long long)count, getMean(), (unsigned long long)getPercentile(50), (unsigned long long)getPercentile(90),
+		(unsigned long long)getPercentile(99), (unsigned long long)getPercentile(99.9), (unsigned long long)maxValue);
+	return line;
+}
+
+//InferenceServer
+EasyCNN::InferenceServer::InferenceServer(NetWork& network, const InferenceServerConfig& config)
+	:config(config)
+{
+	logVerbose("InferenceServer constructed.");
+	easyAssert(config.maxBatchSize > 0 && config.workerCount > 0, "batch size and worker count can't be 0.");
+	//contexts are built here, one after another : building one prepares the shared layers
+	for (size_t i = 0; i < config.workerCount; i++)
+	{
+		contexts.push_back(std::make_shared<ExecutionContext>(network, config.threadsPerWorker, config.pinThreads));
+	}
+	inputSize = contexts.front()->getInputSize();
+	outputSize = contexts.front()->getOutputSize();
+	stats.batchSizes.assign(config.maxBatchSize + 1, 0);
+	statsStart = Clock::now();
+	for (size_t i = 0; i < config.workerCount; i++)
+	{
+		workers.push_back(std::thread(&InferenceServer::workerLoop, this, i));
+	}
+}
+
+EasyCNN::InferenceServer::~InferenceServer()
+{
+	stop();
+	logVerbose("InferenceServer destructed.");
+}
+
+std::future<std::vector<float>> EasyCNN::InferenceServer::submit(const float* sample)
+{
+	easyAssert(sample != nullptr, "sample can't be null.");
+	Request request;
+	request.input.assign(sample, sample + inputSize._3DSize());
+	std::future<std::vector<float>> result = request.result.get_future();
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		spaceCondition.wait(lock, [this](){ return stopping || config.maxQueuedSamples == 0 || queue.size() < config.maxQueuedSamples; });
+		if (stopping)
+		{
+			request.result.set_exception(std::make_exception_ptr(std::runtime_error("inference server is stopped.")));
+			return result;
+		}
+		request.submitTime = Clock::now();
+		queue.push_back(std::move(request));
+		//workers only care about a new head (its wait starts) and a full batch
+		if (queue.size() == 1 || queue.size() >= config.maxBatchSize)
+		{
+			requestCondition.notify_all();
+		}
+	}
+	return result;
+}
+
+void EasyCNN::InferenceServer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	requestCondition.notify_all();
+	spaceCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+	workers.clear();
+}
+
+EasyCNN::InferenceStats EasyCNN::InferenceServer::getStats() const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	InferenceStats result = stats;
+	const double seconds = std::chrono::duration<double>(Clock::now() - statsStart).count();
+	result.meanBatchSize = result.batches == 0 ? 0.0 : (double)result.samples / result.batches;
+	result.samplesPerSecond = seconds > 0 ? result.samples / seconds : 0.0;
+	return result;
+}
+
+void EasyCNN::InferenceServer::resetStats()
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	const size_t batchSizeCount = stats.batchSizes.size();
+	stats = InferenceStats();
+	stats.batchSizes.assign(batchSizeCount, 0);
+	statsStart = Clock::now();
+}
+
+bool EasyCNN::InferenceServer::takeBatch(std::vector<Request>& batch)
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+	for (;;)
+	{
+		requestCondition.wait(lock, [this](){ return stopping || !queue.empty(); });
+		if (queue.empty())
+		{
+			return false;
+		}
+		//the head's deadline, cut short by a full batch or by stop (the rest is drained without waiting)
+		const Clock::time_point deadline = queue.front().submitTime + std::chrono::microseconds(config.maxWaitMicroseconds);
+		requestCondition.wait_until(lock, deadline, [this](){ return stopping || queue.size() >= config.maxBatchSize; });
+		//another worker may have taken the batch meanwhile
+		if (!queue.empty())
+		{
+			break;
+		}
+	}
+	const size_t number = std::min(queue.size(), config.maxBatchSize);
+	for (size_t i = 0; i < number; i++)
+	{
+		batch.push_back(std::move(queue.front()));
+		queue.pop_front();
+	}
+	if (!queue.empty())
+	{
+		requestCondition.notify_all();
+	}
+	spaceCondition.notify_all();
+	return true;
+}
+
+void EasyCNN::InferenceServer::workerLoop(const size_t workerIdx)
+{
+	ExecutionContext& context = *contexts[workerIdx];
+	//samples are gathered into one aligned buffer, the context reads it in place
+	const std::shared_ptr<float> batchInput = allocateFloats(config.maxBatchSize * inputSize._3DSize());
+	std::vector<Request> batch;
+	batch.reserve(config.maxBatchSize);
+	while (takeBatch(batch))
+	{
+		runBatch(context, batchInput.get(), batch);
+		batch.clear();
+	}
+}
+
+void EasyCNN::InferenceServer::runBatch(ExecutionContext& context, float* batchInput, std::vector<Request>& batch)
+{
+	const size_t inputSampleSize = inputSize._3DSize();
+	const size_t outputSampleSize = outputSize._3DSize();
+	const Clock::time_point startTime = Clock::now();
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		std::copy(batch[i].input.begin(), batch[i].input.end(), batchInput + i * inputSampleSize);
+	}
+	std::shared_ptr<DataBucket> output;
+	try
+	{
+		output = context.testBatch(batchInput, batch.size());
+	}
+	catch (...)
+	{
+		//an assert callback that throws lands here, every sample of the batch gets it
+		for (auto& request : batch)
+		{
+			request.result.set_exception(std::current_exception());
+		}
+		return;
+	}
+	const Clock::time_point endTime = Clock::now();
+	//stats first : a caller that got its result sees its batch in getStats
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.samples += batch.size();
+		stats.batches++;
+		stats.batchSizes[batch.size()]++;
+		stats.computeLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+		for (const auto& request : batch)
+		{
+			stats.queueLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(startTime - request.submitTime).count());
+			stats.totalLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(endTime - request.submitTime).count());
+		}
+	}
+	const float* outputData = output->getData().get();
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		const float* sampleOutput = outputData + i * outputSampleSize;
+		batch[i].result.set_value(std::vector<float>(sampleOutput, sampleOutput + outputSampleSize));
+	}
+}
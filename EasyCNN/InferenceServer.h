@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "ExecutionContext.h"
+
+namespace EasyCNN
+{
+	class NetWork;
+
+	struct InferenceServerConfig
+	{
+		//a batch runs as soon as it holds maxBatchSize samples, or maxWaitMicroseconds after its first sample
+		//arrived, whichever comes first. maxWaitMicroseconds 0 runs whatever is queued right away.
+		size_t maxBatchSize = 16;
+		size_t maxWaitMicroseconds = 2000;
+		//every worker owns an ExecutionContext with threadsPerWorker threads and runs one batch at a time
+		size_t workerCount = 1;
+		size_t threadsPerWorker = 1;
+		bool pinThreads = false;
+		//submit blocks while this many samples are queued, 0 never blocks
+		size_t maxQueuedSamples = 0;
+	};
+
+	//latencies in microseconds. 8 log spaced buckets per power of two, a percentile is the upper bound
+	//of its bucket and at most 1/8 above the true value. recording is a few integer ops, nothing is allocated.
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+		void record(const uint64_t microseconds);
+		void merge(const LatencyHistogram& other);
+		void reset();
+		uint64_t getCount() const{ return count; }
+		uint64_t getMax() const{ return maxValue; }
+		double getMean() const;
+		//percentile in [0, 100]
+		uint64_t getPercentile(const double percentile) const;
+		//count, mean, p50, p90, p99, p99.9 and max on one line
+		std::string toString() const;
+	private:
+		static size_t getBucketIndex(const uint64_t microseconds);
+		static uint64_t getBucketUpperBound(const size_t index);
+	private:
+		std::vector<uint64_t> buckets;
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t maxValue = 0;
+	};
+
+	struct InferenceStats
+	{
+		uint64_t samples = 0;
+		uint64_t batches = 0;
+		double meanBatchSize = 0;
+		//completed samples per second since the server started or the stats were reset
+		double samplesPerSecond = 0;
+		//per sample : submit to batch start, and submit to result
+		LatencyHistogram queueLatency;
+		LatencyHistogram totalLatency;
+		//per batch : the batch's testBatch
+		LatencyHistogram computeLatency;
+		//batchSizes[n] batches ran with n samples
+		std::vector<uint64_t> batchSizes;
+	};
+
+	//an in process batching front end for a test phase network : samples submitted one at a time from any
+	//thread are queued, gathered into batches (see InferenceServerConfig) and run by the workers, each
+	//sample's output comes back through its own future. the network must not change while the server lives.
+	class InferenceServer
+	{
+	public:
+		explicit InferenceServer(NetWork& network, const InferenceServerConfig& config = InferenceServerConfig());
+		virtual ~InferenceServer();
+		const InferenceServerConfig& getConfig() const{ return config; }
+		//one sample's input / output, NCHW
+		DataSize getInputSize() const{ return inputSize; }
+		DataSize getOutputSize() const{ return outputSize; }
+		//sample holds getInputSize()._3DSize() floats and is copied before submit returns.
+		//the future gets getOutputSize()._3DSize() floats, or an exception when the server stopped before running it.
+		std::future<std::vector<float>> submit(const float* sample);
+		//runs every sample already queued, then stops the workers. later submits fail, stopping twice is fine.
+		void stop();
+		InferenceStats getStats() const;
+		void resetStats();
+	private:
+		typedef std::chrono::steady_clock Clock;
+		struct Request
+		{
+			std::vector<float> input;
+			std::promise<std::vector<float>> result;
+			Clock::time_point submitTime;
+		};
+		InferenceServer(const InferenceServer&) = delete;
+		InferenceServer& operator=(const InferenceServer&) = delete;
+		void workerLoop(const size_t workerIdx);
+		//false once the server stopped and the queue is empty
+		bool takeBatch(std::vector<Request>& batch);
+		void runBatch(ExecutionContext& context, float* batchInput, std::vector<Request>& batch);
+	private:
+		InferenceServerConfig config;
+		DataSize inputSize;
+		DataSize outputSize;
+		std::vector<std::shared_ptr<ExecutionContext>> contexts;
+		std::vector<std::thread> workers;
+		//queue
+		std::mutex queueMutex;
+		std::condition_variable requestCondition;
+		std::condition_variable spaceCondition;
+		std::deque<Request> queue;
+		bool stopping = false;
+		//stats
+		mutable std::mutex statsMutex;
+		InferenceStats stats;
+		Clock::time_point statsStart;
+	};
+}
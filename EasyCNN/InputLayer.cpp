@@ -12,14 +12,18 @@ EasyCNN::InputLayer::~InputLayer()
 
 DEFINE_LAYER_TYPE(EasyCNN::InputLayer, "InputLayer");
 
-std::string EasyCNN::InputLayer::getLayerType() const
+const std::string& EasyCNN::InputLayer::getLayerType() const
 {
 	return layerType;
 }
 
-void EasyCNN::InputLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::InputLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
-	prevDataBucket->cloneTo(*nextDataBucket);
+	if (nextDataBucket != prevDataBucket)
+	{
+		prevDataBucket->cloneTo(*nextDataBucket);
+	}
 }
 
 void EasyCNN::InputLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
@@ -13,8 +13,11 @@ namespace EasyCNN
 		virtual ~InputLayer();
 	protected:
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		virtual const std::string& getLayerType() const override;
+		//in a network the input layer's output is its input, forward and backward cost nothing
+		virtual bool isInPlaceCapable() const override{ return true; }
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "Kernels.h"
+
+//generic kernels : plain scalar code, the reference every isa variant is checked against
+static float genericDot(const float* x, const float* y, const size_t n)
+{
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++)
+	{
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+static void genericAxpy(const size_t n, const float alpha, const float* x, float* y)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] += alpha * x[i];
+	}
+}
+
+//one accumulator row per MR keeps the inner loop a plain NR-wide update every compiler vectorizes.
+static void genericGemmMicroKernel(const size_t kc, const float alpha, const float* a, const float* b,
+	float* C, const size_t ldc, const size_t mr, const size_t nr)
+{
+	static const size_t MR = EasyCNN::gemmMR;
+	static const size_t NR = EasyCNN::gemmNR;
+	float acc0[NR] = { 0 }, acc1[NR] = { 0 }, acc2[NR] = { 0 };
+	float acc3[NR] = { 0 }, acc4[NR] = { 0 }, acc5[NR] = { 0 };
+	for (size_t k = 0; k < kc; k++)
+	{
+		const float* bk = b + k * NR;
+		const float* ak = a + k * MR;
+		const float a0 = ak[0], a1 = ak[1], a2 = ak[2], a3 = ak[3], a4 = ak[4], a5 = ak[5];
+		for (size_t j = 0; j < NR; j++)
+		{
+			const float bj = bk[j];
+			acc0[j] += a0 * bj;
+			acc1[j] += a1 * bj;
+			acc2[j] += a2 * bj;
+			acc3[j] += a3 * bj;
+			acc4[j] += a4 * bj;
+			acc5[j] += a5 * bj;
+		}
+	}
+	const float* acc[MR] = { acc0, acc1, acc2, acc3, acc4, acc5 };
+	for (size_t i = 0; i < mr; i++)
+	{
+		float* c = C + i * ldc;
+		for (size_t j = 0; j < nr; j++)
+		{
+			c[j] += alpha * acc[i][j];
+		}
+	}
+}
+
+static void genericMaxPoolRow(const float* in, const EasyCNN::PoolWindow& window, float* out, float* maxIdx)
+{
+	const size_t lanes = window.lanes;
+	for (size_t ow = 0; ow < window.outWidth; ow++)
+	{
+		float* result = out + ow * lanes;
+		float* idx = maxIdx ? maxIdx + ow * lanes : nullptr;
+		std::fill(result, result + lanes, 0.0f);
+		if (idx)
+		{
+			std::fill(idx, idx + lanes, 0.0f);
+		}
+		for (size_t ph = 0; ph < window.windowHeight; ph++)
+		{
+			for (size_t pw = 0; pw < window.windowWidth; pw++)
+			{
+				const float* src = in + (ph * window.inWidth + ow * window.widthStep + pw) * lanes;
+				const float windowIdx = (float)(ph * window.windowWidth + pw);
+				for (size_t lane = 0; lane < lanes; lane++)
+				{
+					if (result[lane] < src[lane])
+					{
+						result[lane] = src[lane];
+						if (idx)
+						{
+							idx[lane] = windowIdx;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static void genericMeanPoolRow(const float* in, const EasyCNN::PoolWindow& window, float* out)
+{
+	const size_t lanes = window.lanes;
+	const size_t windowSize = window.windowHeight * window.windowWidth;
+	for (size_t ow = 0; ow < window.outWidth; ow++)
+	{
+		float* result = out + ow * lanes;
+		std::fill(result, result + lanes, 0.0f);
+		for (size_t ph = 0; ph < window.windowHeight; ph++)
+		{
+			for (size_t pw = 0; pw < window.windowWidth; pw++)
+			{
+				const float* src = in + (ph * window.inWidth + ow * window.widthStep + pw) * lanes;
+				for (size_t lane = 0; lane < lanes; lane++)
+				{
+					result[lane] += src[lane];
+				}
+			}
+		}
+		for (size_t lane = 0; lane < lanes; lane++)
+		{
+			result[lane] /= windowSize;
+		}
+	}
+}
+
+//f(x)=max(x,0)
+static void genericRelu(const float* x, float* y, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] = std::max(x[i], 0.0f);
+	}
+}
+
+//f'(x)=0.01(x<=0),1(x>0)
+//note : too small df is not suitable.
+static void genericReluBackward(const float* y, const float* dy, float* dx, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		dx[i] = (y[i] <= 0.0f ? 0.01f : 1.0f) * dy[i];
+	}
+}
+
+//f(x)=1/(1+e^(-x))
+static void genericSigmoid(const float* x, float* y, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] = 1.0f / (1.0f + std::exp(-1.0f * x[i]));
+	}
+}
+
+//f'(x) = f(x)(1-f(x))
+static void genericSigmoidBackward(const float* y, const float* dy, float* dx, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		dx[i] = y[i] * (1.0f - y[i]) * dy[i];
+	}
+}
+
+//f(x)=(e^x-e^(-x))/(e^x+e^(-x))
+static void genericTanh(const float* x, float* y, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] = std::tanh(x[i]);
+	}
+}
+
+//f'(x)=1-f(x)^2
+static void genericTanhBackward(const float* y, const float* dy, float* dx, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		dx[i] = (1.0f - y[i] * y[i]) * dy[i];
+	}
+}
+
+static void genericSoftmax(const float* x, float* y, const size_t n)
+{
+	//step1 : find max value
+	float maxVal = x[0];
+	for (size_t i = 0; i < n; i++)
+	{
+		maxVal = std::max(maxVal, x[i]);
+	}
+	//step2 : sum
+	float sum = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] = std::exp(x[i] - maxVal);
+		sum += y[i];
+	}
+	//step3 : div
+	for (size_t i = 0; i < n; i++)
+	{
+		y[i] = y[i] / sum;
+	}
+}
+
+static void genericU8ToFloat(const uint8_t* src, float* dst, const size_t n, const float scale)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		dst[i] = (float)src[i] * scale;
+	}
+}
+
+static void genericMomentumUpdate(float* params, float* velocity, const float* gradients, const size_t n, const EasyCNN::MomentumStep& step)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		const float g = gradients[i] * step.gradientScale;
+		velocity[i] = step.momentum * velocity[i] + g;
+		params[i] -= step.learningRate * (step.nesterov ? g + step.momentum * velocity[i] : velocity[i]);
+	}
+}
+
+static void genericAdamUpdate(float* params, float* m, float* v, const float* gradients, const size_t n, const EasyCNN::AdamStep& step)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		const float g = gradients[i] * step.gradientScale;
+		m[i] = step.beta1 * m[i] + (1.0f - step.beta1) * g;
+		v[i] = step.beta2 * v[i] + (1.0f - step.beta2) * g * g;
+		params[i] -= step.stepSize * m[i] / (std::sqrt(v[i]) + step.epsilon);
+	}
+}
+
+void EasyCNN::fillGenericKernels(KernelTable& table)
+{
+	table.isa = CpuIsa::Generic;
+	table.dot = genericDot;
+	table.axpy = genericAxpy;
+	table.gemmMicroKernel = genericGemmMicroKernel;
+	table.maxPoolRow = genericMaxPoolRow;
+	table.meanPoolRow = genericMeanPoolRow;
+	table.relu = genericRelu;
+	table.reluBackward = genericReluBackward;
+	table.sigmoid = genericSigmoid;
+	table.sigmoidBackward = genericSigmoidBackward;
+	table.tanh = genericTanh;
+	table.tanhBackward = genericTanhBackward;
+	table.softmax = genericSoftmax;
+	table.u8ToFloat = genericU8ToFloat;
+	table.momentumUpdate = genericMomentumUpdate;
+	table.adamUpdate = genericAdamUpdate;
+}
+
+static bool buildKernelTable(const EasyCNN::CpuIsa isa, EasyCNN::KernelTable& table)
+{
+	if (!EasyCNN::isCpuIsaSupported(isa))
+	{
+		return false;
+	}
+	EasyCNN::fillGenericKernels(table);
+	switch (isa)
+	{
+	case EasyCNN::CpuIsa::SSE4:
+		return EasyCNN::fillSSE4Kernels(table);
+	case EasyCNN::CpuIsa::AVX2:
+		return EasyCNN::fillAVX2Kernels(table);
+	case EasyCNN::CpuIsa::AVX512:
+		return EasyCNN::fillAVX512Kernels(table);
+	case EasyCNN::CpuIsa::NEON:
+		return EasyCNN::fillNEONKernels(table);
+	default:
+		return true;
+	}
+}
+
+//EASYCNN_ISA pins the variant, e.g. to rule the vector kernels out on one machine of a fleet.
+//otherwise the best one, falling back while the host or the build lacks it
+static EasyCNN::KernelTable buildStartupKernelTable()
+{
+	const EasyCNN::CpuIsa candidates[] = { EasyCNN::CpuIsa::AVX512, EasyCNN::CpuIsa::AVX2,
+		EasyCNN::CpuIsa::SSE4, EasyCNN::CpuIsa::NEON, EasyCNN::CpuIsa::Generic };
+	EasyCNN::KernelTable table;
+	const char* name = std::getenv("EASYCNN_ISA");
+	if (name != nullptr)
+	{
+		for (const EasyCNN::CpuIsa isa : candidates)
+		{
+			if (std::strcmp(name, EasyCNN::getCpuIsaName(isa)) == 0 && buildKernelTable(isa, table))
+			{
+				return table;
+			}
+		}
+	}
+	for (const EasyCNN::CpuIsa isa : candidates)
+	{
+		if (buildKernelTable(isa, table))
+		{
+			return table;
+		}
+	}
+	return table;
+}
+
+static EasyCNN::KernelTable& getKernelTable()
+{
+	static EasyCNN::KernelTable table = buildStartupKernelTable();
+	return table;
+}
+
+const EasyCNN::KernelTable& EasyCNN::getKernels()
+{
+	return getKernelTable();
+}
+
+bool EasyCNN::setKernelIsa(const CpuIsa isa)
+{
+	KernelTable table;
+	if (!buildKernelTable(isa, table))
+	{
+		return false;
+	}
+	getKernelTable() = table;
+	return true;
+}
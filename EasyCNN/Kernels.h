@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Configure.h"
+#include "CpuFeatures.h"
+
+namespace EasyCNN
+{
+	//sgemm register tile : the micro kernel computes an gemmMR x gemmNR block of C
+	static const size_t gemmMR = 6;
+	static const size_t gemmNR = 16;
+
+	//one output row of one channel block of a pooling window walk.
+	//input and output pixels are lanes floats wide (1 for NCHW, the block for NCHWc / NHWC).
+	struct PoolWindow
+	{
+		size_t inWidth;
+		size_t lanes;
+		size_t windowHeight;
+		size_t windowWidth;
+		size_t widthStep;
+		size_t outWidth;
+	};
+
+	//one optimizer step. the gradients are sums over a batch, scaled by gradientScale (1 / samples) first
+	struct MomentumStep
+	{
+		float learningRate;
+		float gradientScale;
+		float momentum;
+		//look ahead : the step uses the gradient plus momentum times the updated velocity
+		bool nesterov;
+	};
+
+	struct AdamStep
+	{
+		//learning rate and epsilon with the bias corrections of this step folded in
+		float stepSize;
+		float epsilon;
+		float gradientScale;
+		float beta1;
+		float beta2;
+	};
+
+	//hot primitives, one entry per isa variant, picked once from the host's cpu features.
+	//every variant computes the same thing, the vector ones within a few ulp of the generic one.
+	struct KernelTable
+	{
+		CpuIsa isa;
+		//sum x[i] * y[i]
+		float(*dot)(const float* x, const float* y, const size_t n);
+		//y += alpha * x
+		void(*axpy)(const size_t n, const float alpha, const float* x, float* y);
+		//C[mr x nr] += alpha * a * b, a is a packed gemmMR x kc panel (k major), b a packed kc x gemmNR panel
+		void(*gemmMicroKernel)(const size_t kc, const float alpha, const float* a, const float* b,
+			float* C, const size_t ldc, const size_t mr, const size_t nr);
+		//in is the window's top row. max starts from 0 and keeps the first maximum, maxIdx (may be null) gets its window index
+		void(*maxPoolRow)(const float* in, const PoolWindow& window, float* out, float* maxIdx);
+		void(*meanPoolRow)(const float* in, const PoolWindow& window, float* out);
+		//y = f(x), and dx = f'(y) * dy from the forward output y
+		void(*relu)(const float* x, float* y, const size_t n);
+		void(*reluBackward)(const float* y, const float* dy, float* dx, const size_t n);
+		void(*sigmoid)(const float* x, float* y, const size_t n);
+		void(*sigmoidBackward)(const float* y, const float* dy, float* dx, const size_t n);
+		void(*tanh)(const float* x, float* y, const size_t n);
+		void(*tanhBackward)(const float* y, const float* dy, float* dx, const size_t n);
+		//y = exp(x - max(x)) / sum
+		void(*softmax)(const float* x, float* y, const size_t n);
+		//dst = src * scale
+		void(*u8ToFloat)(const uint8_t* src, float* dst, const size_t n, const float scale);
+		//v = momentum * v + g, params -= learningRate * v (nesterov : learningRate * (g + momentum * v))
+		void(*momentumUpdate)(float* params, float* velocity, const float* gradients, const size_t n, const MomentumStep& step);
+		//m = beta1 * m + (1 - beta1) * g, v = beta2 * v + (1 - beta2) * g * g, params -= stepSize * m / (sqrt(v) + epsilon)
+		void(*adamUpdate)(float* params, float* m, float* v, const float* gradients, const size_t n, const AdamStep& step);
+	};
+
+	//the table of the best isa both the host and the build support,
+	//or of EASYCNN_ISA (generic / sse4 / avx2 / avx512 / neon) when it's one of them.
+	const KernelTable& getKernels();
+	//switches every later getKernels() to isa, returns false (and changes nothing) if the host or the build lacks it.
+	//not thread safe, call it before running a network.
+	bool setKernelIsa(const CpuIsa isa);
+
+	//per isa table builders, each overwrites every entry.
+	//a variant this build can't target (other architecture, old compiler) returns false and leaves the table untouched.
+	void fillGenericKernels(KernelTable& table);
+	bool fillSSE4Kernels(KernelTable& table);
+	bool fillAVX2Kernels(KernelTable& table);
+	bool fillAVX512Kernels(KernelTable& table);
+	bool fillNEONKernels(KernelTable& table);
+}
@@ -0,0 +1,87 @@
+#include "Kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EASYCNN_BUILD_AVX2 1
+#endif
+
+#ifdef EASYCNN_BUILD_AVX2
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+#include <immintrin.h>
+#include "KernelsSimd.h"
+
+namespace
+{
+	//haswell class : 6 x 2 ymm accumulators per micro kernel, 3 of 16 registers left for a and b
+	struct AVX2Vector
+	{
+		typedef __m256 Type;
+		static const size_t width = 8;
+		static const size_t gemmColumns = 2;
+		static inline Type zero() { return _mm256_setzero_ps(); }
+		static inline Type set1(const float value) { return _mm256_set1_ps(value); }
+		static inline Type load(const float* src) { return _mm256_loadu_ps(src); }
+		static inline void store(float* dst, const Type value) { _mm256_storeu_ps(dst, value); }
+		static inline Type loadU8(const uint8_t* src)
+		{
+			return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src)));
+		}
+		static inline Type loadEven(const float* src)
+		{
+			//[a0 a2 b0 b2 | a4 a6 b4 b6] -> [a0 a2 a4 a6 b0 b2 b4 b6]
+			const __m256 mixed = _mm256_shuffle_ps(_mm256_loadu_ps(src), _mm256_loadu_ps(src + 8), _MM_SHUFFLE(2, 0, 2, 0));
+			return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mixed), _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+		static inline Type add(const Type a, const Type b) { return _mm256_add_ps(a, b); }
+		static inline Type sub(const Type a, const Type b) { return _mm256_sub_ps(a, b); }
+		static inline Type mul(const Type a, const Type b) { return _mm256_mul_ps(a, b); }
+		static inline Type div(const Type a, const Type b) { return _mm256_div_ps(a, b); }
+		static inline Type sqrt(const Type a) { return _mm256_sqrt_ps(a); }
+		static inline Type fmadd(const Type a, const Type b, const Type c) { return _mm256_fmadd_ps(a, b, c); }
+		static inline Type max(const Type a, const Type b) { return _mm256_max_ps(a, b); }
+		static inline Type min(const Type a, const Type b) { return _mm256_min_ps(a, b); }
+		static inline Type round(const Type a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline Type selectGreater(const Type x, const Type y, const Type a, const Type b)
+		{
+			return _mm256_blendv_ps(b, a, _mm256_cmp_ps(x, y, _CMP_GT_OQ));
+		}
+		static inline Type pow2i(const Type n)
+		{
+			return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+		}
+		static inline float reduceAdd(const Type a)
+		{
+			__m128 half = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+			half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+			return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+		}
+		static inline float reduceMax(const Type a)
+		{
+			__m128 half = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+			half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+			return _mm_cvtss_f32(_mm_max_ss(half, _mm_shuffle_ps(half, half, 1)));
+		}
+	};
+}
+
+bool EasyCNN::fillAVX2Kernels(KernelTable& table)
+{
+	simd::fillTable<AVX2Vector>(table, CpuIsa::AVX2);
+	return true;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#else
+bool EasyCNN::fillAVX2Kernels(KernelTable& table)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,77 @@
+#include "Kernels.h"
+
+//avx512 intrinsics need visual studio 2017
+#if (defined(__x86_64__) && defined(__GNUC__)) || (defined(_M_X64) && defined(_MSC_VER) && _MSC_VER >= 1910)
+#define EASYCNN_BUILD_AVX512 1
+#endif
+
+#ifdef EASYCNN_BUILD_AVX512
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+#endif
+#include <immintrin.h>
+#include "KernelsSimd.h"
+
+namespace
+{
+	//skylake-avx512 class : one zmm covers the 16 micro kernel columns, 6 accumulators
+	struct AVX512Vector
+	{
+		typedef __m512 Type;
+		static const size_t width = 16;
+		static const size_t gemmColumns = 1;
+		static inline Type zero() { return _mm512_setzero_ps(); }
+		static inline Type set1(const float value) { return _mm512_set1_ps(value); }
+		static inline Type load(const float* src) { return _mm512_loadu_ps(src); }
+		static inline void store(float* dst, const Type value) { _mm512_storeu_ps(dst, value); }
+		static inline Type loadU8(const uint8_t* src)
+		{
+			return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)src)));
+		}
+		static inline Type loadEven(const float* src)
+		{
+			const __m512i evens = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+			return _mm512_permutex2var_ps(_mm512_loadu_ps(src), evens, _mm512_loadu_ps(src + 16));
+		}
+		static inline Type add(const Type a, const Type b) { return _mm512_add_ps(a, b); }
+		static inline Type sub(const Type a, const Type b) { return _mm512_sub_ps(a, b); }
+		static inline Type mul(const Type a, const Type b) { return _mm512_mul_ps(a, b); }
+		static inline Type div(const Type a, const Type b) { return _mm512_div_ps(a, b); }
+		static inline Type sqrt(const Type a) { return _mm512_sqrt_ps(a); }
+		static inline Type fmadd(const Type a, const Type b, const Type c) { return _mm512_fmadd_ps(a, b, c); }
+		static inline Type max(const Type a, const Type b) { return _mm512_max_ps(a, b); }
+		static inline Type min(const Type a, const Type b) { return _mm512_min_ps(a, b); }
+		static inline Type round(const Type a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline Type selectGreater(const Type x, const Type y, const Type a, const Type b)
+		{
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, y, _CMP_GT_OQ), b, a);
+		}
+		static inline Type pow2i(const Type n)
+		{
+			return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23));
+		}
+		static inline float reduceAdd(const Type a) { return _mm512_reduce_add_ps(a); }
+		static inline float reduceMax(const Type a) { return _mm512_reduce_max_ps(a); }
+	};
+}
+
+bool EasyCNN::fillAVX512Kernels(KernelTable& table)
+{
+	simd::fillTable<AVX512Vector>(table, CpuIsa::AVX512);
+	return true;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#else
+bool EasyCNN::fillAVX512Kernels(KernelTable& table)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,61 @@
+#include "Kernels.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define EASYCNN_BUILD_NEON 1
+#endif
+
+#ifdef EASYCNN_BUILD_NEON
+#include <arm_neon.h>
+#include "KernelsSimd.h"
+
+namespace
+{
+	//aarch64 : 32 q registers, 6 x 4 accumulators cover the 16 micro kernel columns in one pass
+	struct NEONVector
+	{
+		typedef float32x4_t Type;
+		static const size_t width = 4;
+		static const size_t gemmColumns = 4;
+		static inline Type zero() { return vdupq_n_f32(0.0f); }
+		static inline Type set1(const float value) { return vdupq_n_f32(value); }
+		static inline Type load(const float* src) { return vld1q_f32(src); }
+		static inline void store(float* dst, const Type value) { vst1q_f32(dst, value); }
+		static inline Type loadU8(const uint8_t* src)
+		{
+			const uint32x4_t values = { src[0], src[1], src[2], src[3] };
+			return vcvtq_f32_u32(values);
+		}
+		static inline Type loadEven(const float* src) { return vld2q_f32(src).val[0]; }
+		static inline Type add(const Type a, const Type b) { return vaddq_f32(a, b); }
+		static inline Type sub(const Type a, const Type b) { return vsubq_f32(a, b); }
+		static inline Type mul(const Type a, const Type b) { return vmulq_f32(a, b); }
+		static inline Type div(const Type a, const Type b) { return vdivq_f32(a, b); }
+		static inline Type sqrt(const Type a) { return vsqrtq_f32(a); }
+		static inline Type fmadd(const Type a, const Type b, const Type c) { return vfmaq_f32(c, a, b); }
+		static inline Type max(const Type a, const Type b) { return vmaxq_f32(a, b); }
+		static inline Type min(const Type a, const Type b) { return vminq_f32(a, b); }
+		static inline Type round(const Type a) { return vrndnq_f32(a); }
+		static inline Type selectGreater(const Type x, const Type y, const Type a, const Type b)
+		{
+			return vbslq_f32(vcgtq_f32(x, y), a, b);
+		}
+		static inline Type pow2i(const Type n)
+		{
+			return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23));
+		}
+		static inline float reduceAdd(const Type a) { return vaddvq_f32(a); }
+		static inline float reduceMax(const Type a) { return vmaxvq_f32(a); }
+	};
+}
+
+bool EasyCNN::fillNEONKernels(KernelTable& table)
+{
+	simd::fillTable<NEONVector>(table, CpuIsa::NEON);
+	return true;
+}
+#else
+bool EasyCNN::fillNEONKernels(KernelTable& table)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,87 @@
+#include <cstring>
+#include "Kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EASYCNN_BUILD_SSE4 1
+#endif
+
+#ifdef EASYCNN_BUILD_SSE4
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+#include <smmintrin.h>
+#include "KernelsSimd.h"
+
+namespace
+{
+	//no fma before avx2, 2 x 4 columns per micro kernel pass keeps the 12 accumulators in the 16 xmm registers
+	struct SSE4Vector
+	{
+		typedef __m128 Type;
+		static const size_t width = 4;
+		static const size_t gemmColumns = 2;
+		static inline Type zero() { return _mm_setzero_ps(); }
+		static inline Type set1(const float value) { return _mm_set1_ps(value); }
+		static inline Type load(const float* src) { return _mm_loadu_ps(src); }
+		static inline void store(float* dst, const Type value) { _mm_storeu_ps(dst, value); }
+		static inline Type loadU8(const uint8_t* src)
+		{
+			//one 32 bit move, the byte loop stays a byte loop
+			int packed = 0;
+			memcpy(&packed, src, sizeof(packed));
+			return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+		}
+		static inline Type loadEven(const float* src)
+		{
+			return _mm_shuffle_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _MM_SHUFFLE(2, 0, 2, 0));
+		}
+		static inline Type add(const Type a, const Type b) { return _mm_add_ps(a, b); }
+		static inline Type sub(const Type a, const Type b) { return _mm_sub_ps(a, b); }
+		static inline Type mul(const Type a, const Type b) { return _mm_mul_ps(a, b); }
+		static inline Type div(const Type a, const Type b) { return _mm_div_ps(a, b); }
+		static inline Type sqrt(const Type a) { return _mm_sqrt_ps(a); }
+		static inline Type fmadd(const Type a, const Type b, const Type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static inline Type max(const Type a, const Type b) { return _mm_max_ps(a, b); }
+		static inline Type min(const Type a, const Type b) { return _mm_min_ps(a, b); }
+		static inline Type round(const Type a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline Type selectGreater(const Type x, const Type y, const Type a, const Type b)
+		{
+			return _mm_blendv_ps(b, a, _mm_cmpgt_ps(x, y));
+		}
+		static inline Type pow2i(const Type n)
+		{
+			return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+		}
+		static inline float reduceAdd(const Type a)
+		{
+			const __m128 pairs = _mm_add_ps(a, _mm_movehl_ps(a, a));
+			return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+		static inline float reduceMax(const Type a)
+		{
+			const __m128 pairs = _mm_max_ps(a, _mm_movehl_ps(a, a));
+			return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+	};
+}
+
+bool EasyCNN::fillSSE4Kernels(KernelTable& table)
+{
+	simd::fillTable<SSE4Vector>(table, CpuIsa::SSE4);
+	return true;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#else
+bool EasyCNN::fillSSE4Kernels(KernelTable& table)
+{
+	return false;
+}
+#endif
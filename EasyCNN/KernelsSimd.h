@@ -0,0 +1,626 @@
+#pragma once
+
+#include "Kernels.h"
+
+//vector kernel bodies, written once against a traits type V :
+//  V::Type, V::width (floats per vector), V::gemmColumns (vectors per micro kernel row and pass)
+//  zero, set1, load, store (unaligned), loadU8 (width bytes), loadEven (floats 0, 2, .., 2 * width - 2)
+//  add, sub, mul, div, sqrt, fmadd(a, b, c) = a * b + c, max, min, round (to nearest)
+//  selectGreater(x, y, a, b) = x > y ? a : b
+//  pow2i(n) = 2^n for integer valued n
+//  reduceAdd, reduceMax
+//include it from an isa translation unit only, after that unit's target pragma.
+//everything here has internal linkage and uses no standard library code,
+//so no isa specific instruction leaks into code the generic path shares.
+namespace
+{
+	namespace simd
+	{
+		using EasyCNN::PoolWindow;
+		using EasyCNN::gemmMR;
+		using EasyCNN::gemmNR;
+
+		//cephes style expf : 2^n * exp(r), |r| <= ln2 / 2, inputs clamped to the normal range
+		template <typename V>
+		inline typename V::Type exp(typename V::Type x)
+		{
+			typedef typename V::Type T;
+			x = V::min(V::max(x, V::set1(-87.3f)), V::set1(88.3f));
+			const T n = V::round(V::mul(x, V::set1(1.44269504f)));
+			T r = V::fmadd(n, V::set1(-0.693359375f), x);
+			r = V::fmadd(n, V::set1(2.12194440e-4f), r);
+			T p = V::set1(1.9875691500e-4f);
+			p = V::fmadd(p, r, V::set1(1.3981999507e-3f));
+			p = V::fmadd(p, r, V::set1(8.3334519073e-3f));
+			p = V::fmadd(p, r, V::set1(4.1665795894e-2f));
+			p = V::fmadd(p, r, V::set1(1.6666665459e-1f));
+			p = V::fmadd(p, r, V::set1(5.0000001201e-1f));
+			const T y = V::fmadd(p, V::mul(r, r), V::add(r, V::set1(1.0f)));
+			return V::mul(y, V::pow2i(n));
+		}
+
+		//odd polynomial below 0.625, 1 - 2 / (e^2|x| + 1) above, sign restored
+		template <typename V>
+		inline typename V::Type tanh(const typename V::Type x)
+		{
+			typedef typename V::Type T;
+			const T zero = V::zero();
+			const T absX = V::max(x, V::sub(zero, x));
+			const T z = V::mul(x, x);
+			T p = V::set1(-5.70498872745e-3f);
+			p = V::fmadd(p, z, V::set1(2.06390887954e-2f));
+			p = V::fmadd(p, z, V::set1(-5.37397155531e-2f));
+			p = V::fmadd(p, z, V::set1(1.33314422036e-1f));
+			p = V::fmadd(p, z, V::set1(-3.33332819422e-1f));
+			const T small = V::fmadd(V::mul(p, z), x, x);
+			const T one = V::set1(1.0f);
+			const T e = exp<V>(V::add(absX, absX));
+			const T largeAbs = V::sub(one, V::div(V::set1(2.0f), V::add(e, one)));
+			const T large = V::selectGreater(zero, x, V::sub(zero, largeAbs), largeAbs);
+			return V::selectGreater(V::set1(0.625f), absX, small, large);
+		}
+
+		template <typename V>
+		float dot(const float* x, const float* y, const size_t n)
+		{
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			T acc0 = V::zero();
+			T acc1 = V::zero();
+			size_t i = 0;
+			for (; i + 2 * W <= n; i += 2 * W)
+			{
+				acc0 = V::fmadd(V::load(x + i), V::load(y + i), acc0);
+				acc1 = V::fmadd(V::load(x + i + W), V::load(y + i + W), acc1);
+			}
+			for (; i + W <= n; i += W)
+			{
+				acc0 = V::fmadd(V::load(x + i), V::load(y + i), acc0);
+			}
+			float sum = V::reduceAdd(V::add(acc0, acc1));
+			for (; i < n; i++)
+			{
+				sum += x[i] * y[i];
+			}
+			return sum;
+		}
+
+		template <typename V>
+		void axpy(const size_t n, const float alpha, const float* x, float* y)
+		{
+			const size_t W = V::width;
+			const typename V::Type alphaV = V::set1(alpha);
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				V::store(y + i, V::fmadd(alphaV, V::load(x + i), V::load(y + i)));
+			}
+			for (; i < n; i++)
+			{
+				y[i] += alpha * x[i];
+			}
+		}
+
+		//acc[c] += a * b[c]
+		template <typename V, size_t COLS>
+		inline void fmaddRow(typename V::Type* acc, const typename V::Type a, const typename V::Type* b)
+		{
+			for (size_t c = 0; c < COLS; c++)
+			{
+				acc[c] = V::fmadd(a, b[c], acc[c]);
+			}
+		}
+
+		//C[row, col..] += alpha * acc
+		template <typename V, size_t COLS>
+		inline void storeRow(const typename V::Type* acc, const float alpha, float* row, const size_t j0, const size_t nr)
+		{
+			const size_t W = V::width;
+			for (size_t c = 0; c < COLS; c++)
+			{
+				const size_t col = j0 + c * W;
+				if (col + W <= nr)
+				{
+					V::store(row + col, V::fmadd(V::set1(alpha), acc[c], V::load(row + col)));
+				}
+				else if (col < nr)
+				{
+					float tail[V::width];
+					V::store(tail, acc[c]);
+					for (size_t j = 0; col + j < nr; j++)
+					{
+						row[col + j] += alpha * tail[j];
+					}
+				}
+			}
+		}
+
+		//gemmMR rows x (width * gemmColumns) columns of accumulators per pass, gemmNR / (width * gemmColumns) passes.
+		//the rows are spelled out, compilers keep short fixed arrays in registers only when every index is a constant.
+		template <typename V>
+		void gemmMicroKernel(const size_t kc, const float alpha, const float* a, const float* b,
+			float* C, const size_t ldc, const size_t mr, const size_t nr)
+		{
+			static_assert(EasyCNN::gemmMR == 6, "micro kernel rows are unrolled for MR = 6");
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			const size_t COLS = V::gemmColumns;
+			for (size_t j0 = 0; j0 < gemmNR; j0 += W * COLS)
+			{
+				T acc0[COLS], acc1[COLS], acc2[COLS], acc3[COLS], acc4[COLS], acc5[COLS];
+				for (size_t c = 0; c < COLS; c++)
+				{
+					acc0[c] = acc1[c] = acc2[c] = acc3[c] = acc4[c] = acc5[c] = V::zero();
+				}
+				for (size_t k = 0; k < kc; k++)
+				{
+					const float* bk = b + k * gemmNR + j0;
+					const float* ak = a + k * gemmMR;
+					T bv[COLS];
+					for (size_t c = 0; c < COLS; c++)
+					{
+						bv[c] = V::load(bk + c * W);
+					}
+					fmaddRow<V, COLS>(acc0, V::set1(ak[0]), bv);
+					fmaddRow<V, COLS>(acc1, V::set1(ak[1]), bv);
+					fmaddRow<V, COLS>(acc2, V::set1(ak[2]), bv);
+					fmaddRow<V, COLS>(acc3, V::set1(ak[3]), bv);
+					fmaddRow<V, COLS>(acc4, V::set1(ak[4]), bv);
+					fmaddRow<V, COLS>(acc5, V::set1(ak[5]), bv);
+				}
+				const T* acc[gemmMR] = { acc0, acc1, acc2, acc3, acc4, acc5 };
+				for (size_t i = 0; i < mr; i++)
+				{
+					storeRow<V, COLS>(acc[i], alpha, C + i * ldc, j0, nr);
+				}
+			}
+		}
+
+		//scalar walk for the pixels no vector path covers
+		inline void maxPoolPixels(const float* in, const PoolWindow& window, float* out, float* maxIdx,
+			const size_t owBegin, const size_t owEnd)
+		{
+			const size_t lanes = window.lanes;
+			for (size_t ow = owBegin; ow < owEnd; ow++)
+			{
+				for (size_t lane = 0; lane < lanes; lane++)
+				{
+					float result = 0.0f;
+					float idx = 0.0f;
+					for (size_t ph = 0; ph < window.windowHeight; ph++)
+					{
+						for (size_t pw = 0; pw < window.windowWidth; pw++)
+						{
+							const float value = in[(ph * window.inWidth + ow * window.widthStep + pw) * lanes + lane];
+							if (result < value)
+							{
+								result = value;
+								idx = (float)(ph * window.windowWidth + pw);
+							}
+						}
+					}
+					out[ow * lanes + lane] = result;
+					if (maxIdx)
+					{
+						maxIdx[ow * lanes + lane] = idx;
+					}
+				}
+			}
+		}
+
+		inline void meanPoolPixels(const float* in, const PoolWindow& window, float* out,
+			const size_t owBegin, const size_t owEnd)
+		{
+			const size_t lanes = window.lanes;
+			const size_t windowSize = window.windowHeight * window.windowWidth;
+			for (size_t ow = owBegin; ow < owEnd; ow++)
+			{
+				for (size_t lane = 0; lane < lanes; lane++)
+				{
+					float sum = 0.0f;
+					for (size_t ph = 0; ph < window.windowHeight; ph++)
+					{
+						for (size_t pw = 0; pw < window.windowWidth; pw++)
+						{
+							sum += in[(ph * window.inWidth + ow * window.widthStep + pw) * lanes + lane];
+						}
+					}
+					out[ow * lanes + lane] = sum / windowSize;
+				}
+			}
+		}
+
+		//first output pixel the single lane vector path can't load without reading past the row :
+		//step 1 loads width neighbours, step 2 deinterleaves 2 * width floats
+		template <typename V>
+		size_t singleLaneVectorEnd(const PoolWindow& window)
+		{
+			const size_t W = V::width;
+			size_t ow = 0;
+			while (ow + W <= window.outWidth &&
+				(ow + W - 1) * window.widthStep + (window.widthStep - 1) + window.windowWidth <= window.inWidth)
+			{
+				ow += W;
+			}
+			return ow;
+		}
+
+		//lanes a multiple of the width : vectors across lanes.
+		//a single lane with step 1 or 2 : vectors across output pixels.
+		//anything else is scalar.
+		template <typename V>
+		void maxPoolRow(const float* in, const PoolWindow& window, float* out, float* maxIdx)
+		{
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			const size_t lanes = window.lanes;
+			if (lanes % W == 0)
+			{
+				for (size_t ow = 0; ow < window.outWidth; ow++)
+				{
+					for (size_t lane = 0; lane < lanes; lane += W)
+					{
+						T result = V::zero();
+						T idx = V::zero();
+						for (size_t ph = 0; ph < window.windowHeight; ph++)
+						{
+							for (size_t pw = 0; pw < window.windowWidth; pw++)
+							{
+								const T value = V::load(in + (ph * window.inWidth + ow * window.widthStep + pw) * lanes + lane);
+								idx = V::selectGreater(value, result, V::set1((float)(ph * window.windowWidth + pw)), idx);
+								result = V::max(result, value);
+							}
+						}
+						V::store(out + ow * lanes + lane, result);
+						if (maxIdx)
+						{
+							V::store(maxIdx + ow * lanes + lane, idx);
+						}
+					}
+				}
+				return;
+			}
+			size_t vectorEnd = 0;
+			if (lanes == 1 && (window.widthStep == 1 || window.widthStep == 2))
+			{
+				vectorEnd = singleLaneVectorEnd<V>(window);
+				for (size_t ow = 0; ow < vectorEnd; ow += W)
+				{
+					T result = V::zero();
+					T idx = V::zero();
+					for (size_t ph = 0; ph < window.windowHeight; ph++)
+					{
+						for (size_t pw = 0; pw < window.windowWidth; pw++)
+						{
+							const float* src = in + ph * window.inWidth + ow * window.widthStep + pw;
+							const T value = window.widthStep == 1 ? V::load(src) : V::loadEven(src);
+							idx = V::selectGreater(value, result, V::set1((float)(ph * window.windowWidth + pw)), idx);
+							result = V::max(result, value);
+						}
+					}
+					V::store(out + ow, result);
+					if (maxIdx)
+					{
+						V::store(maxIdx + ow, idx);
+					}
+				}
+			}
+			maxPoolPixels(in, window, out, maxIdx, vectorEnd, window.outWidth);
+		}
+
+		template <typename V>
+		void meanPoolRow(const float* in, const PoolWindow& window, float* out)
+		{
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			const size_t lanes = window.lanes;
+			const T windowSize = V::set1((float)(window.windowHeight * window.windowWidth));
+			if (lanes % W == 0)
+			{
+				for (size_t ow = 0; ow < window.outWidth; ow++)
+				{
+					for (size_t lane = 0; lane < lanes; lane += W)
+					{
+						T sum = V::zero();
+						for (size_t ph = 0; ph < window.windowHeight; ph++)
+						{
+							for (size_t pw = 0; pw < window.windowWidth; pw++)
+							{
+								sum = V::add(sum, V::load(in + (ph * window.inWidth + ow * window.widthStep + pw) * lanes + lane));
+							}
+						}
+						V::store(out + ow * lanes + lane, V::div(sum, windowSize));
+					}
+				}
+				return;
+			}
+			size_t vectorEnd = 0;
+			if (lanes == 1 && (window.widthStep == 1 || window.widthStep == 2))
+			{
+				vectorEnd = singleLaneVectorEnd<V>(window);
+				for (size_t ow = 0; ow < vectorEnd; ow += W)
+				{
+					T sum = V::zero();
+					for (size_t ph = 0; ph < window.windowHeight; ph++)
+					{
+						for (size_t pw = 0; pw < window.windowWidth; pw++)
+						{
+							const float* src = in + ph * window.inWidth + ow * window.widthStep + pw;
+							sum = V::add(sum, window.widthStep == 1 ? V::load(src) : V::loadEven(src));
+						}
+					}
+					V::store(out + ow, V::div(sum, windowSize));
+				}
+			}
+			meanPoolPixels(in, window, out, vectorEnd, window.outWidth);
+		}
+
+		//elementwise y = f(x) : Op::vector on whole vectors, Op::scalar on the tail through a padded vector
+		template <typename V, typename Op>
+		void unary(const float* x, float* y, const size_t n)
+		{
+			const size_t W = V::width;
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				V::store(y + i, Op::apply(V::load(x + i)));
+			}
+			if (i < n)
+			{
+				float tail[V::width] = { 0 };
+				for (size_t j = 0; i + j < n; j++)
+				{
+					tail[j] = x[i + j];
+				}
+				V::store(tail, Op::apply(V::load(tail)));
+				for (size_t j = 0; i + j < n; j++)
+				{
+					y[i + j] = tail[j];
+				}
+			}
+		}
+
+		//elementwise dx = f'(y) * dy
+		template <typename V, typename Op>
+		void binary(const float* y, const float* dy, float* dx, const size_t n)
+		{
+			const size_t W = V::width;
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				V::store(dx + i, Op::apply(V::load(y + i), V::load(dy + i)));
+			}
+			if (i < n)
+			{
+				float tailY[V::width] = { 0 };
+				float tailDy[V::width] = { 0 };
+				for (size_t j = 0; i + j < n; j++)
+				{
+					tailY[j] = y[i + j];
+					tailDy[j] = dy[i + j];
+				}
+				V::store(tailY, Op::apply(V::load(tailY), V::load(tailDy)));
+				for (size_t j = 0; i + j < n; j++)
+				{
+					dx[i + j] = tailY[j];
+				}
+			}
+		}
+
+		template <typename V>
+		struct ReluOp
+		{
+			static typename V::Type apply(const typename V::Type x) { return V::max(x, V::zero()); }
+		};
+		template <typename V>
+		struct ReluBackwardOp
+		{
+			static typename V::Type apply(const typename V::Type y, const typename V::Type dy)
+			{
+				return V::mul(V::selectGreater(y, V::zero(), V::set1(1.0f), V::set1(0.01f)), dy);
+			}
+		};
+		template <typename V>
+		struct SigmoidOp
+		{
+			static typename V::Type apply(const typename V::Type x)
+			{
+				const typename V::Type one = V::set1(1.0f);
+				return V::div(one, V::add(one, exp<V>(V::sub(V::zero(), x))));
+			}
+		};
+		template <typename V>
+		struct SigmoidBackwardOp
+		{
+			static typename V::Type apply(const typename V::Type y, const typename V::Type dy)
+			{
+				return V::mul(V::mul(y, V::sub(V::set1(1.0f), y)), dy);
+			}
+		};
+		template <typename V>
+		struct TanhOp
+		{
+			static typename V::Type apply(const typename V::Type x) { return tanh<V>(x); }
+		};
+		template <typename V>
+		struct TanhBackwardOp
+		{
+			static typename V::Type apply(const typename V::Type y, const typename V::Type dy)
+			{
+				return V::mul(V::sub(V::set1(1.0f), V::mul(y, y)), dy);
+			}
+		};
+
+		template <typename V> void relu(const float* x, float* y, const size_t n) { unary<V, ReluOp<V> >(x, y, n); }
+		template <typename V> void reluBackward(const float* y, const float* dy, float* dx, const size_t n) { binary<V, ReluBackwardOp<V> >(y, dy, dx, n); }
+		template <typename V> void sigmoid(const float* x, float* y, const size_t n) { unary<V, SigmoidOp<V> >(x, y, n); }
+		template <typename V> void sigmoidBackward(const float* y, const float* dy, float* dx, const size_t n) { binary<V, SigmoidBackwardOp<V> >(y, dy, dx, n); }
+		template <typename V> void tanhForward(const float* x, float* y, const size_t n) { unary<V, TanhOp<V> >(x, y, n); }
+		template <typename V> void tanhBackward(const float* y, const float* dy, float* dx, const size_t n) { binary<V, TanhBackwardOp<V> >(y, dy, dx, n); }
+
+		template <typename V>
+		void softmax(const float* x, float* y, const size_t n)
+		{
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			//step1 : find max value
+			float maxVal = x[0];
+			size_t i = 0;
+			if (n >= W)
+			{
+				T maxV = V::load(x);
+				for (i = W; i + W <= n; i += W)
+				{
+					maxV = V::max(maxV, V::load(x + i));
+				}
+				maxVal = V::reduceMax(maxV);
+			}
+			for (; i < n; i++)
+			{
+				maxVal = maxVal < x[i] ? x[i] : maxVal;
+			}
+			//step2 : exp and sum, the tail through a padded vector whose extra lanes are dropped
+			const T maxValV = V::set1(maxVal);
+			T sumV = V::zero();
+			for (i = 0; i + W <= n; i += W)
+			{
+				const T e = exp<V>(V::sub(V::load(x + i), maxValV));
+				V::store(y + i, e);
+				sumV = V::add(sumV, e);
+			}
+			float sum = V::reduceAdd(sumV);
+			if (i < n)
+			{
+				float tail[V::width] = { 0 };
+				for (size_t j = 0; i + j < n; j++)
+				{
+					tail[j] = x[i + j];
+				}
+				V::store(tail, exp<V>(V::sub(V::load(tail), maxValV)));
+				for (size_t j = 0; i + j < n; j++)
+				{
+					y[i + j] = tail[j];
+					sum += tail[j];
+				}
+			}
+			//step3 : div
+			const T sumAll = V::set1(sum);
+			for (i = 0; i + W <= n; i += W)
+			{
+				V::store(y + i, V::div(V::load(y + i), sumAll));
+			}
+			for (; i < n; i++)
+			{
+				y[i] = y[i] / sum;
+			}
+		}
+
+		template <typename V>
+		void u8ToFloat(const uint8_t* src, float* dst, const size_t n, const float scale)
+		{
+			const size_t W = V::width;
+			const typename V::Type scaleV = V::set1(scale);
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				V::store(dst + i, V::mul(V::loadU8(src + i), scaleV));
+			}
+			for (; i < n; i++)
+			{
+				dst[i] = (float)src[i] * scale;
+			}
+		}
+
+		template <typename V>
+		void momentumUpdate(float* params, float* velocity, const float* gradients, const size_t n, const EasyCNN::MomentumStep& step)
+		{
+			typedef typename V::Type T;
+			const size_t W = V::width;
+			const T scaleV = V::set1(step.gradientScale);
+			const T momentumV = V::set1(step.momentum);
+			const T minusRateV = V::set1(-step.learningRate);
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				const T g = V::mul(V::load(gradients + i), scaleV);
+				const T v = V::fmadd(momentumV, V::load(velocity + i), g);
+				V::store(velocity + i, v);
+				const T direction = step.nesterov ? V::fmadd(momentumV, v, g) : v;
+				V::store(params + i, V::fmadd(minusRateV, direction, V::load(params + i)));
+			}
+			for (; i < n; i++)
+			{
+				const float g = gradients[i] * step.gradientScale;
+				velocity[i] = step.momentum * velocity[i] + g;
+				params[i] -= step.learningRate * (step.nesterov ? g + step.momentum * velocity[i] : velocity[i]);
+			}
+		}
+
+		template <typename V>
+		inline void adamVector(float* params, float* m, float* v, const float* gradients, const EasyCNN::AdamStep& step)
+		{
+			typedef typename V::Type T;
+			const T g = V::mul(V::load(gradients), V::set1(step.gradientScale));
+			const T mi = V::fmadd(V::set1(step.beta1), V::load(m), V::mul(V::set1(1.0f - step.beta1), g));
+			const T vi = V::fmadd(V::set1(step.beta2), V::load(v), V::mul(V::set1(1.0f - step.beta2), V::mul(g, g)));
+			V::store(m, mi);
+			V::store(v, vi);
+			const T update = V::div(mi, V::add(V::sqrt(vi), V::set1(step.epsilon)));
+			V::store(params, V::fmadd(V::set1(-step.stepSize), update, V::load(params)));
+		}
+
+		//the tail goes through padded vectors, as unary's
+		template <typename V>
+		void adamUpdate(float* params, float* m, float* v, const float* gradients, const size_t n, const EasyCNN::AdamStep& step)
+		{
+			const size_t W = V::width;
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+			{
+				adamVector<V>(params + i, m + i, v + i, gradients + i, step);
+			}
+			if (i < n)
+			{
+				float tailParams[V::width] = { 0 };
+				float tailM[V::width] = { 0 };
+				float tailV[V::width] = { 0 };
+				float tailGradients[V::width] = { 0 };
+				for (size_t j = 0; i + j < n; j++)
+				{
+					tailParams[j] = params[i + j];
+					tailM[j] = m[i + j];
+					tailV[j] = v[i + j];
+					tailGradients[j] = gradients[i + j];
+				}
+				adamVector<V>(tailParams, tailM, tailV, tailGradients, step);
+				for (size_t j = 0; i + j < n; j++)
+				{
+					params[i + j] = tailParams[j];
+					m[i + j] = tailM[j];
+					v[i + j] = tailV[j];
+				}
+			}
+		}
+
+		template <typename V>
+		void fillTable(EasyCNN::KernelTable& table, const EasyCNN::CpuIsa isa)
+		{
+			table.isa = isa;
+			table.dot = dot<V>;
+			table.axpy = axpy<V>;
+			table.gemmMicroKernel = gemmMicroKernel<V>;
+			table.maxPoolRow = maxPoolRow<V>;
+			table.meanPoolRow = meanPoolRow<V>;
+			table.relu = relu<V>;
+			table.reluBackward = reluBackward<V>;
+			table.sigmoid = sigmoid<V>;
+			table.sigmoidBackward = sigmoidBackward<V>;
+			table.tanh = tanhForward<V>;
+			table.tanhBackward = tanhBackward<V>;
+			table.softmax = softmax<V>;
+			table.u8ToFloat = u8ToFloat<V>;
+			table.momentumUpdate = momentumUpdate<V>;
+			table.adamUpdate = adamUpdate<V>;
+		}
+	}
+}
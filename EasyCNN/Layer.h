@@ -2,13 +2,15 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "Configure.h"
 #include "DataBucket.h"
 #include "ParamBucket.h"
+#include "ThreadPool.h"
 
 #define DECLARE_LAYER_TYPE static const std::string layerType;
 #define DEFINE_LAYER_TYPE(class_type,type_string) const std::string class_type::layerType = type_string; 
-#define FRIEND_WITH_NETWORK friend class NetWork;
+#define FRIEND_WITH_NETWORK friend class NetWork; friend class ExecutionContext;
 
 namespace EasyCNN
 {
@@ -18,33 +20,114 @@ namespace EasyCNN
 		Test
 	};
 
+	//what one forward pass of a layer writes besides its output : scratch buffers, and in train phase
+	//whatever backward takes from forward. every execution context has its own, so does the layer itself.
+	class LayerWorkspace
+	{
+	public:
+		virtual ~LayerWorkspace() {}
+	};
+
 	class Layer
 	{
 		FRIEND_WITH_NETWORK
 	protected:
-		virtual std::string getLayerType() const = 0;
+		virtual const std::string& getLayerType() const = 0;
 		virtual std::string serializeToString() const{ return getLayerType(); };
 		virtual void serializeFromString(const std::string content){/*nop*/ };
+		//hyperparameters only, what the binary model keeps next to the raw params
+		virtual std::string serializeDescToString() const{ return getLayerType(); };
+		virtual void serializeDescFromString(const std::string content){/*nop*/ };
+		//learnable params in a fixed order. buckets set before solveInnerParams are used as they are,
+		//solveInnerParams only creates (and randomly initializes) the missing ones.
+		virtual std::vector<std::shared_ptr<ParamBucket>> getParamBuckets() const{ return std::vector<std::shared_ptr<ParamBucket>>(); }
+		virtual void setParamBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets){ easyAssert(buckets.empty(), "layer has no params."); }
 		//phase
 		inline void setPhase(Phase phase) { this->phase = phase; }
 		inline Phase getPhase() const{ return phase; }
-		//learning rate
-		inline void setLearningRate(const float learningRate){ this->learningRate = learningRate; }
-		inline float getLearningRate() const{ return learningRate; }
 		//size
 		inline void setInputBucketSize(const DataSize size){ inputSize = size; }
 		inline DataSize getInputBucketSize() const{ return inputSize; }
 		inline void setOutpuBuckerSize(const DataSize size){ outputSize = size; }
 		inline DataSize getOutputBucketSize() const{ return outputSize; }
+		//layout : the layout this layer reads and writes, chosen by the network from getPreferredLayout.
+		//prevLayout is what the previous layer produces, returning anything else makes the network reorder.
+		virtual DataLayout getPreferredLayout(const DataLayout prevLayout) const{ return DataLayout::NCHW; }
+		inline void setDataLayout(const DataLayout layout){ dataLayout = layout; }
+		inline DataLayout getDataLayout() const{ return dataLayout; }
+		//in place : forward may write over its input (the network then hands it the same bucket twice),
+		//backward needs only its output and turns nextDiff into the previous layer's diff where it is.
+		virtual bool isInPlaceCapable() const{ return false; }
+		//backward reads this layer's own output, an in place layer after it must not overwrite it
+		virtual bool isOutputUsedInBackward() const{ return false; }
+		//diff / gradient buffers : the network hands each layer views into its backward arenas,
+		//a layer used on its own (or handed a bucket of another shape) falls back to buckets of its own.
+		//getDiffBucket is where backward writes the previous layer's diff, reshaped to size's number.
+		inline void setDiffBucket(std::shared_ptr<DataBucket> bucket){ diffBucket = bucket; }
+		inline std::shared_ptr<DataBucket> getDiffBucket(const DataSize size, const DataLayout layout)
+		{
+			if (diffBucket.get() == nullptr || !diffBucket->getSize().isSameSample(size) || diffBucket->getLayout() != layout)
+			{
+				diffBucket = std::make_shared<DataBucket>(size, layout);
+			}
+			diffBucket->reshape(size.number);
+			return diffBucket;
+		}
+		//one gradient bucket per learnable param, in the order backward asks for them with getGradientBucket
+		virtual std::vector<ParamSize> getGradientSizes() const{ return std::vector<ParamSize>(); }
+		inline void setGradientBuckets(const std::vector<std::shared_ptr<ParamBucket>>& buckets){ gradientBuckets = buckets; }
+		inline std::shared_ptr<ParamBucket> getGradientBucket(const size_t idx)
+		{
+			if (idx >= gradientBuckets.size() || gradientBuckets[idx].get() == nullptr)
+			{
+				const std::vector<ParamSize> sizes = getGradientSizes();
+				easyAssert(idx < sizes.size(), "gradient index is invalidate.");
+				gradientBuckets.resize(sizes.size());
+				gradientBuckets[idx] = std::make_shared<ParamBucket>(sizes[idx]);
+			}
+			return gradientBuckets[idx];
+		}
+		//the params changed behind the layer's back (the network's optimizer updated them) : derived state is rebuilt
+		virtual void onParamsChanged(){}
+		//thread pool, shared with the network
+		inline void setThreadPool(std::shared_ptr<ThreadPool> threadPool){ this->threadPool = threadPool; }
+		inline ThreadPool* getThreadPool() const{ return threadPool.get(); }
 		//solve params
 		virtual void solveInnerParams(){ outputSize = inputSize; }
-		//data flow		
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) = 0;
+		//workspace, null for layers writing nothing but their output
+		virtual std::shared_ptr<LayerWorkspace> createWorkspace() const{ return nullptr; }
+		inline LayerWorkspace* getWorkspace()
+		{
+			if (workspace.get() == nullptr)
+			{
+				workspace = createWorkspace();
+			}
+			return workspace.get();
+		}
+		//builds what forward derives from the params (transformed kernels, packed weights), again after they change.
+		//after it the const forward only reads the layer.
+		virtual void prepareForward(){}
+		//data flow
+		//on the layer's own workspace and thread pool
+		inline void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+		{
+			prepareForward();
+			forward(prevDataBucket, nextDataBucket, getWorkspace(), getThreadPool());
+		}
+		//on a workspace from createWorkspace, spread over pool : any number of threads may run it on one layer
+		//at the same time, each with its own workspace, as long as nothing changes the layer meanwhile.
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const = 0;
+		//writes the previous layer's diff and this layer's gradients, the params are left alone
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) = 0;
 	private:
 		Phase phase = Phase::Train;
 		DataSize inputSize;
 		DataSize outputSize;
-		float learningRate = 0.1f;
+		DataLayout dataLayout = DataLayout::NCHW;
+		std::shared_ptr<ThreadPool> threadPool;
+		std::shared_ptr<LayerWorkspace> workspace;
+		std::shared_ptr<DataBucket> diffBucket;
+		std::vector<std::shared_ptr<ParamBucket>> gradientBuckets;
 	};
 }
\ No newline at end of file
@@ -2,6 +2,11 @@
 #include "LossFunction.h"
 
 //cross entropy
+std::shared_ptr<EasyCNN::LossFunctor> EasyCNN::CrossEntropyFunctor::clone() const
+{
+	return std::make_shared<CrossEntropyFunctor>();
+}
+
 float EasyCNN::CrossEntropyFunctor::getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket, const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket)
 {
 	const auto outputSize = outputDataBucket->getSize();
@@ -21,8 +26,14 @@ std::shared_ptr<EasyCNN::DataBucket> EasyCNN::CrossEntropyFunctor::getDiff(const
 {
 	const DataSize labelSize = labelDataBucket->getSize();
 	const DataSize outputSize = outputDataBucket->getSize();
-	const DataSize nextDiffSize(outputSize.number, outputSize.channels, outputSize.height, outputSize.width);
-	std::shared_ptr<DataBucket> nextDiffBucket(std::make_shared<DataBucket>(nextDiffSize));
+	const DataSize nextDiffSize(outputSize.number, outputSize.channels, outputSize.width, outputSize.height);
+	//kept between batches, a smaller batch reuses it
+	if (diffBucket.get() == nullptr || !diffBucket->getSize().isSameSample(nextDiffSize))
+	{
+		diffBucket = std::make_shared<DataBucket>(nextDiffSize);
+	}
+	diffBucket->reshape(nextDiffSize.number);
+	const std::shared_ptr<DataBucket> nextDiffBucket = diffBucket;
 	nextDiffBucket->fillData(0.0f);
 
 	for (size_t on = 0; on < outputSize.number; on++)
@@ -42,6 +53,11 @@ std::shared_ptr<EasyCNN::DataBucket> EasyCNN::CrossEntropyFunctor::getDiff(const
 }
 
 //MSE
+std::shared_ptr<EasyCNN::LossFunctor> EasyCNN::MSEFunctor::clone() const
+{
+	return std::make_shared<MSEFunctor>();
+}
+
 float EasyCNN::MSEFunctor::getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket, const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket)
 {
 	const auto outputSize = outputDataBucket->getSize();
@@ -61,8 +77,14 @@ std::shared_ptr<EasyCNN::DataBucket> EasyCNN::MSEFunctor::getDiff(const std::sha
 {
 	const DataSize labelSize = labelDataBucket->getSize();
 	const DataSize outputSize = outputDataBucket->getSize();
-	const DataSize nextDiffSize(outputSize.number, outputSize.channels, outputSize.height, outputSize.width);
-	std::shared_ptr<DataBucket> nextDiffBucket(std::make_shared<DataBucket>(nextDiffSize));
+	const DataSize nextDiffSize(outputSize.number, outputSize.channels, outputSize.width, outputSize.height);
+	//kept between batches, a smaller batch reuses it
+	if (diffBucket.get() == nullptr || !diffBucket->getSize().isSameSample(nextDiffSize))
+	{
+		diffBucket = std::make_shared<DataBucket>(nextDiffSize);
+	}
+	diffBucket->reshape(nextDiffSize.number);
+	const std::shared_ptr<DataBucket> nextDiffBucket = diffBucket;
 	nextDiffBucket->fillData(0.0f);
 
 	for (size_t on = 0; on < outputSize.number; on++)
@@ -9,27 +9,37 @@ namespace EasyCNN
 	class LossFunctor
 	{
 	public:
+		virtual ~LossFunctor() {}
 		virtual float getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket) = 0;
 		virtual std::shared_ptr<EasyCNN::DataBucket> getDiff(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket) = 0;
+		//a fresh functor of the same loss for a network replica, functors keep per batch buffers.
+		//the default can't copy one and returns null, a loss layer is replaced by the replica's own layer instead.
+		virtual std::shared_ptr<LossFunctor> clone() const { return std::shared_ptr<LossFunctor>(); }
 	};
 
 	class CrossEntropyFunctor : public LossFunctor
 	{
 	public:
+		virtual std::shared_ptr<LossFunctor> clone() const override;
 		virtual float getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket);
 		virtual std::shared_ptr<EasyCNN::DataBucket> getDiff(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket);
+	private:
+		std::shared_ptr<EasyCNN::DataBucket> diffBucket;
 	};
 
 	class MSEFunctor : public LossFunctor
 	{
 	public:
+		virtual std::shared_ptr<LossFunctor> clone() const override;
 		virtual float getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket);
 		virtual std::shared_ptr<EasyCNN::DataBucket> getDiff(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
 			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket);
+	private:
+		std::shared_ptr<EasyCNN::DataBucket> diffBucket;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+
+std::shared_ptr<EasyCNN::MappedFile> EasyCNN::MappedFile::open(const std::string& path)
+{
+	std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	file->fileHandle = fileHandle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		return nullptr;
+	}
+	file->size = (size_t)fileSize.QuadPart;
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		return nullptr;
+	}
+	file->mappingHandle = mappingHandle;
+	file->data = (char*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+	if (file->data == nullptr)
+	{
+		return nullptr;
+	}
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+	file->size = (size_t)fileStat.st_size;
+	void* mapped = mmap(nullptr, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	//the mapping keeps the file referenced
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	file->data = (char*)mapped;
+#endif
+	return file;
+}
+
+EasyCNN::MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+#else
+	if (data != nullptr)
+	{
+		munmap(data, size);
+	}
+#endif
+}
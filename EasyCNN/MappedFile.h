@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//a whole file mapped copy on write : pages are read from the page cache on first touch,
+	//writing to one gives this process a private copy of that page and never reaches the file.
+	class MappedFile
+	{
+	public:
+		//null when the file can't be opened or mapped
+		static std::shared_ptr<MappedFile> open(const std::string& path);
+		~MappedFile();
+		inline char* getData() const{ return data; }
+		inline size_t getSize() const{ return size; }
+	private:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+	private:
+		char* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#endif
+	};
+}
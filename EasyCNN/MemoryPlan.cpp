@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include "MemoryPlan.h"
+#include "Allocator.h"
+#include "EasyLogger.h"
+
+void EasyCNN::addSlot(std::vector<TensorSlot>& slots, std::shared_ptr<DataBucket>& bucket,
+	const DataSize size, const DataLayout layout, const int first, const int last)
+{
+	const size_t floats = (getStorageSize(size, layout) + slotAlignment - 1) / slotAlignment * slotAlignment;
+	slots.push_back({ &bucket, size, layout, first, last, floats, 0 });
+}
+
+size_t EasyCNN::packSlots(std::vector<TensorSlot>& slots)
+{
+	std::vector<size_t> order(slots.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b)
+	{
+		return slots[a].floats > slots[b].floats;
+	});
+	size_t arenaSize = 0;
+	std::vector<const TensorSlot*> placed;
+	for (const size_t idx : order)
+	{
+		TensorSlot& slot = slots[idx];
+		//live neighbours in address order, the slot goes into the first gap large enough
+		std::vector<const TensorSlot*> live;
+		for (const TensorSlot* other : placed)
+		{
+			if (other->first <= slot.last && slot.first <= other->last)
+			{
+				live.push_back(other);
+			}
+		}
+		std::sort(live.begin(), live.end(), [](const TensorSlot* a, const TensorSlot* b)
+		{
+			return a->offset < b->offset;
+		});
+		size_t offset = 0;
+		for (const TensorSlot* other : live)
+		{
+			if (offset + slot.floats <= other->offset)
+			{
+				break;
+			}
+			offset = std::max(offset, other->offset + other->floats);
+		}
+		slot.offset = offset;
+		placed.push_back(&slot);
+		arenaSize = std::max(arenaSize, offset + slot.floats);
+	}
+	return arenaSize;
+}
+
+std::shared_ptr<float> EasyCNN::bindSlots(std::vector<TensorSlot>& slots, const size_t arenaSize)
+{
+	for (auto& slot : slots)
+	{
+		slot.bucket->reset();
+	}
+	const std::shared_ptr<float> arena = allocateFloats(std::max<size_t>(arenaSize, 1));
+	for (auto& slot : slots)
+	{
+		slot.bucket->reset(new DataBucket(slot.size, slot.layout, std::shared_ptr<float>(arena, arena.get() + slot.offset)));
+	}
+	return arena;
+}
+
+//forward runs layer i as two steps : 2i reorders its input (when it has a reorder bucket), 2i+1 runs the layer.
+//step -1 copies the input in, step 2n converts the last output to NCHW, the returned bucket stays alive.
+std::shared_ptr<float> EasyCNN::planForwardMemory(std::vector<std::shared_ptr<DataBucket>>& dataBuckets,
+	std::vector<std::shared_ptr<DataBucket>>& reorderBuckets, std::shared_ptr<DataBucket>& outputBucket,
+	const std::vector<bool>& inPlace, const size_t number)
+{
+	const int layerCount = (int)reorderBuckets.size();
+	std::vector<TensorSlot> slots;
+	std::vector<size_t> dataSlots;
+	const auto addActivationSlot = [&](std::shared_ptr<DataBucket>& bucket, const int first, const int last)
+	{
+		DataSize size = bucket->getSize();
+		size.number = number;
+		addSlot(slots, bucket, size, bucket->getLayout(), first, last);
+	};
+	//the bound input is the caller's, it and the buckets aliasing it stay out of the arena
+	const size_t inputSlot = SIZE_MAX;
+	for (int i = 0; i <= layerCount; i++)
+	{
+		//dataBuckets[i] is written by layer i - 1 and read by layer i's reorder or layer i,
+		//an in place layer i - 1 extends its input's slot instead
+		const int first = 2 * i - 1;
+		int last = INT_MAX;
+		if (i < layerCount)
+		{
+			last = reorderBuckets[i].get() != nullptr ? 2 * i : 2 * i + 1;
+		}
+		else if (outputBucket.get() != nullptr)
+		{
+			last = 2 * layerCount;
+		}
+		if (i == 0)
+		{
+			dataSlots.push_back(inputSlot);
+		}
+		else if (inPlace[i - 1])
+		{
+			dataSlots.push_back(dataSlots.back());
+			if (dataSlots.back() != inputSlot)
+			{
+				slots[dataSlots.back()].last = last;
+			}
+		}
+		else
+		{
+			dataSlots.push_back(slots.size());
+			addActivationSlot(dataBuckets[i], first, last);
+		}
+		if (i < layerCount && reorderBuckets[i].get() != nullptr)
+		{
+			addActivationSlot(reorderBuckets[i], 2 * i, 2 * i + 1);
+		}
+	}
+	if (outputBucket.get() != nullptr)
+	{
+		addActivationSlot(outputBucket, 2 * layerCount, INT_MAX);
+	}
+
+	const size_t arenaSize = packSlots(slots);
+	size_t separateSize = 0;
+	for (const auto& slot : slots)
+	{
+		separateSize += slot.floats;
+	}
+	const std::shared_ptr<float> arena = bindSlots(slots, arenaSize);
+	for (size_t i = 1; i < dataBuckets.size(); i++)
+	{
+		if (inPlace[i - 1])
+		{
+			dataBuckets[i] = dataBuckets[i - 1];
+		}
+	}
+	logVerbose("activations : %d floats in one arena, %d floats as separate buckets.", (int)arenaSize, (int)separateSize);
+	return arena;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+
+namespace EasyCNN
+{
+	//64 byte aligned offsets
+	const size_t slotAlignment = 16;
+
+	//one tensor of a forward or backward pass, alive from step first to step last (inclusive)
+	struct TensorSlot
+	{
+		std::shared_ptr<DataBucket>* bucket;
+		DataSize size;
+		DataLayout layout;
+		int first;
+		int last;
+		size_t floats;
+		size_t offset;
+	};
+
+	void addSlot(std::vector<TensorSlot>& slots, std::shared_ptr<DataBucket>& bucket,
+		const DataSize size, const DataLayout layout, const int first, const int last);
+	//slots are placed largest first at the lowest offset that no slot alive at the same time overlaps,
+	//for a chain that ends up close to the two largest neighbouring tensors. returns the arena size.
+	size_t packSlots(std::vector<TensorSlot>& slots);
+	//drops the slots' old buckets, then makes each one a view into a fresh arena
+	std::shared_ptr<float> bindSlots(std::vector<TensorSlot>& slots, const size_t arenaSize);
+
+	//test phase forward through a layer chain : dataBuckets[i] is layer i's input (dataBuckets[0] the caller's, left alone),
+	//reorderBuckets[i] its reordered copy or null, outputBucket the NCHW copy of the last output or null,
+	//inPlace[i] tells layer i writes over its input. every other bucket becomes a view into the returned arena,
+	//sized for number samples, buckets whose lifetimes don't overlap share memory.
+	//the caller drops its old arena first, the old buckets are dropped before the new arena is taken.
+	std::shared_ptr<float> planForwardMemory(std::vector<std::shared_ptr<DataBucket>>& dataBuckets,
+		std::vector<std::shared_ptr<DataBucket>>& reorderBuckets, std::shared_ptr<DataBucket>& outputBucket,
+		const std::vector<bool>& inPlace, const size_t number);
+}
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "ModelFile.h"
+#include "Allocator.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+
+static const char modelFileMagic[8] = { 'E', 'C', 'N', 'N', 'B', 'I', 'N', 0 };
+static const size_t headerSize = 64;
+//the header's checksum covers everything in front of it
+static const size_t headerChecksumOffset = headerSize - sizeof(uint64_t);
+
+static size_t roundUp(const size_t value, const size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+//checksum
+uint64_t EasyCNN::computeChecksum(const void* data, const size_t bytes)
+{
+	//both sums are reduced every blockWords words, long before sum2 could overflow
+	const size_t blockWords = 1024;
+	const uint64_t modulus = 0xffffffffu;
+	const char* bytesData = (const char*)data;
+	const size_t words = bytes / sizeof(uint32_t);
+	uint64_t sum1 = 0;
+	uint64_t sum2 = 0;
+	for (size_t block = 0; block < words; block += blockWords)
+	{
+		const size_t blockEnd = std::min(words, block + blockWords);
+		for (size_t i = block; i < blockEnd; i++)
+		{
+			uint32_t word = 0;
+			memcpy(&word, bytesData + i * sizeof(uint32_t), sizeof(uint32_t));
+			sum1 += word;
+			sum2 += sum1;
+		}
+		sum1 %= modulus;
+		sum2 %= modulus;
+	}
+	//the tail is zero padded to a word
+	const size_t tail = bytes - words * sizeof(uint32_t);
+	if (tail > 0)
+	{
+		uint32_t word = 0;
+		memcpy(&word, bytesData + words * sizeof(uint32_t), tail);
+		sum1 = (sum1 + word) % modulus;
+		sum2 = (sum2 + sum1) % modulus;
+	}
+	return (sum2 << 32) | sum1;
+}
+
+namespace
+{
+	//appends plain values to a byte buffer
+	class ByteWriter
+	{
+	public:
+		template<typename T>
+		void write(const T value)
+		{
+			bytes.append((const char*)&value, sizeof(T));
+		}
+		void writeString(const std::string& value)
+		{
+			write((uint32_t)value.size());
+			bytes.append(value);
+		}
+		std::string bytes;
+	};
+
+	//reads plain values back, every read is bounds checked
+	class ByteReader
+	{
+	public:
+		ByteReader(const char* data, const size_t size) :data(data), size(size){}
+		template<typename T>
+		bool read(T& value)
+		{
+			if (size - offset < sizeof(T))
+			{
+				return false;
+			}
+			memcpy(&value, data + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+		bool readString(std::string& value)
+		{
+			uint32_t length = 0;
+			if (!read(length) || size - offset < length)
+			{
+				return false;
+			}
+			value.assign(data + offset, length);
+			offset += length;
+			return true;
+		}
+		inline size_t getOffset() const{ return offset; }
+	private:
+		const char* data = nullptr;
+		size_t size = 0;
+		size_t offset = 0;
+	};
+}
+
+bool EasyCNN::isModelFile(const std::string& path)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	char magic[sizeof(modelFileMagic)] = { 0 };
+	return ifs.read(magic, sizeof(magic)) && memcmp(magic, modelFileMagic, sizeof(magic)) == 0;
+}
+
+bool EasyCNN::writeModelFile(const std::string& path, const ModelFileContent& content)
+{
+	//records first, they tell where every blob goes
+	size_t recordsSize = 0;
+	for (const auto& layer : content.layers)
+	{
+		recordsSize += sizeof(uint32_t) + layer.desc.size() + sizeof(uint32_t) + layer.params.size() * 6 * sizeof(uint64_t);
+	}
+	size_t blobOffset = roundUp(headerSize + recordsSize, storageAlignment);
+	ByteWriter records;
+	for (const auto& layer : content.layers)
+	{
+		records.writeString(layer.desc);
+		records.write((uint32_t)layer.params.size());
+		for (const auto& param : layer.params)
+		{
+			const ParamSize size = param->getSize();
+			const size_t blobBytes = size._4DSize() * sizeof(float);
+			records.write((uint64_t)size.number);
+			records.write((uint64_t)size.channels);
+			records.write((uint64_t)size.width);
+			records.write((uint64_t)size.height);
+			records.write((uint64_t)blobOffset);
+			records.write(computeChecksum(param->getData().get(), blobBytes));
+			blobOffset = roundUp(blobOffset + blobBytes, storageAlignment);
+		}
+	}
+	easyAssert(records.bytes.size() == recordsSize, "model records size is invalidate.");
+	const size_t fileSize = blobOffset;
+
+	ByteWriter header;
+	header.bytes.append(modelFileMagic, sizeof(modelFileMagic));
+	header.write(modelFileVersion);
+	header.write((uint32_t)content.layers.size());
+	header.write((uint64_t)fileSize);
+	header.write((uint64_t)recordsSize);
+	header.write(computeChecksum(records.bytes.data(), records.bytes.size()));
+	header.write((uint32_t)content.inputSize.channels);
+	header.write((uint32_t)content.inputSize.width);
+	header.write((uint32_t)content.inputSize.height);
+	header.bytes.resize(headerChecksumOffset, 0);
+	header.write(computeChecksum(header.bytes.data(), header.bytes.size()));
+	easyAssert(header.bytes.size() == headerSize, "model header size is invalidate.");
+
+	std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+	if (!ofs.is_open())
+	{
+		return false;
+	}
+	const char padding[storageAlignment] = { 0 };
+	ofs.write(header.bytes.data(), header.bytes.size());
+	ofs.write(records.bytes.data(), records.bytes.size());
+	size_t written = headerSize + recordsSize;
+	for (const auto& layer : content.layers)
+	{
+		for (const auto& param : layer.params)
+		{
+			ofs.write(padding, roundUp(written, storageAlignment) - written);
+			written = roundUp(written, storageAlignment);
+			const size_t blobBytes = param->getSize()._4DSize() * sizeof(float);
+			ofs.write((const char*)param->getData().get(), blobBytes);
+			written += blobBytes;
+		}
+	}
+	ofs.write(padding, fileSize - written);
+	return ofs.good();
+}
+
+bool EasyCNN::readModelFile(const std::string& path, ModelFileContent& content, const bool verifyChecksums)
+{
+	const std::shared_ptr<MappedFile> file = MappedFile::open(path);
+	if (file.get() == nullptr)
+	{
+		logCritical("can't map model file %s.", path.c_str());
+		return false;
+	}
+	const char* data = file->getData();
+	const size_t size = file->getSize();
+
+	//header
+	if (size < headerSize || memcmp(data, modelFileMagic, sizeof(modelFileMagic)) != 0)
+	{
+		logCritical("%s is not a binary model.", path.c_str());
+		return false;
+	}
+	ByteReader header(data + sizeof(modelFileMagic), headerSize - sizeof(modelFileMagic));
+	uint32_t version = 0, layerCount = 0, channels = 0, width = 0, height = 0;
+	uint64_t fileSize = 0, recordsSize = 0, recordsChecksum = 0, headerChecksum = 0;
+	header.read(version);
+	header.read(layerCount);
+	header.read(fileSize);
+	header.read(recordsSize);
+	header.read(recordsChecksum);
+	header.read(channels);
+	header.read(width);
+	header.read(height);
+	memcpy(&headerChecksum, data + headerChecksumOffset, sizeof(headerChecksum));
+	if (version == 0 || version > modelFileVersion)
+	{
+		logCritical("model version %u isn't supported, this build reads up to %u.", version, modelFileVersion);
+		return false;
+	}
+	if (headerChecksum != computeChecksum(data, headerChecksumOffset) || fileSize != size || recordsSize > size - headerSize)
+	{
+		logCritical("model header is corrupted.");
+		return false;
+	}
+	if (recordsChecksum != computeChecksum(data + headerSize, (size_t)recordsSize))
+	{
+		logCritical("model layer records are corrupted.");
+		return false;
+	}
+
+	//records, params become views into the mapping
+	ModelFileContent result;
+	result.inputSize = DataSize(1, channels, width, height);
+	ByteReader records(data + headerSize, (size_t)recordsSize);
+	for (uint32_t i = 0; i < layerCount; i++)
+	{
+		ModelLayerRecord layer;
+		uint32_t paramCount = 0;
+		if (!records.readString(layer.desc) || !records.read(paramCount))
+		{
+			logCritical("model layer record %u is truncated.", i);
+			return false;
+		}
+		for (uint32_t j = 0; j < paramCount; j++)
+		{
+			uint64_t number = 0, channels = 0, width = 0, height = 0, offset = 0, checksum = 0;
+			if (!records.read(number) || !records.read(channels) || !records.read(width) || !records.read(height) ||
+				!records.read(offset) || !records.read(checksum))
+			{
+				logCritical("model layer record %u is truncated.", i);
+				return false;
+			}
+			const ParamSize paramSize((size_t)number, (size_t)channels, (size_t)width, (size_t)height);
+			const size_t blobBytes = paramSize._4DSize() * sizeof(float);
+			if (offset % storageAlignment != 0 || offset < headerSize + recordsSize || offset > size || blobBytes > size - offset)
+			{
+				logCritical("model param %u of layer %u is out of the file.", j, i);
+				return false;
+			}
+			char* blob = file->getData() + offset;
+			if (verifyChecksums && checksum != computeChecksum(blob, blobBytes))
+			{
+				logCritical("model param %u of layer %u is corrupted.", j, i);
+				return false;
+			}
+			layer.params.push_back(std::make_shared<ParamBucket>(paramSize, std::shared_ptr<float>(file, (float*)blob)));
+		}
+		result.layers.push_back(layer);
+	}
+	content = result;
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "MappedFile.h"
+#include "ParamBucket.h"
+
+namespace EasyCNN
+{
+	//binary model, host byte order (little endian on every supported target) :
+	//64 byte header | one record per layer | params, each a raw float blob at a 64 byte aligned offset.
+	//the header checksums itself and the records, every record the blobs it points to.
+	//a reader refuses files with a version newer than its own.
+	const uint32_t modelFileVersion = 1;
+
+	struct ModelLayerRecord
+	{
+		//the layer's serializeDescToString
+		std::string desc;
+		//the layer's getParamBuckets
+		std::vector<std::shared_ptr<ParamBucket>> params;
+	};
+
+	struct ModelFileContent
+	{
+		DataSize inputSize;
+		std::vector<ModelLayerRecord> layers;
+	};
+
+	//checksum of the file's header and records and of every blob : fletcher over 32 bit words
+	uint64_t computeChecksum(const void* data, const size_t bytes);
+	//the file starts with the binary model's magic
+	bool isModelFile(const std::string& path);
+	bool writeModelFile(const std::string& path, const ModelFileContent& content);
+	//params come back as views into the mapped file, which stays mapped while any of them lives.
+	//verifyChecksums reads every blob once, without it pages are only read when the network first uses them.
+	bool readModelFile(const std::string& path, ModelFileContent& content, const bool verifyChecksums = true);
+}
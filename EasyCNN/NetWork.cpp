@@ -12,10 +12,19 @@
 #include "PoolingLayer.h"
 #include "FullconnectLayer.h"
 #include "SoftmaxLayer.h"
+#include "SoftmaxCrossEntropyLayer.h"
 //network
+#include "Allocator.h"
+#include "Blas.h"
+#include "MemoryPlan.h"
+#include "ModelFile.h"
 #include "NetWork.h"
 
+//gradients are accumulated in runs of this many floats per thread
+static const size_t accumulateGrain = 16384;
+
 EasyCNN::NetWork::NetWork()
+	:optimizer(std::make_shared<SGDOptimizer>()), threadPool(std::make_shared<ThreadPool>())
 {
 	logVerbose("NetWork constructed.");
 }
@@ -29,6 +38,22 @@ void EasyCNN::NetWork::setPhase(Phase phase)
 {
 	logVerbose("NetWork setPhase begin.");
 	this->phase = phase;
+	for (auto& layer : layers)
+	{
+		layer->setPhase(phase);
+	}
+	if (!dataBuckets.empty() && !layers.empty())
+	{
+		const size_t number = dataBuckets.back()->getSize().number;
+		if (phase == Phase::Test)
+		{
+			planActivationMemory(number);
+		}
+		else if (activationArena.get() != nullptr)
+		{
+			releaseActivationMemory(number);
+		}
+	}
 	logVerbose("NetWork setPhase end.");
 }
 
@@ -38,6 +63,22 @@ EasyCNN::Phase EasyCNN::NetWork::getPhase() const
 	return phase;
 }
 
+void EasyCNN::NetWork::setThreadCount(const size_t threadCount, const bool pinThreads)
+{
+	logVerbose("NetWork setThreadCount begin.");
+	threadPool = std::make_shared<ThreadPool>(threadCount, pinThreads);
+	for (auto& layer : layers)
+	{
+		layer->setThreadPool(threadPool);
+	}
+	logVerbose("NetWork setThreadCount end.");
+}
+
+size_t EasyCNN::NetWork::getThreadCount() const
+{
+	return threadPool->getThreadCount();
+}
+
 std::string EasyCNN::NetWork::serializeToString() const
 {
 	const std::string spliter = " ";
@@ -73,6 +114,10 @@ std::shared_ptr<EasyCNN::Layer> EasyCNN::NetWork::createLayerByType(const std::s
 	{
 		return std::make_shared<SoftmaxLayer>();
 	}
+	else if (layerType == SoftmaxCrossEntropyLayer::layerType)
+	{
+		return std::make_shared<SoftmaxCrossEntropyLayer>();
+	}
 	else if (layerType == SigmodLayer::layerType)
 	{
 		return std::make_shared<SigmodLayer>();
@@ -125,57 +170,344 @@ std::shared_ptr<EasyCNN::DataBucket> EasyCNN::NetWork::forward(const std::shared
 	easyAssert(layers[0]->getLayerType() == InputLayer::layerType, "first layer is not input layer.");
 	easyAssert(dataBuckets.size() > 0, "data buckets is not ready.");
 
-	//copy data from inputDataBucket
-	//reshape data bucket
-	const auto oldNumber = dataBuckets[0]->getSize().number;
+	//bind inputDataBucket, then reshape the other buckets.
+	//the network's own buckets tell the current batch size, the caller may have reshaped the bucket bound last time
+	const auto oldNumber = dataBuckets.back()->getSize().number;
 	const auto newNumber = inputDataBucket->getSize().number;
+	bindInput(inputDataBucket);
 
-	if (newNumber != oldNumber)
+	//the arena is replanned only past the largest batch it was planned for, separate buckets grow on their own
+	if (newNumber > activationNumber && activationArena.get() != nullptr)
 	{
-		for (size_t i = 0; i < dataBuckets.size(); i++)
-		{
-			auto newSize = dataBuckets[i]->getSize();
-			newSize.number = newNumber;
-			dataBuckets[i].reset(new DataBucket(newSize));
-		}
+		planActivationMemory(newNumber);
+	}
+	else if (newNumber != oldNumber)
+	{
+		reshapeActivations(newNumber);
 	}
-
-	inputDataBucket->cloneTo(*dataBuckets[0]);
 
 	for (size_t i = 0; i < layers.size(); i++)
 	{
 		logVerbose("NetWork layer[%d](%s) forward begin.", i, layers[i]->getLayerType().c_str());
-		layers[i]->forward(dataBuckets[i], dataBuckets[i + 1]);
+		std::shared_ptr<DataBucket> layerInput = dataBuckets[i];
+		if (reorderBuckets[i].get() != nullptr)
+		{
+			layerInput->convertTo(*reorderBuckets[i], threadPool.get());
+			layerInput = reorderBuckets[i];
+		}
+		layers[i]->forward(layerInput, dataBuckets[i + 1]);
 		logVerbose("NetWork layer[%d](%s) forward end.", i, layers[i]->getLayerType().c_str());
 	}
 
 	logVerbose("NetWork forward end.");
-	return dataBuckets[dataBuckets.size() - 1];
+	return getOutputBucket();
+}
+
+//buckets shared by in place layers are reshaped once per alias, which is harmless.
+//the bound input is the caller's and keeps its own size.
+void EasyCNN::NetWork::reshapeActivations(const size_t number)
+{
+	for (size_t i = 1; i < dataBuckets.size(); i++)
+	{
+		if (dataBuckets[i] != dataBuckets[0])
+		{
+			dataBuckets[i]->reshape(number);
+		}
+	}
+	for (auto& bucket : reorderBuckets)
+	{
+		if (bucket.get() != nullptr)
+		{
+			bucket->reshape(number);
+		}
+	}
+	if (outputBucket.get() != nullptr)
+	{
+		outputBucket->reshape(number);
+	}
+}
+
+//the input layer runs in place, so the first layer doing any work reads the caller's bucket directly.
+//no in place layer may follow it (addLayer makes sure), the caller's data is only ever read.
+void EasyCNN::NetWork::bindInput(const std::shared_ptr<DataBucket> inputDataBucket)
+{
+	const DataSize inputSize = inputDataBucket->getSize();
+	const DataSize expectedSize = dataBuckets[0]->getSize();
+	easyAssert(inputSize.channels == expectedSize.channels && inputSize.height == expectedSize.height && inputSize.width == expectedSize.width &&
+		inputSize.number > 0, "input size is invalidate.");
+	easyAssert(inputDataBucket->getLayout() == DataLayout::NCHW, "input layout must be NCHW.");
+	const std::shared_ptr<DataBucket> previousInput = dataBuckets[0];
+	for (size_t i = 0; i < dataBuckets.size() && dataBuckets[i] == previousInput; i++)
+	{
+		dataBuckets[i] = inputDataBucket;
+	}
+}
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::NetWork::wrapInput(const float* inputData, const size_t number)
+{
+	return bindInputView(inputView, dataBuckets[0]->getSize(), inputData, number);
+}
+
+//callers and loss functors always see NCHW
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::NetWork::getOutputBucket()
+{
+	const auto lastOutputData = dataBuckets[dataBuckets.size() - 1];
+	if (outputBucket.get() == nullptr)
+	{
+		return lastOutputData;
+	}
+	lastOutputData->convertTo(*outputBucket, threadPool.get());
+	return outputBucket;
 }
+void EasyCNN::NetWork::planActivationMemory(const size_t number)
+{
+	logVerbose("NetWork planActivationMemory begin.");
+	const std::vector<bool> inPlace = getInPlaceLayers();
+	//drop the old buckets first so their memory is back before the arena is taken
+	dropBackwardMemory();
+	activationArena.reset();
+	activationArena = planForwardMemory(dataBuckets, reorderBuckets, outputBucket, inPlace, number);
+	activationNumber = number;
+	logVerbose("NetWork planActivationMemory end.");
+}
+
+void EasyCNN::NetWork::releaseActivationMemory(const size_t number)
+{
+	logVerbose("NetWork releaseActivationMemory begin.");
+	const auto separateBucket = [number](std::shared_ptr<DataBucket>& bucket)
+	{
+		if (bucket.get() != nullptr)
+		{
+			DataSize size = bucket->getSize();
+			size.number = number;
+			bucket.reset(new DataBucket(size, bucket->getLayout()));
+		}
+	};
+	const std::vector<bool> inPlace = getInPlaceLayers();
+	for (size_t i = 1; i < dataBuckets.size(); i++)
+	{
+		if (inPlace[i - 1])
+		{
+			dataBuckets[i] = dataBuckets[i - 1];
+			continue;
+		}
+		separateBucket(dataBuckets[i]);
+	}
+	for (size_t i = 0; i < reorderBuckets.size(); i++)
+	{
+		separateBucket(reorderBuckets[i]);
+	}
+	separateBucket(outputBucket);
+	activationArena.reset();
+	activationNumber = 0;
+	logVerbose("NetWork releaseActivationMemory end.");
+}
+
+//backward runs layer i (from the last one down to 1) at step 2(n-1-i)+1, its reorder diff conversion at the step after.
+//step 0 converts the loss diff to the last layer's layout. a layer writes the previous layer's diff into the bucket
+//it was handed, except in place layers, which turn the diff they get into the previous one where it is.
+void EasyCNN::NetWork::planBackwardMemory()
+{
+	logVerbose("NetWork planBackwardMemory begin.");
+	dropBackwardMemory();
+	const int layerCount = (int)layers.size();
+	std::vector<TensorSlot> slots;
+	std::vector<std::shared_ptr<DataBucket>> layerDiffBuckets(layers.size());
+	//slot of the diff flowing into the current layer, -1 for the loss functor's own bucket
+	int incoming = -1;
+	if (outputBucket.get() != nullptr)
+	{
+		addSlot(slots, outputDiffBucket, outputBucket->getSize(), dataBuckets.back()->getLayout(), 0, 1);
+		incoming = 0;
+	}
+	for (int i = layerCount - 1; i > 0; i--)
+	{
+		const int step = 2 * (layerCount - 1 - i) + 1;
+		const bool reordered = reorderBuckets[i].get() != nullptr;
+		int produced = incoming;
+		if (!layers[i]->isInPlaceCapable())
+		{
+			const auto input = reordered ? reorderBuckets[i] : dataBuckets[i];
+			produced = (int)slots.size();
+			addSlot(slots, layerDiffBuckets[i], input->getSize(), layers[i]->getDataLayout(), step, step);
+		}
+		//read by the reorder conversion, or by layer i - 1 two steps later
+		if (produced >= 0)
+		{
+			slots[produced].last = std::max(slots[produced].last, reordered ? step + 1 : step + 2);
+		}
+		incoming = produced;
+		if (reordered)
+		{
+			//diff of layer i's input, in the layout of the layer before it
+			incoming = (int)slots.size();
+			addSlot(slots, reorderDiffBuckets[i], reorderBuckets[i]->getSize(), dataBuckets[i]->getLayout(), step + 1, step + 2);
+		}
+	}
+	const size_t diffSize = packSlots(slots);
+	diffArena = bindSlots(slots, diffSize);
+	backwardNumber = dataBuckets.back()->getSize().number;
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		layers[i]->setDiffBucket(layerDiffBuckets[i]);
+	}
+
+	//gradients, one after another, laid out as the param arena
+	const size_t gradientSize = getParamArenaSize();
+	gradientArena = allocateFloats(std::max<size_t>(gradientSize, 1));
+	gradientArenaSize = gradientSize;
+	size_t offset = 0;
+	for (const auto& layer : layers)
+	{
+		std::vector<std::shared_ptr<ParamBucket>> gradientBuckets;
+		const std::vector<std::shared_ptr<ParamBucket>> params = layer->getParamBuckets();
+		const std::vector<ParamSize> sizes = layer->getGradientSizes();
+		easyAssert(sizes.size() == params.size(), "layer's gradients don't match its params.");
+		for (size_t i = 0; i < sizes.size(); i++)
+		{
+			const ParamSize size = sizes[i];
+			easyAssert(size._4DSize() == params[i]->getSize()._4DSize(), "layer's gradients don't match its params.");
+			gradientBuckets.push_back(std::make_shared<ParamBucket>(size, std::shared_ptr<float>(gradientArena, gradientArena.get() + offset)));
+			offset += (size._4DSize() + slotAlignment - 1) / slotAlignment * slotAlignment;
+		}
+		layer->setGradientBuckets(gradientBuckets);
+	}
+	logVerbose("NetWork backward memory : %d floats of diffs, %d floats of gradients.", (int)diffSize, (int)gradientSize);
+	logVerbose("NetWork planBackwardMemory end.");
+}
+
+size_t EasyCNN::NetWork::getParamArenaSize() const
+{
+	size_t arenaSize = 0;
+	for (const auto& layer : layers)
+	{
+		for (const auto& param : layer->getParamBuckets())
+		{
+			arenaSize += (param->getSize()._4DSize() + slotAlignment - 1) / slotAlignment * slotAlignment;
+		}
+	}
+	return arenaSize;
+}
+
+void EasyCNN::NetWork::planParamMemory()
+{
+	logVerbose("NetWork planParamMemory begin.");
+	paramArenaSize = getParamArenaSize();
+	paramArena = allocateFloats(std::max<size_t>(paramArenaSize, 1));
+	std::fill(paramArena.get(), paramArena.get() + paramArenaSize, 0.0f);
+	size_t offset = 0;
+	for (auto& layer : layers)
+	{
+		std::vector<std::shared_ptr<ParamBucket>> params;
+		for (const auto& param : layer->getParamBuckets())
+		{
+			const ParamSize size = param->getSize();
+			const float* data = param->getData().get();
+			std::copy(data, data + size._4DSize(), paramArena.get() + offset);
+			params.push_back(std::make_shared<ParamBucket>(size, std::shared_ptr<float>(paramArena, paramArena.get() + offset)));
+			offset += (size._4DSize() + slotAlignment - 1) / slotAlignment * slotAlignment;
+		}
+		if (!params.empty())
+		{
+			layer->setParamBuckets(params);
+		}
+	}
+	//the state belonged to the params of before
+	optimizer->reset();
+	logVerbose("NetWork param arena : %d floats.", (int)paramArenaSize);
+	logVerbose("NetWork planParamMemory end.");
+}
+
+void EasyCNN::NetWork::dropBackwardMemory()
+{
+	for (auto& layer : layers)
+	{
+		layer->setDiffBucket(nullptr);
+		layer->setGradientBuckets(std::vector<std::shared_ptr<ParamBucket>>());
+	}
+	for (auto& bucket : reorderDiffBuckets)
+	{
+		bucket.reset();
+	}
+	outputDiffBucket.reset();
+	diffArena.reset();
+	gradientArena.reset();
+	gradientArenaSize = 0;
+	backwardNumber = 0;
+}
+
+std::vector<bool> EasyCNN::NetWork::getInPlaceLayers() const
+{
+	std::vector<bool> inPlace(layers.size(), false);
+	for (size_t i = 0; i < layers.size() && i + 1 < dataBuckets.size(); i++)
+	{
+		inPlace[i] = dataBuckets[i + 1] == dataBuckets[i];
+	}
+	return inPlace;
+}
+
 // backward
 float EasyCNN::NetWork::backward(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket, const float learningRate)
+{
+	const float loss = computeGradients(labelDataBucket);
+	applyGradients(gradientArena.get(), learningRate, labelDataBucket->getSize().number);
+	return loss;
+}
+
+float EasyCNN::NetWork::computeGradients(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket)
 {
 	logVerbose("NetWork backward begin.");
 	easyAssert(layers.size() > 1, "layer count is less than 2.");
 	easyAssert(layers[0]->getLayerType() == InputLayer::layerType, "first layer is not input layer.");
 	easyAssert(lossFunctor.get() != nullptr, "loss functor can't be empty!");
 
-	const auto lastOutputData = dataBuckets[dataBuckets.size() - 1];
+	const auto lastOutputData = outputBucket.get() != nullptr ? outputBucket : dataBuckets[dataBuckets.size() - 1];
 
 	easyAssert(lastOutputData->getSize() == labelDataBucket->getSize(), "last data bucket's size must be equals with label.");
+	if (paramArena.get() == nullptr)
+	{
+		planParamMemory();
+	}
+	//replanned only past the largest batch it was planned for, smaller ones reshape the views
+	const size_t number = lastOutputData->getSize().number;
+	if (diffArena.get() == nullptr || number > backwardNumber)
+	{
+		planBackwardMemory();
+	}
+	for (auto& bucket : reorderDiffBuckets)
+	{
+		if (bucket.get() != nullptr)
+		{
+			bucket->reshape(number);
+		}
+	}
+	if (outputDiffBucket.get() != nullptr)
+	{
+		outputDiffBucket->reshape(number);
+	}
 
 	//get loss
 	const float loss = lossFunctor->getLoss(labelDataBucket, lastOutputData);
 
 	//get diff
 	std::shared_ptr<DataBucket> nextDiffBucket = lossFunctor->getDiff(labelDataBucket, lastOutputData);
+	if (outputDiffBucket.get() != nullptr)
+	{
+		nextDiffBucket->convertTo(*outputDiffBucket, threadPool.get());
+		nextDiffBucket = outputDiffBucket;
+	}
 
 	//other layer backward
 	for (int i = (int)(layers.size()) - 1; i >= 0; i--)
 	{
 		logVerbose("NetWork layer[%d](%s) backward begin.", i, layers[i]->getLayerType().c_str());
-		layers[i]->setLearningRate(learningRate);
-		layers[i]->backward(dataBuckets[i], dataBuckets[i + 1], nextDiffBucket);
+		const bool reordered = reorderBuckets[i].get() != nullptr;
+		layers[i]->backward(reordered ? reorderBuckets[i] : dataBuckets[i], dataBuckets[i + 1], nextDiffBucket);
+		if (reordered && i > 0)
+		{
+			nextDiffBucket->convertTo(*reorderDiffBuckets[i], threadPool.get());
+			nextDiffBucket = reorderDiffBuckets[i];
+		}
 		logVerbose("NetWork layer[%d](%s) backward end.", i, layers[i]->getLayerType().c_str());
 	}
 	logVerbose("NetWork backward end.");
@@ -183,6 +515,67 @@ float EasyCNN::NetWork::backward(const std::shared_ptr<EasyCNN::DataBucket> labe
 	return loss;
 }
 
+void EasyCNN::NetWork::applyGradients(const float* gradients, const float learningRate, const size_t number)
+{
+	easyAssert(paramArena.get() != nullptr && number > 0, "no gradients to apply.");
+	optimizer->update(paramArena.get(), gradients, paramArenaSize, learningRate, 1.0f / number, threadPool.get());
+	onParamsChanged();
+}
+
+void EasyCNN::NetWork::setOptimizer(std::shared_ptr<Optimizer> optimizer)
+{
+	easyAssert(optimizer.get() != nullptr, "optimizer can't be empty!");
+	optimizer->reset();
+	this->optimizer = optimizer;
+}
+
+std::shared_ptr<EasyCNN::Optimizer> EasyCNN::NetWork::getOptimizer() const
+{
+	return optimizer;
+}
+
+float EasyCNN::NetWork::accumulateBatch(const std::shared_ptr<DataBucket> inputDataBucket, const std::shared_ptr<DataBucket> labelDataBucket)
+{
+	easyAssert(phase == Phase::Train, "phase must be train!");
+	logVerbose("NetWork accumulateBatch begin.");
+	forward(inputDataBucket);
+	const float loss = computeGradients(labelDataBucket);
+	const size_t number = labelDataBucket->getSize().number;
+	if (accumulatedGradientArena.get() == nullptr)
+	{
+		accumulatedGradientArena = allocateFloats(std::max<size_t>(gradientArenaSize, 1));
+	}
+	const float* gradients = gradientArena.get();
+	float* accumulated = accumulatedGradientArena.get();
+	const bool first = accumulatedNumber == 0;
+	parallelFor(threadPool.get(), gradientArenaSize, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		if (first)
+		{
+			std::copy(gradients + begin, gradients + end, accumulated + begin);
+		}
+		else
+		{
+			getBlas().axpy(end - begin, 1.0f, gradients + begin, accumulated + begin);
+		}
+	}, accumulateGrain);
+	accumulatedNumber += number;
+	logVerbose("NetWork accumulateBatch end.");
+	return loss;
+}
+
+float EasyCNN::NetWork::accumulateBatch(const float* inputData, const size_t number, const std::shared_ptr<DataBucket> labelDataBucket)
+{
+	return accumulateBatch(wrapInput(inputData, number), labelDataBucket);
+}
+
+void EasyCNN::NetWork::applyAccumulatedGradients(const float learningRate)
+{
+	easyAssert(accumulatedNumber > 0, "no batch was accumulated.");
+	applyGradients(accumulatedGradientArena.get(), learningRate, accumulatedNumber);
+	accumulatedNumber = 0;
+}
+
 //train only
 void EasyCNN::NetWork::setInputSize(const DataSize size)
 {
@@ -212,12 +605,46 @@ void EasyCNN::NetWork::addLayer(std::shared_ptr<Layer> layer)
 	easyAssert(prevDataBucket.get() != nullptr, "previous bucket is null.");
 	const DataSize inputSize = prevDataBucket->getSize();
 	layer->setPhase(phase);
+	layer->setThreadPool(threadPool);
 	layer->setInputBucketSize(inputSize);
 	layer->solveInnerParams();
 	const DataSize outputSize = layer->getOutputBucketSize();
-	std::shared_ptr<DataBucket> dataBucket = std::make_shared<DataBucket>(outputSize);
+	//layout, reorder only where the previous layer's layout doesn't suit this one
+	const DataLayout prevLayout = prevDataBucket->getLayout();
+	const DataLayout layout = layer->getPreferredLayout(prevLayout);
+	layer->setDataLayout(layout);
+	if (layout != prevLayout)
+	{
+		logVerbose("NetWork reorder %s -> %s before %s.", getLayoutName(prevLayout), getLayoutName(layout), layer_type.c_str());
+		reorderBuckets.push_back(std::make_shared<DataBucket>(inputSize, layout));
+	}
+	else
+	{
+		reorderBuckets.push_back(nullptr);
+	}
+	//in place layers share their input bucket, unless the layer before reads that bucket in its own backward
+	//or the bucket is the caller's input (only the input layer itself aliases that)
+	const std::shared_ptr<Layer> prevLayer = layers.size() > 1 ? layers[layers.size() - 2] : nullptr;
+	const bool inPlace = layer->isInPlaceCapable() && layout == prevLayout && outputSize == inputSize &&
+		(prevLayer.get() == nullptr || (!prevLayer->isOutputUsedInBackward() && prevDataBucket != dataBuckets[0]));
+	std::shared_ptr<DataBucket> dataBucket = inPlace ? prevDataBucket : std::make_shared<DataBucket>(outputSize, layout);
 	//dataBucket setting params
 	dataBuckets.push_back(dataBucket);
+	reorderDiffBuckets.push_back(nullptr);
+	if (layout != DataLayout::NCHW)
+	{
+		outputBucket = std::make_shared<DataBucket>(outputSize);
+	}
+	else
+	{
+		outputBucket.reset();
+	}
+	dropBackwardMemory();
+	//the param arena and the gradients accumulated so far don't cover the new layer
+	paramArena.reset();
+	paramArenaSize = 0;
+	accumulatedGradientArena.reset();
+	accumulatedNumber = 0;
 	logVerbose("NetWork addLayer end. add data bucket done.");
 }
 
@@ -231,26 +658,57 @@ float EasyCNN::NetWork::trainBatch(const std::shared_ptr<DataBucket> inputDataBu
 	return loss;
 }
 
+float EasyCNN::NetWork::trainBatch(const float* inputData, const size_t number, const std::shared_ptr<DataBucket> labelDataBucket, float learningRate)
+{
+	return trainBatch(wrapInput(inputData, number), labelDataBucket, learningRate);
+}
+
 bool EasyCNN::NetWork::saveModel(const std::string& modelFile)
 {
-	std::ofstream ofs(modelFile);
-	if (!ofs.is_open())
+	easyAssert(!dataBuckets.empty(), "network is empty.");
+	ModelFileContent content;
+	content.inputSize = dataBuckets[0]->getSize();
+	for (const auto& layer : layers)
+	{
+		ModelLayerRecord record;
+		record.desc = layer->serializeDescToString();
+		record.params = layer->getParamBuckets();
+		content.layers.push_back(record);
+	}
+	return writeModelFile(modelFile, content);
+}
+
+//test only
+bool EasyCNN::NetWork::loadModel(const std::string& modelFile, const bool verifyChecksums)
+{
+	return isModelFile(modelFile) ? loadBinaryModel(modelFile, verifyChecksums) : loadTextModel(modelFile);
+}
+
+bool EasyCNN::NetWork::loadBinaryModel(const std::string& modelFile, const bool verifyChecksums)
+{
+	ModelFileContent content;
+	if (!readModelFile(modelFile, content, verifyChecksums))
 	{
 		return false;
 	}
-	//network param
-	ofs << this->serializeToString() + "\n";
-	//layers' param
-	for (const auto& layer : layers)
+	setInputSize(content.inputSize);
+	for (const auto& record : content.layers)
 	{
-		ofs << layer->serializeToString() + "\n";
+		std::stringstream ss(record.desc);
+		std::string layerType;
+		ss >> layerType;
+		const std::shared_ptr<Layer> layer = createLayerByType(layerType);
+		layer->setInputBucketSize(dataBuckets.back()->getSize());
+		layer->serializeDescFromString(record.desc);
+		//the params are views into the mapped file, solveInnerParams (in addLayer) only checks their sizes
+		layer->setParamBuckets(record.params);
+		addLayer(layer);
 	}
-
+	setPhase(Phase::Test);
 	return true;
 }
 
-//test only
-bool EasyCNN::NetWork::loadModel(const std::string& modelFile)
+bool EasyCNN::NetWork::loadTextModel(const std::string& modelFile)
 {
 	std::ifstream ifs(modelFile);
 	if (!ifs.is_open())
@@ -279,8 +737,62 @@ bool EasyCNN::NetWork::loadModel(const std::string& modelFile)
 	return true;
 }
 
+void EasyCNN::NetWork::onParamsChanged()
+{
+	for (auto& layer : layers)
+	{
+		layer->onParamsChanged();
+	}
+}
+
+std::shared_ptr<EasyCNN::NetWork> EasyCNN::NetWork::createReplica()
+{
+	logVerbose("NetWork createReplica begin.");
+	easyAssert(layers.size() > 1, "network is not ready.");
+	if (paramArena.get() == nullptr)
+	{
+		planParamMemory();
+	}
+	std::shared_ptr<NetWork> replica = std::make_shared<NetWork>();
+	replica->setThreadCount(1);
+	replica->setPhase(phase);
+	replica->setInputSize(dataBuckets[0]->getSize());
+	for (const auto& layer : layers)
+	{
+		const std::shared_ptr<Layer> replicaLayer = createLayerByType(layer->getLayerType());
+		replicaLayer->setInputBucketSize(replica->dataBuckets.back()->getSize());
+		replicaLayer->serializeDescFromString(layer->serializeDescToString());
+		replicaLayer->setParamBuckets(layer->getParamBuckets());
+		replica->addLayer(replicaLayer);
+	}
+	//the replica's params are views into this network's arena, it never plans one of its own
+	replica->paramArena = paramArena;
+	replica->paramArenaSize = paramArenaSize;
+	//a layer acting as the loss functor is replaced by the replica's own, other functors are cloned
+	if (lossFunctor.get() != nullptr)
+	{
+		if (lossFunctor == std::dynamic_pointer_cast<LossFunctor>(layers.back()))
+		{
+			replica->setLossFunctor(std::dynamic_pointer_cast<LossFunctor>(replica->layers.back()));
+		}
+		else
+		{
+			const std::shared_ptr<LossFunctor> replicaLossFunctor = lossFunctor->clone();
+			easyAssert(replicaLossFunctor.get() != nullptr, "loss functor doesn't implement clone, it can't be replicated.");
+			replica->setLossFunctor(replicaLossFunctor);
+		}
+	}
+	logVerbose("NetWork createReplica end.");
+	return replica;
+}
+
 //train phase may use this
 std::shared_ptr<EasyCNN::DataBucket> EasyCNN::NetWork::testBatch(const std::shared_ptr<DataBucket> inputDataBucket)
 {
 	return forward(inputDataBucket);
 }
+
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::NetWork::testBatch(const float* inputData, const size_t number)
+{
+	return forward(wrapInput(inputData, number));
+}
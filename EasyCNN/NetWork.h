@@ -5,11 +5,16 @@
 #include "Configure.h"
 #include "Layer.h"
 #include "LossFunction.h"
+#include "Optimizer.h"
 
 namespace EasyCNN
 {
+	//one network's layers and params are shared by any number of ExecutionContexts for concurrent inference,
+	//the network's own testBatch / trainBatch run on its own buckets and are not thread safe.
 	class NetWork
 	{
+		friend class ExecutionContext;
+		friend class DataParallelTrainer;
 	public:
 		NetWork();
 		virtual ~NetWork();
@@ -17,15 +22,36 @@ namespace EasyCNN
 		//common
 		void setPhase(Phase phase);
 		Phase getPhase() const;
-		//test only!
-		bool loadModel(const std::string& modelFile);
+		//threadCount 0 uses every hardware thread, pinThreads binds each worker to one core
+		void setThreadCount(const size_t threadCount, const bool pinThreads = false);
+		size_t getThreadCount() const;
+		//test only! binary models are mapped and their params used in place, text ones (older saves) are parsed.
+		//header and layer records are always verified, verifyChecksums also reads every param blob up front.
+		bool loadModel(const std::string& modelFile, const bool verifyChecksums = false);
+		//the input bucket is bound as the network's input without a copy, and only read.
+		//it has to be NCHW and sized like the input, the network keeps a reference until the next batch.
 		std::shared_ptr<EasyCNN::DataBucket> testBatch(const std::shared_ptr<DataBucket> inputDataBucket);
+		//the same on a caller's buffer : number samples shaped like the input, NCHW, valid during the call.
+		//64 byte aligned buffers keep the first layer's simd loads aligned.
+		std::shared_ptr<EasyCNN::DataBucket> testBatch(const float* inputData, const size_t number);
 		//train only!
 		void setInputSize(const DataSize size);
 		void setLossFunctor(std::shared_ptr<LossFunctor> lossFunctor);
 		void addLayer(std::shared_ptr<Layer> layer);
 		float trainBatch(const std::shared_ptr<DataBucket> inputDataBucket,
 			const std::shared_ptr<DataBucket> labelDataBucket, float learningRate);
+		float trainBatch(const float* inputData, const size_t number,
+			const std::shared_ptr<DataBucket> labelDataBucket, float learningRate);
+		//how gradients become updates, plain sgd unless set. setting one starts its state (moments) from scratch.
+		void setOptimizer(std::shared_ptr<Optimizer> optimizer);
+		std::shared_ptr<Optimizer> getOptimizer() const;
+		//gradient accumulation : accumulateBatch runs forward and backward and adds the gradients to the ones
+		//accumulated so far, leaving the params alone. applyAccumulatedGradients makes one optimizer step of them all,
+		//as trainBatch on every accumulated sample at once would, and starts over.
+		float accumulateBatch(const std::shared_ptr<DataBucket> inputDataBucket, const std::shared_ptr<DataBucket> labelDataBucket);
+		float accumulateBatch(const float* inputData, const size_t number, const std::shared_ptr<DataBucket> labelDataBucket);
+		void applyAccumulatedGradients(float learningRate);
+		//binary model, see ModelFile.h
 		bool saveModel(const std::string& modelFile);
 	private:
 		std::string encrypt(const std::string& content);
@@ -34,13 +60,76 @@ namespace EasyCNN
 		//common
 		std::shared_ptr<EasyCNN::DataBucket> forward(const std::shared_ptr<DataBucket> inputDataBucket);
 		float backward(const std::shared_ptr<DataBucket> labelDataBucket, float learningRate);
+		//backward without the update : every layer's gradients, summed over the batch, land in its gradient buckets
+		float computeGradients(const std::shared_ptr<DataBucket> labelDataBucket);
+		//one optimizer step over the param arena, gradients laid out as it and summed over number samples
+		void applyGradients(const float* gradients, const float learningRate, const size_t number);
+		//a network of the same layers over the same param buckets (no copy), with its own buckets, workspaces
+		//and a single thread. the replica's layers must be told (onParamsChanged) when this network updates the params.
+		//plans the param arena first, the replica shares it.
+		std::shared_ptr<NetWork> createReplica();
+		//tells every layer its params changed from outside
+		void onParamsChanged();
 		std::string serializeToString() const;
 		std::vector<std::shared_ptr<EasyCNN::Layer>> serializeFromString(const std::string content);
+		bool loadBinaryModel(const std::string& modelFile, const bool verifyChecksums);
+		bool loadTextModel(const std::string& modelFile);
 		std::shared_ptr<EasyCNN::Layer> createLayerByType(const std::string layerType);
+		std::shared_ptr<EasyCNN::DataBucket> getOutputBucket();
+		//batch size change within the planned capacity, no allocation
+		void reshapeActivations(const size_t number);
+		//dataBuckets[0] and every bucket aliasing it become inputDataBucket
+		void bindInput(const std::shared_ptr<DataBucket> inputDataBucket);
+		//the caller's buffer as the input, through one view rebound on every call
+		std::shared_ptr<DataBucket> wrapInput(const float* inputData, const size_t number);
+		//test phase : every activation bucket becomes a view into one arena, buckets whose lifetimes
+		//don't overlap share memory. the backward memory is dropped until the network goes back to train.
+		void planActivationMemory(const size_t number);
+		//train phase : one bucket per tensor again, backward needs them all
+		void releaseActivationMemory(const size_t number);
+		//train phase : every diff bucket (the layers' own, reorder and output diffs) becomes a view into one arena
+		//packed by lifetime over the backward pass, every gradient bucket a view into a second one.
+		//planned by the first backward after the net or its batch size changes, later batches allocate nothing.
+		void planBackwardMemory();
+		//train phase : every layer's params move into one arena, padded per tensor as the gradient arena,
+		//so the optimizer makes one pass over both. planned by the first backward after the layers change.
+		void planParamMemory();
+		//sum of the params' sizes, each rounded up to slotAlignment : the size of the param and gradient arenas
+		size_t getParamArenaSize() const;
+		void dropBackwardMemory();
+		//layer i runs in place when its output bucket is its input bucket
+		std::vector<bool> getInPlaceLayers() const;
 	private:
 		Phase phase = Phase::Train;
 		std::vector<std::shared_ptr<Layer>> layers;
 		std::vector<std::shared_ptr<DataBucket>> dataBuckets;
+		//layer i reads reorderBuckets[i] when its layout differs from the previous layer's, null otherwise.
+		//its diff goes back through reorderDiffBuckets[i].
+		std::vector<std::shared_ptr<DataBucket>> reorderBuckets;
+		std::vector<std::shared_ptr<DataBucket>> reorderDiffBuckets;
+		//NCHW copies of the last output and its diff when the last layer works in another layout
+		std::shared_ptr<DataBucket> outputBucket;
+		std::shared_ptr<DataBucket> outputDiffBucket;
+		//the view wrapInput binds the raw pointer batches through
+		std::shared_ptr<DataBucket> inputView;
 		std::shared_ptr<LossFunctor> lossFunctor;
+		//backs every activation bucket in test phase, null otherwise
+		std::shared_ptr<float> activationArena;
+		//the batch size the activation / backward arenas have room for
+		size_t activationNumber = 0;
+		size_t backwardNumber = 0;
+		//back every diff / gradient bucket once backward is planned, null otherwise
+		std::shared_ptr<float> diffArena;
+		std::shared_ptr<float> gradientArena;
+		//floats in gradientArena, every layer's gradients one after another in layer order
+		size_t gradientArenaSize = 0;
+		//backs every layer's params once planned, null otherwise. laid out as gradientArena, padding stays 0
+		std::shared_ptr<float> paramArena;
+		size_t paramArenaSize = 0;
+		std::shared_ptr<Optimizer> optimizer;
+		//gradients added up by accumulateBatch over accumulatedNumber samples, laid out as gradientArena
+		std::shared_ptr<float> accumulatedGradientArena;
+		size_t accumulatedNumber = 0;
+		std::shared_ptr<ThreadPool> threadPool;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+#include "Optimizer.h"
+#include "Allocator.h"
+#include "EasyAssert.h"
+#include "Kernels.h"
+
+//one pass over the arena : every thread updates runs of this many floats (a multiple of any vector width)
+static const size_t updateGrain = 16384;
+
+static std::shared_ptr<float> allocateState(const size_t size)
+{
+	const std::shared_ptr<float> state = EasyCNN::allocateFloats(std::max<size_t>(size, 1));
+	std::fill(state.get(), state.get() + size, 0.0f);
+	return state;
+}
+
+//SGDOptimizer
+const char* EasyCNN::SGDOptimizer::getName() const
+{
+	return "sgd";
+}
+
+void EasyCNN::SGDOptimizer::update(float* params, const float* gradients, const size_t size,
+	const float learningRate, const float gradientScale, ThreadPool* pool)
+{
+	const float alpha = -learningRate * gradientScale;
+	const KernelTable& kernels = getKernels();
+	parallelFor(pool, size, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		kernels.axpy(end - begin, alpha, gradients + begin, params + begin);
+	}, updateGrain);
+}
+
+//MomentumOptimizer
+EasyCNN::MomentumOptimizer::MomentumOptimizer(const float momentum, const bool nesterov)
+	:momentum(momentum), nesterov(nesterov)
+{
+	easyAssert(momentum >= 0.0f && momentum < 1.0f, "momentum must be in [0, 1).");
+}
+
+const char* EasyCNN::MomentumOptimizer::getName() const
+{
+	return nesterov ? "nesterov" : "momentum";
+}
+
+void EasyCNN::MomentumOptimizer::update(float* params, const float* gradients, const size_t size,
+	const float learningRate, const float gradientScale, ThreadPool* pool)
+{
+	if (velocity.get() == nullptr || stateSize != size)
+	{
+		velocity = allocateState(size);
+		stateSize = size;
+	}
+	MomentumStep step;
+	step.learningRate = learningRate;
+	step.gradientScale = gradientScale;
+	step.momentum = momentum;
+	step.nesterov = nesterov;
+	float* velocityData = velocity.get();
+	const KernelTable& kernels = getKernels();
+	parallelFor(pool, size, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		kernels.momentumUpdate(params + begin, velocityData + begin, gradients + begin, end - begin, step);
+	}, updateGrain);
+}
+
+void EasyCNN::MomentumOptimizer::reset()
+{
+	velocity.reset();
+	stateSize = 0;
+}
+
+//AdamOptimizer
+EasyCNN::AdamOptimizer::AdamOptimizer(const float beta1, const float beta2, const float epsilon)
+	:beta1(beta1), beta2(beta2), epsilon(epsilon)
+{
+	easyAssert(beta1 >= 0.0f && beta1 < 1.0f && beta2 >= 0.0f && beta2 < 1.0f && epsilon > 0.0f, "adam parameters are invalidate.");
+}
+
+const char* EasyCNN::AdamOptimizer::getName() const
+{
+	return "adam";
+}
+
+void EasyCNN::AdamOptimizer::update(float* params, const float* gradients, const size_t size,
+	const float learningRate, const float gradientScale, ThreadPool* pool)
+{
+	if (firstMoment.get() == nullptr || stateSize != size)
+	{
+		firstMoment = allocateState(size);
+		secondMoment = allocateState(size);
+		stateSize = size;
+		step = 0;
+	}
+	step++;
+	//lr * m^ / (sqrt(v^) + eps) with m^ = m / (1 - beta1^t), v^ = v / (1 - beta2^t), rewritten on m and v
+	const double correction1 = 1.0 - std::pow((double)beta1, (double)step);
+	const double correction2 = std::sqrt(1.0 - std::pow((double)beta2, (double)step));
+	AdamStep adamStep;
+	adamStep.stepSize = (float)(learningRate * correction2 / correction1);
+	adamStep.epsilon = (float)(epsilon * correction2);
+	adamStep.gradientScale = gradientScale;
+	adamStep.beta1 = beta1;
+	adamStep.beta2 = beta2;
+	float* m = firstMoment.get();
+	float* v = secondMoment.get();
+	const KernelTable& kernels = getKernels();
+	parallelFor(pool, size, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		kernels.adamUpdate(params + begin, m + begin, v + begin, gradients + begin, end - begin, adamStep);
+	}, updateGrain);
+}
+
+void EasyCNN::AdamOptimizer::reset()
+{
+	firstMoment.reset();
+	secondMoment.reset();
+	stateSize = 0;
+	step = 0;
+}
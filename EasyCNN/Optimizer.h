@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "Configure.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	//turns gradients into a param update. the network calls update once per step over its whole param arena :
+	//params, gradients and every state buffer of the optimizer line up element for element.
+	//the gradients are sums over a batch (or over accumulated micro batches), gradientScale is 1 / samples.
+	class Optimizer
+	{
+	public:
+		virtual ~Optimizer() {}
+		virtual const char* getName() const = 0;
+		//size is the same every step, a new size (the network's layers changed) starts the state over
+		virtual void update(float* params, const float* gradients, const size_t size,
+			const float learningRate, const float gradientScale, ThreadPool* pool) = 0;
+		//forgets the state (moments, step count), the next step starts from scratch
+		virtual void reset() {}
+	};
+
+	//params -= learningRate * g
+	class SGDOptimizer : public Optimizer
+	{
+	public:
+		virtual const char* getName() const override;
+		virtual void update(float* params, const float* gradients, const size_t size,
+			const float learningRate, const float gradientScale, ThreadPool* pool) override;
+	};
+
+	//heavy ball momentum, or nesterov's look ahead variant (see MomentumStep)
+	class MomentumOptimizer : public Optimizer
+	{
+	public:
+		explicit MomentumOptimizer(const float momentum = 0.9f, const bool nesterov = false);
+		virtual const char* getName() const override;
+		virtual void update(float* params, const float* gradients, const size_t size,
+			const float learningRate, const float gradientScale, ThreadPool* pool) override;
+		virtual void reset() override;
+	private:
+		float momentum = 0.9f;
+		bool nesterov = false;
+		std::shared_ptr<float> velocity;
+		size_t stateSize = 0;
+	};
+
+	//adam (Kingma & Ba), bias corrected
+	class AdamOptimizer : public Optimizer
+	{
+	public:
+		explicit AdamOptimizer(const float beta1 = 0.9f, const float beta2 = 0.999f, const float epsilon = 1e-8f);
+		virtual const char* getName() const override;
+		virtual void update(float* params, const float* gradients, const size_t size,
+			const float learningRate, const float gradientScale, ThreadPool* pool) override;
+		virtual void reset() override;
+	private:
+		float beta1 = 0.9f;
+		float beta2 = 0.999f;
+		float epsilon = 1e-8f;
+		std::shared_ptr<float> firstMoment;
+		std::shared_ptr<float> secondMoment;
+		size_t stateSize = 0;
+		uint64_t step = 0;
+	};
+}
@@ -1,9 +1,14 @@
 #include "ParamBucket.h"
 
-EasyCNN::ParamBucket::ParamBucket(const ParamSize _size):size(_size),data(new float[size._4DSize()])
+EasyCNN::ParamBucket::ParamBucket(const ParamSize _size, std::shared_ptr<Allocator> allocator) :size(_size), data(allocateFloats(size._4DSize(), allocator))
 {
 }
 
+EasyCNN::ParamBucket::ParamBucket(const ParamSize _size, std::shared_ptr<float> _data) : size(_size), data(_data)
+{
+	easyAssert(data.get() != nullptr, "data can't be null.");
+}
+
 EasyCNN::ParamBucket::~ParamBucket()
 {
 
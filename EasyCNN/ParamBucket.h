@@ -5,6 +5,7 @@
 #include "Configure.h"
 #include "EasyLogger.h"
 #include "EasyAssert.h"
+#include "Allocator.h"
 
 namespace EasyCNN
 {
@@ -35,7 +36,10 @@ namespace EasyCNN
 	class ParamBucket
 	{
 	public:
-		ParamBucket(const ParamSize _size);
+		//storage from allocator, null for the default one
+		ParamBucket(const ParamSize _size, std::shared_ptr<Allocator> allocator = nullptr);
+		//a view on storage owned elsewhere, _data holds at least _size._4DSize() floats
+		ParamBucket(const ParamSize _size, std::shared_ptr<float> _data);
 		virtual ~ParamBucket();
 		ParamSize getSize() const;
 		std::shared_ptr<float> getData() const;
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <sstream>
 #include "PoolingLayer.h"
+#include "Kernels.h"
 
 #if WITH_OPENCV_DEBUG
 #include "opencv2/opencv.hpp"
@@ -28,6 +29,17 @@ void EasyCNN::PoolingLayer::setParamaters(const PoolingType _poolingType, const
 }
 
 std::string EasyCNN::PoolingLayer::serializeToString() const
+{
+	return serializeDescToString();
+}
+
+void EasyCNN::PoolingLayer::serializeFromString(const std::string content)
+{
+	serializeDescFromString(content);
+	solveInnerParams();
+}
+
+std::string EasyCNN::PoolingLayer::serializeDescToString() const
 {
 	const std::string spliter = " ";
 	std::stringstream ss;
@@ -45,7 +57,7 @@ std::string EasyCNN::PoolingLayer::serializeToString() const
 	return ss.str();
 }
 
-void EasyCNN::PoolingLayer::serializeFromString(const std::string content)
+void EasyCNN::PoolingLayer::serializeDescFromString(const std::string content)
 {
 	std::stringstream ss(content);
 	//layer desc
@@ -62,11 +74,10 @@ void EasyCNN::PoolingLayer::serializeFromString(const std::string content)
 	poolingType = (PoolingType)_poolingType;
 	easyAssert(_layerType == getLayerType(), "layer type is invalidate.");
 	easyAssert((poolingType == MaxPooling || poolingType == MeanPooling), "pooling type is invalidate.");
-	solveInnerParams();
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::PoolingLayer, "PoolingLayer");
-std::string EasyCNN::PoolingLayer::getLayerType() const
+const std::string& EasyCNN::PoolingLayer::getLayerType() const
 {
 	return layerType;
 }
@@ -86,86 +97,69 @@ void EasyCNN::PoolingLayer::solveInnerParams()
 	outputSize.width = (inputSize.width - poolingKernelSize.width) / widthStep + 1;
 	outputSize.height = (inputSize.height - poolingKernelSize.height) / heightStep + 1;
 	setOutpuBuckerSize(outputSize);
+}
 
-	if (getPhase() == Phase::Train && poolingType == PoolingType::MaxPooling)
-	{
-		maxIdxesBucket.reset(new ParamBucket(ParamSize(outputSize.number, outputSize.channels, outputSize.height, outputSize.width)));
-	}
+std::shared_ptr<EasyCNN::LayerWorkspace> EasyCNN::PoolingLayer::createWorkspace() const
+{
+	return std::make_shared<Workspace>();
+}
+
+EasyCNN::DataLayout EasyCNN::PoolingLayer::getPreferredLayout(const DataLayout prevLayout) const
+{
+	return prevLayout;
 }
 
-void EasyCNN::PoolingLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+//the window walk is shared by all layouts : a task owns one channel block of one sample,
+//the innermost loop runs over the block's lanes, contiguous in memory (one lane for NCHW).
+//forward rows go through the isa dispatched pool kernels.
+void EasyCNN::PoolingLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
+	const DataLayout layout = getDataLayout();
+	easyAssert(prevDataBucket->getLayout() == layout && nextDataBucket->getLayout() == layout, "data layout is invalidate.");
 
 	const float* prevData = prevDataBucket->getData().get();
 	float* nextData = nextDataBucket->getData().get();
-	float* maxIdxes = nullptr;
+	float* maxIdx = nullptr;
 
 	if (getPhase() == Phase::Train && poolingType == PoolingType::MaxPooling)
 	{
-		auto newSize = maxIdxesBucket->getSize();
-		if (newSize.number != prevDataSize.number)
-		{
-			newSize.number = prevDataSize.number;
-			maxIdxesBucket.reset(new ParamBucket(newSize));
-		}
-		maxIdxes = maxIdxesBucket->getData().get();
+		std::vector<float>& maxIdxes = static_cast<Workspace*>(workspace)->maxIdxes;
+		maxIdxes.resize(nextDataBucket->getStorageSize());
+		maxIdx = &maxIdxes[0];
 	}
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	const size_t block = getChannelBlock(layout, nextDataSize.channels);
+	const size_t channelBlocks = getPaddedChannels(layout, nextDataSize.channels) / block;
+	const PoolWindow window = { prevDataSize.width, block, poolingKernelSize.height, poolingKernelSize.width, widthStep, nextDataSize.width };
+	const KernelTable& kernels = getKernels();
+	parallelFor(pool, nextDataSize.number * channelBlocks, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		for (size_t task = begin; task < end; task++)
 		{
+			const size_t nn = task / channelBlocks;
+			const size_t nc = task % channelBlocks * block;
+			const float* prevBlock = prevData + getLayoutIndex(prevDataSize, layout, nn, nc, 0, 0);
+			const size_t nextBlockOffset = getLayoutIndex(nextDataSize, layout, nn, nc, 0, 0);
 			for (size_t nh = 0; nh < nextDataSize.height; nh++)
 			{
-				for (size_t nw = 0; nw < nextDataSize.width; nw++)
+				const float* windowRow = prevBlock + nh * heightStep * prevDataSize.width * block;
+				const size_t nextRowOffset = nextBlockOffset + nh * nextDataSize.width * block;
+				//MaxPooling
+				if (poolingType == PoolingType::MaxPooling)
 				{
-					const size_t inStartX = nw * widthStep;
-					const size_t inStartY = nh * heightStep;
-					const size_t nextDataIdx = nextDataSize.getIndex(nn, nc, nh, nw);
-
-					float result = 0;
-					size_t maxIdx = 0;
-					//MaxPooling
-					if (poolingType == PoolingType::MaxPooling)
-					{
-						for (size_t ph = 0; ph < poolingKernelSize.height; ph++)
-						{
-							for (size_t pw = 0; pw < poolingKernelSize.width; pw++)
-							{
-								const size_t prevDataIdx = prevDataSize.getIndex(nn, nc, inStartY + ph, inStartX + pw);
-								if (result < prevData[prevDataIdx])
-								{
-									result = prevData[prevDataIdx];
-									maxIdx = ph * poolingKernelSize.width + pw;
-								}
-							}
-						}
-						if (maxIdxes)
-						{
-							maxIdxes[nextDataIdx] = (float)maxIdx;
-						}
-					}
-					//MeanPooling
-					else if (poolingType == PoolingType::MeanPooling)
-					{
-						for (size_t ph = 0; ph < poolingKernelSize.height; ph++)
-						{
-							for (size_t pw = 0; pw < poolingKernelSize.width; pw++)
-							{
-								const size_t prevDataIdx = prevDataSize.getIndex(nc, inStartY + ph, inStartX + pw);
-								result += prevData[prevDataIdx];
-							}
-						}
-						result /= poolingKernelSize.width * poolingKernelSize.height;
-					}
-
-					nextData[nextDataIdx] = result;
+					kernels.maxPoolRow(windowRow, window, nextData + nextRowOffset, maxIdx ? maxIdx + nextRowOffset : nullptr);
+				}
+				//MeanPooling
+				else if (poolingType == PoolingType::MeanPooling)
+				{
+					kernels.meanPoolRow(windowRow, window, nextData + nextRowOffset);
 				}
 			}
 		}
-	}
+	});
 }
 
 void EasyCNN::PoolingLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
@@ -173,69 +167,80 @@ void EasyCNN::PoolingLayer::backward(std::shared_ptr<DataBucket> prevDataBucket,
 	easyAssert(getPhase() == Phase::Train, "backward only in train phase.")
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
-	const DataSize nextDiffSize = nextDiffBucket->getSize();
-	easyAssert(maxIdxesBucket->getSize()._3DSize() == nextDataSize._3DSize(), "idx size must equals with next data.");
+	const DataLayout layout = getDataLayout();
+	easyAssert(nextDiffBucket->getLayout() == layout, "diff layout is invalidate.");
+	const std::vector<float>& maxIdxes = static_cast<Workspace*>(getWorkspace())->maxIdxes;
+	if (poolingType == PoolingType::MaxPooling)
+	{
+		easyAssert(maxIdxes.size() == nextDataBucket->getStorageSize(), "idx size must equals with next data.");
+	}
 
 	//update prevDiff data
-	const float* maxIdxes = maxIdxesBucket->getData().get();
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
+	const float* maxIdxData = poolingType == PoolingType::MaxPooling ? &maxIdxes[0] : nullptr;
+	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.width, prevDataSize.height);
+	const std::shared_ptr<DataBucket> prevDiffBucket = getDiffBucket(prevDiffSize, layout);
 	prevDiffBucket->fillData(0.0f);
 
 	//calculate current inner diff 
 	//none
 	//pass next layer's diff to previous layer
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	const float* nextDiff = nextDiffBucket->getData().get();
+	float* prevDiff = prevDiffBucket->getData().get();
+	const size_t block = getChannelBlock(layout, nextDataSize.channels);
+	const size_t channelBlocks = getPaddedChannels(layout, nextDataSize.channels) / block;
+	const float windowSize = (float)(poolingKernelSize._2DSize());
+	parallelFor(getThreadPool(), prevDataSize.number * channelBlocks, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		const float* nextDiff = nextDiffBucket->getData().get() + pn * nextDiffSize._3DSize();
-		float* prevDiff = prevDiffBucket->getData().get() + pn * prevDataSize._3DSize();
-
-		for (size_t nc = 0; nc < nextDataSize.channels; nc++)
+		for (size_t task = begin; task < end; task++)
 		{
+			const size_t pn = task / channelBlocks;
+			const size_t nc = task % channelBlocks * block;
+			float* prevBlock = prevDiff + getLayoutIndex(prevDataSize, layout, pn, nc, 0, 0);
+			const size_t nextBlockOffset = getLayoutIndex(nextDataSize, layout, pn, nc, 0, 0);
 			for (size_t nh = 0; nh < nextDataSize.height; nh++)
 			{
 				for (size_t nw = 0; nw < nextDataSize.width; nw++)
 				{
 					const size_t inStartX = nw * widthStep;
 					const size_t inStartY = nh * heightStep;
-					const size_t nextDataIdx = nextDataSize.getIndex(nc, nh, nw);
+					const size_t nextDataIdx = nextBlockOffset + (nh * nextDataSize.width + nw) * block;
+					const float* diff = nextDiff + nextDataIdx;
 
-					//MaxPooling
-					if (poolingType == PoolingType::MaxPooling)
+					for (size_t ph = 0; ph < poolingKernelSize.height; ph++)
 					{
-						for (size_t ph = 0; ph < poolingKernelSize.height; ph++)
+						for (size_t pw = 0; pw < poolingKernelSize.width; pw++)
 						{
-							for (size_t pw = 0; pw < poolingKernelSize.width; pw++)
+							float* dst = prevBlock + ((inStartY + ph) * prevDataSize.width + inStartX + pw) * block;
+							//MaxPooling
+							if (poolingType == PoolingType::MaxPooling)
 							{
-								const size_t prevDiffIdx = prevDataSize.getIndex(nc, inStartY + ph, inStartX + pw);
-								if (ph * poolingKernelSize.width + pw == maxIdxes[nextDataIdx])
+								const float* maxIdx = maxIdxData + nextDataIdx;
+								const float windowIdx = (float)(ph * poolingKernelSize.width + pw);
+								for (size_t lane = 0; lane < block; lane++)
 								{
-									prevDiff[prevDiffIdx] += nextDiff[nextDataIdx];
+									if (maxIdx[lane] == windowIdx)
+									{
+										dst[lane] += diff[lane];
+									}
 								}
 							}
-						}
-					}
-					//MeanPooling
-					else if (poolingType == PoolingType::MeanPooling)
-					{
-						const float meanDiff = nextDiff[nextDataIdx] / (float)(poolingKernelSize._2DSize());
-
-						for (size_t ph = 0; ph < poolingKernelSize.height; ph++)
-						{
-							for (size_t pw = 0; pw < poolingKernelSize.width; pw++)
+							//MeanPooling
+							else if (poolingType == PoolingType::MeanPooling)
 							{
-								const size_t prevDiffIdx = prevDataSize.getIndex(nc, inStartY + ph, inStartX + pw);
-								prevDiff[prevDiffIdx] += meanDiff;
+								for (size_t lane = 0; lane < block; lane++)
+								{
+									dst[lane] += diff[lane] / windowSize;
+								}
 							}
 						}
 					}
 				}
 			}
 		}
-	}
+	});
 
 	//update this layer's param
 	//nop
 
 	nextDiffBucket = prevDiffBucket;
-}
\ No newline at end of file
+}
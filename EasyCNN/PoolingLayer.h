@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "Configure.h"
 #include "Layer.h"
 
@@ -21,14 +22,25 @@ namespace EasyCNN
 	protected:
 		virtual std::string serializeToString() const override;
 		virtual void serializeFromString(const std::string content) override;
+		virtual std::string serializeDescToString() const override;
+		virtual void serializeDescFromString(const std::string content) override;
 		DECLARE_LAYER_TYPE;
-		virtual std::string getLayerType() const override;
+		virtual const std::string& getLayerType() const override;
 		virtual void solveInnerParams() override;
-		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket) override;
+		//every layout, pools whole channel blocks at once
+		virtual DataLayout getPreferredLayout(const DataLayout prevLayout) const override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
 		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
+	private:
+		struct Workspace : public LayerWorkspace
+		{
+			//window index of every max pooling output, train phase only. sized to the batch, it never shrinks
+			std::vector<float> maxIdxes;
+		};
+		virtual std::shared_ptr<LayerWorkspace> createWorkspace() const override;
 	private:
 		PoolingType poolingType = PoolingType::MaxPooling;
-		std::shared_ptr<ParamBucket> maxIdxesBucket;
 		ParamSize poolingKernelSize;
 		size_t widthStep = 0;
 		size_t heightStep = 0;
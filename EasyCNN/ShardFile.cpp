@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <cstring>
+#include "ShardFile.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "IdxDataset.h"
+#include "ModelFile.h"
+
+static const char shardFileMagic[8] = { 'E', 'C', 'N', 'N', 'S', 'H', 'D', 0 };
+static const size_t headerSize = 64;
+//the header's checksum covers everything in front of it
+static const size_t headerChecksumOffset = headerSize - sizeof(uint64_t);
+
+//header fields at fixed offsets
+template<typename T>
+static void putField(char* header, const size_t offset, const T value)
+{
+	memcpy(header + offset, &value, sizeof(T));
+}
+
+template<typename T>
+static T getField(const char* header, const size_t offset)
+{
+	T value;
+	memcpy(&value, header + offset, sizeof(T));
+	return value;
+}
+
+//ShardHeader
+size_t EasyCNN::ShardHeader::getRecordSize() const
+{
+	return sampleSize._3DSize() * (payload == ShardPayload::Float ? sizeof(float) : sizeof(uint8_t));
+}
+
+bool EasyCNN::readShardHeader(std::ifstream& ifs, const std::string& path, ShardHeader& header, std::vector<ShardIndexEntry>* index)
+{
+	char bytes[headerSize] = { 0 };
+	ifs.clear();
+	ifs.seekg(0);
+	if (!ifs.read(bytes, headerSize) || memcmp(bytes, shardFileMagic, sizeof(shardFileMagic)) != 0)
+	{
+		logCritical("%s is not a shard.", path.c_str());
+		return false;
+	}
+	const uint32_t version = getField<uint32_t>(bytes, 8);
+	if (version > shardFileVersion)
+	{
+		logCritical("shard version %u isn't supported, this build reads up to %u.", version, shardFileVersion);
+		return false;
+	}
+	if (getField<uint64_t>(bytes, headerChecksumOffset) != computeChecksum(bytes, headerChecksumOffset))
+	{
+		logCritical("shard %s header is corrupted.", path.c_str());
+		return false;
+	}
+	const uint32_t payload = getField<uint32_t>(bytes, 12);
+	if (payload != (uint32_t)ShardPayload::UInt8 && payload != (uint32_t)ShardPayload::Float)
+	{
+		logCritical("shard %s has an unknown payload type %u.", path.c_str(), payload);
+		return false;
+	}
+	header.payload = (ShardPayload)payload;
+	header.sampleSize = DataSize(1, getField<uint32_t>(bytes, 16), getField<uint32_t>(bytes, 24), getField<uint32_t>(bytes, 20));
+	header.classCount = getField<uint32_t>(bytes, 28);
+	header.recordCount = (size_t)getField<uint64_t>(bytes, 32);
+	header.indexOffset = getField<uint64_t>(bytes, 40);
+	header.indexChecksum = getField<uint64_t>(bytes, 48);
+	//the payloads fill the file from the header to the index
+	const uint64_t recordSize = header.getRecordSize();
+	if (recordSize == 0 || header.indexOffset < headerSize ||
+		(header.indexOffset - headerSize) / recordSize != header.recordCount || (header.indexOffset - headerSize) % recordSize != 0)
+	{
+		logCritical("shard %s header is inconsistent.", path.c_str());
+		return false;
+	}
+	//the index must lie in the file, nothing is sized after a header claiming more
+	ifs.seekg(0, std::ios::end);
+	const uint64_t fileSize = (uint64_t)ifs.tellg();
+	if (!ifs || header.indexOffset > fileSize || header.recordCount > (fileSize - header.indexOffset) / sizeof(ShardIndexEntry))
+	{
+		logCritical("shard %s is shorter than its header says.", path.c_str());
+		return false;
+	}
+	if (index == nullptr)
+	{
+		return true;
+	}
+	index->resize(header.recordCount);
+	const size_t indexBytes = header.recordCount * sizeof(ShardIndexEntry);
+	ifs.seekg(header.indexOffset);
+	if (!ifs.read((char*)index->data(), indexBytes) || computeChecksum(index->data(), indexBytes) != header.indexChecksum)
+	{
+		logCritical("shard %s index is truncated or corrupted.", path.c_str());
+		return false;
+	}
+	for (size_t i = 0; i < header.recordCount; i++)
+	{
+		const ShardIndexEntry& entry = (*index)[i];
+		if (entry.offset != headerSize + i * recordSize || entry.label >= header.classCount)
+		{
+			logCritical("shard %s index entry %u is invalid.", path.c_str(), (unsigned int)i);
+			return false;
+		}
+	}
+	return true;
+}
+
+//ShardWriter
+EasyCNN::ShardWriter::ShardWriter(const std::string& pathPrefix, const DataSize& sampleSize, const ShardPayload payload,
+	const size_t classCount, const size_t recordsPerShard)
+	:pathPrefix(pathPrefix), recordsPerShard(recordsPerShard)
+{
+	logVerbose("ShardWriter constructed.");
+	easyAssert(sampleSize._3DSize() > 0 && classCount > 0 && recordsPerShard > 0, "shard sample size, class count and records per shard can't be 0.");
+	header.payload = payload;
+	header.sampleSize = sampleSize;
+	header.sampleSize.number = 1;
+	header.classCount = classCount;
+	index.reserve(recordsPerShard);
+}
+
+EasyCNN::ShardWriter::~ShardWriter()
+{
+	finish();
+	logVerbose("ShardWriter destructed.");
+}
+
+bool EasyCNN::ShardWriter::openShard()
+{
+	char suffix[32] = { 0 };
+	snprintf(suffix, sizeof(suffix), "-%05u.shard", (unsigned int)shardPaths.size());
+	const std::string path = pathPrefix + suffix;
+	ofs.open(path, std::ios::binary | std::ios::trunc);
+	if (!ofs.is_open())
+	{
+		logCritical("can't write shard %s.", path.c_str());
+		return false;
+	}
+	shardPaths.push_back(path);
+	index.clear();
+	//the header is written last, once the index is known
+	const char placeholder[headerSize] = { 0 };
+	ofs.write(placeholder, headerSize);
+	return ofs.good();
+}
+
+bool EasyCNN::ShardWriter::add(const void* payload, const size_t label)
+{
+	easyAssert(label < header.classCount, "label is out of range.");
+	if (failed)
+	{
+		return false;
+	}
+	if (!ofs.is_open() && !openShard())
+	{
+		failed = true;
+		return false;
+	}
+	ShardIndexEntry entry;
+	entry.offset = headerSize + index.size() * header.getRecordSize();
+	entry.label = (uint32_t)label;
+	index.push_back(entry);
+	ofs.write((const char*)payload, header.getRecordSize());
+	if (!ofs.good())
+	{
+		logCritical("can't write shard %s.", shardPaths.back().c_str());
+		failed = true;
+		return false;
+	}
+	return index.size() < recordsPerShard || finish();
+}
+
+bool EasyCNN::ShardWriter::finish()
+{
+	if (!ofs.is_open())
+	{
+		return !failed;
+	}
+	const size_t indexBytes = index.size() * sizeof(ShardIndexEntry);
+	header.recordCount = index.size();
+	header.indexOffset = headerSize + index.size() * header.getRecordSize();
+	header.indexChecksum = computeChecksum(index.data(), indexBytes);
+	char bytes[headerSize] = { 0 };
+	memcpy(bytes, shardFileMagic, sizeof(shardFileMagic));
+	putField(bytes, 8, shardFileVersion);
+	putField(bytes, 12, (uint32_t)header.payload);
+	putField(bytes, 16, (uint32_t)header.sampleSize.channels);
+	putField(bytes, 20, (uint32_t)header.sampleSize.height);
+	putField(bytes, 24, (uint32_t)header.sampleSize.width);
+	putField(bytes, 28, (uint32_t)header.classCount);
+	putField(bytes, 32, (uint64_t)header.recordCount);
+	putField(bytes, 40, header.indexOffset);
+	putField(bytes, 48, header.indexChecksum);
+	putField(bytes, headerChecksumOffset, computeChecksum(bytes, headerChecksumOffset));
+	ofs.write((const char*)index.data(), indexBytes);
+	ofs.seekp(0);
+	ofs.write(bytes, headerSize);
+	ofs.close();
+	if (ofs.fail())
+	{
+		logCritical("can't write shard %s.", shardPaths.back().c_str());
+		failed = true;
+	}
+	index.clear();
+	return !failed;
+}
+
+bool EasyCNN::convertIdxToShards(const std::string& imagesPath, const std::string& labelsPath, const std::string& pathPrefix,
+	const size_t recordsPerShard, std::vector<std::string>* shardPaths)
+{
+	const std::shared_ptr<IdxDataset> dataset = IdxDataset::open(imagesPath, labelsPath);
+	if (dataset.get() == nullptr)
+	{
+		return false;
+	}
+	if (dataset->getSampleCount() == 0)
+	{
+		logCritical("IDX images %s hold no sample.", imagesPath.c_str());
+		return false;
+	}
+	ShardWriter writer(pathPrefix, dataset->getSampleSize(), ShardPayload::UInt8, dataset->getClassCount(), recordsPerShard);
+	for (size_t i = 0; i < dataset->getSampleCount(); i++)
+	{
+		if (!writer.add(dataset->getImage(i), dataset->getLabel(i)))
+		{
+			return false;
+		}
+	}
+	const bool result = writer.finish();
+	if (shardPaths != nullptr)
+	{
+		*shardPaths = writer.getShardPaths();
+	}
+	return result;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+
+namespace EasyCNN
+{
+	//shard of labelled samples for datasets larger than memory, host byte order (little endian on every supported target) :
+	//64 byte header | the records' payloads one after another | index, one entry per record.
+	//every payload is one sample (channels x height x width) of uint8 pixels or raw floats, all of a shard's are the same size.
+	//the header checksums itself and the index, payloads aren't checksummed : they're streamed at disk speed.
+	//a reader refuses files with a version newer than its own.
+	const uint32_t shardFileVersion = 1;
+
+	enum class ShardPayload : uint32_t
+	{
+		UInt8 = 0,
+		Float = 1
+	};
+
+	struct ShardIndexEntry
+	{
+		//from the start of the file
+		uint64_t offset = 0;
+		uint32_t label = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct ShardHeader
+	{
+		ShardPayload payload = ShardPayload::UInt8;
+		//number 1
+		DataSize sampleSize;
+		size_t classCount = 0;
+		size_t recordCount = 0;
+		uint64_t indexOffset = 0;
+		uint64_t indexChecksum = 0;
+		//bytes of one payload
+		size_t getRecordSize() const;
+	};
+
+	//reads and checks a shard's header (and its index when index isn't null, labels need it), false (the reason logged)
+	//when the file can't be read or is corrupted
+	bool readShardHeader(std::ifstream& ifs, const std::string& path, ShardHeader& header, std::vector<ShardIndexEntry>* index = nullptr);
+
+	//writes records to shards prefix-00000.shard, prefix-00001.shard ... of recordsPerShard records each (the last one
+	//may hold fewer). payloads go straight to the file, only the open shard's index is kept in memory.
+	class ShardWriter
+	{
+	public:
+		ShardWriter(const std::string& pathPrefix, const DataSize& sampleSize, const ShardPayload payload,
+			const size_t classCount, const size_t recordsPerShard);
+		//finishes the open shard
+		virtual ~ShardWriter();
+		//one sample of getRecordSize() bytes. false when a shard can't be written, the writer is useless from then on.
+		bool add(const void* payload, const size_t label);
+		//writes the open shard's index and header, later adds start a new shard
+		bool finish();
+		//every shard started so far
+		inline const std::vector<std::string>& getShardPaths() const{ return shardPaths; }
+	private:
+		ShardWriter(const ShardWriter&) = delete;
+		ShardWriter& operator=(const ShardWriter&) = delete;
+		bool openShard();
+	private:
+		std::string pathPrefix;
+		ShardHeader header;
+		size_t recordsPerShard = 0;
+		std::ofstream ofs;
+		std::vector<ShardIndexEntry> index;
+		std::vector<std::string> shardPaths;
+		bool failed = false;
+	};
+
+	//an IDX image file and its label file (see IdxDataset) as uint8 shards, shardPaths gets the shards written.
+	//false (the reason logged) when the IDX files can't be read or a shard can't be written.
+	bool convertIdxToShards(const std::string& imagesPath, const std::string& labelsPath, const std::string& pathPrefix,
+		const size_t recordsPerShard, std::vector<std::string>* shardPaths = nullptr);
+}
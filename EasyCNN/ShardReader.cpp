@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "ShardReader.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "Kernels.h"
+
+//ShardReaderStats
+double EasyCNN::ShardReaderStats::getReadBandwidth() const
+{
+	return readSeconds > 0 ? bytesRead / readSeconds : 0.0;
+}
+
+std::string EasyCNN::ShardReaderStats::toString() const
+{
+	char line[256] = { 0 };
+	snprintf(line, sizeof(line), "batches %llu samples %llu shards %llu read %.1fMB (%.1fMB/s) stalls %llu (%.3fs)",
+		(unsigned long long)batches, (unsigned long long)samples, (unsigned long long)shards,
+		bytesRead / (1024.0 * 1024.0), getReadBandwidth() / (1024.0 * 1024.0), (unsigned long long)stalls, stallSeconds);
+	return line;
+}
+
+//ShardReader
+EasyCNN::ShardReader::ShardReader(const std::vector<std::string>& shardPaths, const ShardReaderConfig& config)
+	:shardPaths(shardPaths), config(config), random(config.seed, 0)
+{
+	logVerbose("ShardReader constructed.");
+	easyAssert(!shardPaths.empty(), "shard paths can't be empty!");
+	easyAssert(config.batchSize > 0, "batch size can't be 0.");
+	//headers only, the indices are read with the payloads
+	size_t maxRecordCount = 0;
+	for (size_t i = 0; i < shardPaths.size(); i++)
+	{
+		std::ifstream ifs(shardPaths[i], std::ios::binary);
+		ShardHeader header;
+		easyAssert(ifs.is_open() && readShardHeader(ifs, shardPaths[i], header), "can't read shard header.");
+		if (i == 0)
+		{
+			payload = header.payload;
+			sampleSize = header.sampleSize;
+			recordSize = header.getRecordSize();
+		}
+		easyAssert(header.payload == payload && header.sampleSize == sampleSize, "shards hold different samples.");
+		sampleCount += header.recordCount;
+		classCount = std::max(classCount, header.classCount);
+		maxRecordCount = std::max(maxRecordCount, header.recordCount);
+	}
+	//the one drawn from and readAheadShards more
+	buffers.resize(config.readAheadShards + 1);
+	for (auto& buffer : buffers)
+	{
+		buffer.payloads.resize(maxRecordCount * recordSize);
+		buffer.index.reserve(maxRecordCount);
+		freeBuffers.push_back(&buffer);
+	}
+	//without shuffling a window of one passes the stream through in order
+	const size_t windowCapacity = config.shuffle ? std::max<size_t>(config.shuffleWindow, 1) : 1;
+	window.resize(windowCapacity * recordSize);
+	windowLabels.resize(windowCapacity);
+	DataSize inputSize = sampleSize;
+	inputSize.number = config.batchSize;
+	input = std::make_shared<DataBucket>(inputSize);
+	label = std::make_shared<DataBucket>(DataSize(config.batchSize, classCount, 1, 1));
+	readThread = std::thread(&ShardReader::readLoop, this);
+}
+
+EasyCNN::ShardReader::~ShardReader()
+{
+	stop();
+	logVerbose("ShardReader destructed.");
+}
+
+bool EasyCNN::ShardReader::next(std::shared_ptr<DataBucket>& inputDataBucket, std::shared_ptr<DataBucket>& labelDataBucket)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping || finished)
+		{
+			return false;
+		}
+	}
+	if (!epochStarted)
+	{
+		//even streams order the shards, odd ones draw from the window
+		random = SampleRandom(config.seed, 2 * consumerEpoch + 1);
+		epochStarted = true;
+	}
+	input->reshape(config.batchSize);
+	label->reshape(config.batchSize);
+	float* inputData = input->getData().get();
+	float* labelData = label->getData().get();
+	std::fill(labelData, labelData + config.batchSize * classCount, 0.0f);
+	size_t number = 0;
+	while (number < config.batchSize && drawSample(inputData + number * sampleSize._3DSize(), labelData + number * classCount))
+	{
+		number++;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (number == 0)
+	{
+		epochStarted = false;
+		if (stopping || (config.maxEpochs > 0 && consumerEpoch + 1 >= config.maxEpochs))
+		{
+			finished = true;
+		}
+		else
+		{
+			consumerEpoch++;
+		}
+		return false;
+	}
+	input->reshape(number);
+	label->reshape(number);
+	stats.batches++;
+	stats.samples += number;
+	inputDataBucket = input;
+	labelDataBucket = label;
+	return true;
+}
+
+size_t EasyCNN::ShardReader::getEpoch() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return consumerEpoch;
+}
+
+void EasyCNN::ShardReader::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	readyCondition.notify_all();
+	freeCondition.notify_all();
+	if (readThread.joinable())
+	{
+		readThread.join();
+	}
+}
+
+EasyCNN::ShardReaderStats EasyCNN::ShardReader::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void EasyCNN::ShardReader::resetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats = ShardReaderStats();
+}
+
+bool EasyCNN::ShardReader::drawSample(float* inputData, float* labelData)
+{
+	const size_t windowCapacity = windowLabels.size();
+	while (windowCount < windowCapacity && pullRecord(window.data() + windowCount * recordSize, windowLabels[windowCount]))
+	{
+		windowCount++;
+	}
+	if (windowCount == 0)
+	{
+		return false;
+	}
+	const size_t drawn = windowCapacity > 1 ? random.below(windowCount) : 0;
+	uint8_t* record = window.data() + drawn * recordSize;
+	if (payload == ShardPayload::Float)
+	{
+		memcpy(inputData, record, recordSize);
+	}
+	else
+	{
+		getKernels().u8ToFloat(record, inputData, recordSize, config.scale);
+	}
+	labelData[windowLabels[drawn]] = 1.0f;
+	//the next streamed sample takes the drawn one's place, at the end of the epoch the last one does
+	if (!pullRecord(record, windowLabels[drawn]))
+	{
+		windowCount--;
+		if (drawn != windowCount)
+		{
+			memcpy(record, window.data() + windowCount * recordSize, recordSize);
+			windowLabels[drawn] = windowLabels[windowCount];
+		}
+	}
+	return true;
+}
+
+bool EasyCNN::ShardReader::pullRecord(uint8_t* record, uint32_t& recordLabel)
+{
+	while (current == nullptr || currentOffset == current->recordCount)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (current != nullptr)
+		{
+			freeBuffers.push_back(current);
+			current = nullptr;
+			freeCondition.notify_all();
+		}
+		const auto isReady = [&](){ return stopping || !readyBuffers.empty() || readAll; };
+		if (!isReady())
+		{
+			const Clock::time_point startTime = Clock::now();
+			readyCondition.wait(lock, isReady);
+			if (!readyBuffers.empty())
+			{
+				stats.stalls++;
+				stats.stallSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+			}
+		}
+		//a shard of the next epoch is left where it is for the call that starts the epoch
+		if (stopping || readyBuffers.empty() || readyBuffers.front()->epoch != consumerEpoch)
+		{
+			return false;
+		}
+		current = readyBuffers.front();
+		readyBuffers.pop_front();
+		currentOffset = 0;
+	}
+	memcpy(record, current->payloads.data() + currentOffset * recordSize, recordSize);
+	recordLabel = current->index[currentOffset].label;
+	currentOffset++;
+	return true;
+}
+
+bool EasyCNN::ShardReader::readShard(const std::string& path, ShardBuffer& buffer)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	ShardHeader header;
+	if (!ifs.is_open() || !readShardHeader(ifs, path, header, &buffer.index))
+	{
+		logCritical("can't read shard %s.", path.c_str());
+		return false;
+	}
+	const size_t bytes = header.recordCount * recordSize;
+	if (header.payload != payload || header.sampleSize != sampleSize || bytes > buffer.payloads.size())
+	{
+		logCritical("shard %s changed since the reader was constructed.", path.c_str());
+		return false;
+	}
+	//the payloads lie one after another : one sequential read
+	if (header.recordCount > 0)
+	{
+		ifs.seekg(buffer.index[0].offset);
+		if (!ifs.read((char*)buffer.payloads.data(), bytes))
+		{
+			logCritical("shard %s is truncated.", path.c_str());
+			return false;
+		}
+	}
+	buffer.recordCount = header.recordCount;
+	return true;
+}
+
+void EasyCNN::ShardReader::readLoop()
+{
+	std::vector<size_t> order(shardPaths.size());
+	std::unique_lock<std::mutex> lock(mutex);
+	for (size_t epoch = 0; config.maxEpochs == 0 || epoch < config.maxEpochs; epoch++)
+	{
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+		if (config.shuffle)
+		{
+			SampleRandom(config.seed, 2 * epoch).shuffle(order);
+		}
+		for (const size_t shard : order)
+		{
+			freeCondition.wait(lock, [&](){ return stopping || !freeBuffers.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			ShardBuffer* buffer = freeBuffers.front();
+			freeBuffers.pop_front();
+			lock.unlock();
+			const Clock::time_point startTime = Clock::now();
+			const bool ok = readShard(shardPaths[shard], *buffer);
+			const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+			lock.lock();
+			stats.readSeconds += seconds;
+			if (!ok)
+			{
+				freeBuffers.push_back(buffer);
+				continue;
+			}
+			stats.shards++;
+			stats.bytesRead += buffer->recordCount * recordSize;
+			buffer->epoch = epoch;
+			readyBuffers.push_back(buffer);
+			readyCondition.notify_all();
+		}
+	}
+	readAll = true;
+	readyCondition.notify_all();
+}
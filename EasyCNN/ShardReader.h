@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Configure.h"
+#include "DataBucket.h"
+#include "Dataset.h"
+#include "ShardFile.h"
+
+namespace EasyCNN
+{
+	struct ShardReaderConfig
+	{
+		size_t batchSize = 16;
+		//samples shuffled together : a sample is drawn from the window at random and the next streamed one takes its place.
+		//wider than a shard mixes neighbouring shards, 1 keeps the stream's order
+		size_t shuffleWindow = 4096;
+		//whole shards read ahead of the one being drawn from, the buffers hold as many (plus that one)
+		size_t readAheadShards = 2;
+		//a new shard order and window draws every epoch
+		bool shuffle = true;
+		uint64_t seed = 0;
+		//pixel * scale, uint8 payloads only
+		float scale = 1.0f / 256.0f;
+		//epochs to read, 0 never stops
+		size_t maxEpochs = 0;
+	};
+
+	struct ShardReaderStats
+	{
+		uint64_t batches = 0;
+		uint64_t samples = 0;
+		uint64_t shards = 0;
+		uint64_t bytesRead = 0;
+		//the read ahead thread's time in reads
+		double readSeconds = 0;
+		//next waited for a shard : the disk is the bottleneck
+		uint64_t stalls = 0;
+		double stallSeconds = 0;
+		//bytes read per second of read time
+		double getReadBandwidth() const;
+		//batches, shards, bytes, read bandwidth and stalls on one line
+		std::string toString() const;
+	};
+
+	//streams shards of a dataset larger than memory into training batches. a read ahead thread reads whole shards (header, index,
+	//then every payload in one sequential read) into a fixed set of buffers, the training thread's next copies their samples into
+	//a shuffle window and draws the batch from it (NCHW input, pixels scaled, one hot labels). memory stays at the buffers and
+	//the window whatever the dataset's size, shards are read in a seeded order, so the batches repeat for the same seed.
+	//epochs never mix, the window drains at the end of one.
+	class ShardReader
+	{
+	public:
+		//every shard must hold samples of the same size and payload type, checked on their headers here
+		ShardReader(const std::vector<std::string>& shardPaths, const ShardReaderConfig& config = ShardReaderConfig());
+		virtual ~ShardReader();
+		const ShardReaderConfig& getConfig() const{ return config; }
+		inline size_t getSampleCount() const{ return sampleCount; }
+		//number 1
+		inline DataSize getSampleSize() const{ return sampleSize; }
+		inline size_t getClassCount() const{ return classCount; }
+		//the next batch of the current epoch, or false (once) when the epoch is over : the next call starts the next epoch.
+		//false for good after maxEpochs. the buckets are the reader's, valid until the next call, not to be written.
+		bool next(std::shared_ptr<DataBucket>& inputDataBucket, std::shared_ptr<DataBucket>& labelDataBucket);
+		//epoch of the batches next returns
+		size_t getEpoch() const;
+		//stops the read ahead thread, next returns false from then on. stopping twice is fine.
+		void stop();
+		ShardReaderStats getStats() const;
+		void resetStats();
+	private:
+		typedef std::chrono::steady_clock Clock;
+		//one shard read into memory
+		struct ShardBuffer
+		{
+			std::vector<uint8_t> payloads;
+			std::vector<ShardIndexEntry> index;
+			size_t recordCount = 0;
+			size_t epoch = 0;
+		};
+		ShardReader(const ShardReader&) = delete;
+		ShardReader& operator=(const ShardReader&) = delete;
+		void readLoop();
+		bool readShard(const std::string& path, ShardBuffer& buffer);
+		//copies the epoch's next streamed sample to record, false when the epoch's shards are used up
+		bool pullRecord(uint8_t* record, uint32_t& label);
+		//the window's next sample into row of the batch, false when the epoch is over
+		bool drawSample(float* input, float* label);
+	private:
+		std::vector<std::string> shardPaths;
+		ShardReaderConfig config;
+		ShardPayload payload = ShardPayload::UInt8;
+		DataSize sampleSize;
+		size_t sampleCount = 0;
+		size_t classCount = 0;
+		size_t recordSize = 0;
+		std::vector<ShardBuffer> buffers;
+		std::thread readThread;
+		mutable std::mutex mutex;
+		std::condition_variable readyCondition;
+		std::condition_variable freeCondition;
+		bool stopping = false;
+		//read ahead side : buffers filled in order, finished after maxEpochs
+		std::deque<ShardBuffer*> freeBuffers;
+		std::deque<ShardBuffer*> readyBuffers;
+		bool readAll = false;
+		//consumer side
+		ShardBuffer* current = nullptr;
+		size_t currentOffset = 0;
+		size_t consumerEpoch = 0;
+		bool epochStarted = false;
+		bool finished = false;
+		std::vector<uint8_t> window;
+		std::vector<uint32_t> windowLabels;
+		size_t windowCount = 0;
+		SampleRandom random;
+		std::shared_ptr<DataBucket> input;
+		std::shared_ptr<DataBucket> label;
+		ShardReaderStats stats;
+	};
+}
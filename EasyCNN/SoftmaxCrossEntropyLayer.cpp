@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+#include "SoftmaxCrossEntropyLayer.h"
+#include "Kernels.h"
+
+EasyCNN::SoftmaxCrossEntropyLayer::SoftmaxCrossEntropyLayer()
+{
+
+}
+
+EasyCNN::SoftmaxCrossEntropyLayer::~SoftmaxCrossEntropyLayer()
+{
+
+}
+
+DEFINE_LAYER_TYPE(EasyCNN::SoftmaxCrossEntropyLayer, "SoftmaxCrossEntropyLayer");
+const std::string& EasyCNN::SoftmaxCrossEntropyLayer::getLayerType() const
+{
+	return layerType;
+}
+
+std::shared_ptr<EasyCNN::LayerWorkspace> EasyCNN::SoftmaxCrossEntropyLayer::createWorkspace() const
+{
+	return std::make_shared<Workspace>();
+}
+
+//SoftmaxCrossEntropyLayer forward : same probabilities as SoftmaxLayer, the logits are kept for the loss
+void EasyCNN::SoftmaxCrossEntropyLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
+{
+	const DataSize prevDataSize = prevDataBucket->getSize();
+	const DataSize nextDataSize = nextDataBucket->getSize();
+	Workspace* forwardWorkspace = static_cast<Workspace*>(workspace);
+	forwardWorkspace->logitsBucket = prevDataBucket;
+	forwardWorkspace->diffReady = false;
+
+	const auto kernel = getKernels().softmax;
+	parallelFor(pool, nextDataSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t nn = begin; nn < end; nn++)
+		{
+			const float* prevData = prevDataBucket->getData().get() + nn * prevDataSize._3DSize();
+			float* nextData = nextDataBucket->getData().get() + nn * nextDataSize._3DSize();
+
+			kernel(prevData, nextData, prevDataSize._3DSize());
+		}
+	});
+}
+
+//-sum label * log(prob) = sum label * (logSumExp(logits) - logit), finite however small prob is
+float EasyCNN::SoftmaxCrossEntropyLayer::getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket, const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket)
+{
+	const std::shared_ptr<DataBucket> logitsBucket = static_cast<Workspace*>(getWorkspace())->logitsBucket;
+	easyAssert(logitsBucket.get() != nullptr, "loss must follow forward.");
+	const DataSize logitsSize = logitsBucket->getSize();
+	const DataSize labelSize = labelDataBucket->getSize();
+	easyAssert(labelSize._4DSize() == logitsSize._4DSize(), "label size must equals with output.");
+	const size_t classes = logitsSize._3DSize();
+
+	sampleLosses.resize(logitsSize.number);
+	parallelFor(getThreadPool(), logitsSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t nn = begin; nn < end; nn++)
+		{
+			const float* logits = logitsBucket->getData().get() + nn * classes;
+			const float* label = labelDataBucket->getData().get() + nn * classes;
+			const float maxLogit = *std::max_element(logits, logits + classes);
+			float sumExp = 0.0f;
+			for (size_t i = 0; i < classes; i++)
+			{
+				sumExp += std::exp(logits[i] - maxLogit);
+			}
+			const float logSumExp = maxLogit + std::log(sumExp);
+			float loss = 0.0f;
+			for (size_t i = 0; i < classes; i++)
+			{
+				loss += label[i] * (logSumExp - logits[i]);
+			}
+			sampleLosses[nn] = loss;
+		}
+	});
+
+	float loss = 0.0f;
+	for (const float sampleLoss : sampleLosses)
+	{
+		loss += sampleLoss / logitsSize.number;
+	}
+	return loss;
+}
+
+//d(loss) / d(logits) = prob - label, for labels summing to 1
+std::shared_ptr<EasyCNN::DataBucket> EasyCNN::SoftmaxCrossEntropyLayer::getDiff(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket, const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket)
+{
+	const DataSize outputSize = outputDataBucket->getSize();
+	easyAssert(labelDataBucket->getSize()._4DSize() == outputSize._4DSize(), "label size must equals with output.");
+	if (diffBucket.get() == nullptr || !diffBucket->getSize().isSameSample(outputSize))
+	{
+		diffBucket.reset(new DataBucket(outputSize));
+	}
+	diffBucket->reshape(outputSize.number);
+
+	const float* label = labelDataBucket->getData().get();
+	const float* prob = outputDataBucket->getData().get();
+	float* diff = diffBucket->getData().get();
+	const size_t classes = outputSize._3DSize();
+	parallelFor(getThreadPool(), outputSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t i = begin * classes; i < end * classes; i++)
+		{
+			diff[i] = prob[i] - label[i];
+		}
+	});
+	static_cast<Workspace*>(getWorkspace())->diffReady = true;
+	return diffBucket;
+}
+
+void EasyCNN::SoftmaxCrossEntropyLayer::backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket)
+{
+	easyAssert(getPhase() == Phase::Train, "backward only in train phase.");
+	Workspace* ownWorkspace = static_cast<Workspace*>(getWorkspace());
+	easyAssert(ownWorkspace->diffReady, "SoftmaxCrossEntropyLayer must be the network's loss functor.");
+	easyAssert(nextDiffBucket->getSize() == prevDataBucket->getSize(), "diff size must be equal!");
+	ownWorkspace->diffReady = false;
+
+	//update this layer's param
+	//softmax layer : nop
+
+	//nextDiffBucket already holds the logits' gradient
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include "Configure.h"
+#include "Layer.h"
+#include "LossFunction.h"
+
+namespace EasyCNN
+{
+	//softmax output layer and cross entropy loss in one : forward writes the probabilities,
+	//the loss is taken from the logits by log-sum-exp and the logits' gradient is prob - label.
+	//add it as the last layer and pass the same object to NetWork::setLossFunctor.
+	class SoftmaxCrossEntropyLayer : public Layer, public LossFunctor
+	{
+		FRIEND_WITH_NETWORK
+	public:
+		SoftmaxCrossEntropyLayer();
+		virtual ~SoftmaxCrossEntropyLayer();
+		//LossFunctor, outputDataBucket is this layer's output of the same batch
+		virtual float getLoss(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
+			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket) override;
+		virtual std::shared_ptr<EasyCNN::DataBucket> getDiff(const std::shared_ptr<EasyCNN::DataBucket> labelDataBucket,
+			const std::shared_ptr<EasyCNN::DataBucket> outputDataBucket) override;
+	protected:
+		DECLARE_LAYER_TYPE;
+		virtual const std::string& getLayerType() const override;
+		virtual void forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+			LayerWorkspace* workspace, ThreadPool* pool) const override;
+		//the diff from getDiff already is the logits' gradient, passed through unchanged
+		virtual void backward(std::shared_ptr<DataBucket> prevDataBucket, const std::shared_ptr<DataBucket> nextDataBucket, std::shared_ptr<DataBucket>& nextDiffBucket) override;
+	private:
+		struct Workspace : public LayerWorkspace
+		{
+			std::shared_ptr<DataBucket> logitsBucket;
+			bool diffReady = false;
+		};
+		virtual std::shared_ptr<LayerWorkspace> createWorkspace() const override;
+	private:
+		std::shared_ptr<DataBucket> diffBucket;
+		std::vector<float> sampleLosses;
+	};
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "SoftmaxLayer.h"
+#include "Kernels.h"
 
 EasyCNN::SoftmaxLayer::SoftmaxLayer()
 {
@@ -12,43 +13,29 @@ EasyCNN::SoftmaxLayer::~SoftmaxLayer()
 }
 
 DEFINE_LAYER_TYPE(EasyCNN::SoftmaxLayer, "SoftmaxLayer");
-std::string EasyCNN::SoftmaxLayer::getLayerType() const
+const std::string& EasyCNN::SoftmaxLayer::getLayerType() const
 {
 	return layerType;
 }
 
 //SoftmaxLayer forward
-void EasyCNN::SoftmaxLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket)
+void EasyCNN::SoftmaxLayer::forward(const std::shared_ptr<DataBucket> prevDataBucket, std::shared_ptr<DataBucket> nextDataBucket,
+	LayerWorkspace* workspace, ThreadPool* pool) const
 {
 	const DataSize prevDataSize = prevDataBucket->getSize();
 	const DataSize nextDataSize = nextDataBucket->getSize();
 
-	for (size_t nn = 0; nn < nextDataSize.number; nn++)
+	const auto kernel = getKernels().softmax;
+	parallelFor(pool, nextDataSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		const float* prevData = prevDataBucket->getData().get() + nn * prevDataSize._3DSize();
-		float* nextData = nextDataBucket->getData().get() + nn * nextDataSize._3DSize();
-
-		//step1 : find max value
-		float maxVal = prevData[0];
-		for (size_t prevDataIdx = 0; prevDataIdx < prevDataSize._3DSize(); prevDataIdx++)
+		for (size_t nn = begin; nn < end; nn++)
 		{
-			maxVal = std::max(maxVal, prevData[prevDataIdx]);
-		}
-
-		//step2 : sum
-		float sum = 0;
-		for (size_t prevDataIdx = 0; prevDataIdx < prevDataSize._3DSize(); prevDataIdx++)
-		{
-			nextData[prevDataIdx] = std::exp(prevData[prevDataIdx] - maxVal);
-			sum += nextData[prevDataIdx];
-		}
+			const float* prevData = prevDataBucket->getData().get() + nn * prevDataSize._3DSize();
+			float* nextData = nextDataBucket->getData().get() + nn * nextDataSize._3DSize();
 
-		//step3 : div
-		for (size_t prevDataIdx = 0; prevDataIdx < prevDataSize._3DSize(); prevDataIdx++)
-		{
-			nextData[prevDataIdx] = nextData[prevDataIdx] / sum;
+			kernel(prevData, nextData, prevDataSize._3DSize());
 		}
-	}
+	});
 }
 
 //SoftmaxLayer backward
@@ -62,34 +49,31 @@ void EasyCNN::SoftmaxLayer::backward(std::shared_ptr<DataBucket> prevDataBucket,
 	easyAssert(nextDiffSize == nextDataSize, "next data's and diff's size must be equal! ");
 
 	//update prevDiff data
-	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.height, prevDataSize.width);
+	const DataSize prevDiffSize(prevDataSize.number, prevDataSize.channels, prevDataSize.width, prevDataSize.height);
 	easyAssert(prevDiffSize == nextDiffSize, "diff size must be equal!");
-	std::shared_ptr<DataBucket> prevDiffBucket(std::make_shared<DataBucket>(prevDiffSize));
-	prevDiffBucket->fillData(0.0f);
+	const std::shared_ptr<DataBucket> prevDiffBucket = getDiffBucket(prevDiffSize, DataLayout::NCHW);
 
-	for (size_t pn = 0; pn < prevDataSize.number; pn++)
+	parallelFor(getThreadPool(), prevDataSize.number, [&](const size_t begin, const size_t end, const size_t threadIdx)
 	{
-		const float* prevData = prevDataBucket->getData().get() + pn*prevDataSize._3DSize();
-		const float* nextData = nextDataBucket->getData().get() + pn*nextDataSize._3DSize();
-		const float* nextDiff = nextDiffBucket->getData().get() + pn*nextDiffSize._3DSize();
+		for (size_t pn = begin; pn < end; pn++)
+		{
+			const float* nextData = nextDataBucket->getData().get() + pn*nextDataSize._3DSize();
+			const float* nextDiff = nextDiffBucket->getData().get() + pn*nextDiffSize._3DSize();
 
-		float* prevDiff = prevDiffBucket->getData().get() + pn * prevDiffSize._3DSize();
+			float* prevDiff = prevDiffBucket->getData().get() + pn * prevDiffSize._3DSize();
 
-		for (size_t prevDiffIdx = 0; prevDiffIdx < prevDiffSize._3DSize(); prevDiffIdx++)
-		{
+			//jacobian times diff without forming the jacobian : prevDiff(i) = y(i) * (nextDiff(i) - sum y(j) * nextDiff(j))
+			float weightedDiff = 0.0f;
 			for (size_t nextDiffIdx = 0; nextDiffIdx < nextDiffSize._3DSize(); nextDiffIdx++)
 			{
-				if (nextDiffIdx == prevDiffIdx)
-				{
-					prevDiff[prevDiffIdx] += nextData[prevDiffIdx] * (1.0f - nextData[prevDiffIdx]) * nextDiff[nextDiffIdx];
-				}
-				else
-				{
-					prevDiff[prevDiffIdx] -= nextData[prevDiffIdx] * nextData[nextDiffIdx] * nextDiff[nextDiffIdx];
-				}
+				weightedDiff += nextData[nextDiffIdx] * nextDiff[nextDiffIdx];
+			}
+			for (size_t prevDiffIdx = 0; prevDiffIdx < prevDiffSize._3DSize(); prevDiffIdx++)
+			{
+				prevDiff[prevDiffIdx] = nextData[prevDiffIdx] * (nextDiff[prevDiffIdx] - weightedDiff);
 			}
 		}
-	}
+	});
 
 	//update this layer's param
 	//softmax layer : nop
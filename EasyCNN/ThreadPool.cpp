@@ -0,0 +1,203 @@
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "ThreadPool.h"
+#include "EasyAssert.h"
+
+//the pool whose task runs on this thread and the index of its worker, null / -1 outside of any task
+static thread_local const EasyCNN::ThreadPool* currentPool = nullptr;
+static thread_local ptrdiff_t currentWorker = -1;
+
+static void pinCurrentThread(const size_t core)
+{
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core % CPU_SETSIZE, &cpuSet);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#else
+	(void)core;
+#endif
+}
+
+EasyCNN::ThreadPool::ThreadPool(const size_t threadCount, const bool pinThreads)
+	:pendingChunks(0)
+{
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	this->threadCount = threadCount == 0 ? hardwareThreads : threadCount;
+	for (size_t i = 0; i < this->threadCount; i++)
+	{
+		queues.emplace_back(new ChunkQueue());
+	}
+	for (size_t i = 1; i < this->threadCount; i++)
+	{
+		workers.emplace_back([this, i, pinThreads, hardwareThreads]()
+		{
+			if (pinThreads)
+			{
+				pinCurrentThread(i % hardwareThreads);
+			}
+			workerLoop(i);
+		});
+	}
+}
+
+EasyCNN::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+bool EasyCNN::ThreadPool::popChunk(const size_t threadIdx, size_t& chunk)
+{
+	//own run from the front
+	{
+		ChunkQueue& queue = *queues[threadIdx];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.begin < queue.end)
+		{
+			chunk = queue.begin++;
+			return true;
+		}
+	}
+	//steal from the back of the others
+	for (size_t i = 1; i < threadCount; i++)
+	{
+		ChunkQueue& queue = *queues[(threadIdx + i) % threadCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.begin < queue.end)
+		{
+			chunk = --queue.end;
+			return true;
+		}
+	}
+	return false;
+}
+
+void EasyCNN::ThreadPool::runChunks(const size_t threadIdx)
+{
+	currentPool = this;
+	currentWorker = (ptrdiff_t)threadIdx;
+	size_t chunk = 0;
+	while (popChunk(threadIdx, chunk))
+	{
+		const size_t begin = chunk * grain;
+		const size_t end = std::min(count, begin + grain);
+		(*task)(begin, end, threadIdx);
+		if (pendingChunks.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(stateMutex);
+			doneCondition.notify_all();
+		}
+	}
+	currentPool = nullptr;
+	currentWorker = -1;
+}
+
+void EasyCNN::ThreadPool::workerLoop(const size_t threadIdx)
+{
+	size_t seenGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(stateMutex);
+			wakeCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+			if (stopping)
+			{
+				return;
+			}
+			seenGeneration = generation;
+		}
+		runChunks(threadIdx);
+	}
+}
+
+void EasyCNN::ThreadPool::parallelFor(const size_t count, const ParallelTask& task, const size_t grain)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	const size_t chunkGrain = std::max<size_t>(grain, 1);
+	const size_t chunks = (count + chunkGrain - 1) / chunkGrain;
+	if (currentPool == this)
+	{
+		task(0, count, (size_t)currentWorker);
+		return;
+	}
+	//inside another pool's task (one pool per data parallel replica) this pool's thread 0 runs it all
+	if (threadCount == 1 || chunks == 1 || currentPool != nullptr)
+	{
+		const ThreadPool* outerPool = currentPool;
+		const ptrdiff_t outerWorker = currentWorker;
+		currentPool = this;
+		currentWorker = 0;
+		task(0, count, 0);
+		currentPool = outerPool;
+		currentWorker = outerWorker;
+		return;
+	}
+
+	std::lock_guard<std::mutex> jobLock(jobMutex);
+	this->task = &task;
+	this->count = count;
+	this->grain = chunkGrain;
+	pendingChunks = chunks;
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		ChunkQueue& queue = *queues[i];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.begin = chunks * i / threadCount;
+		queue.end = chunks * (i + 1) / threadCount;
+	}
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	runChunks(0);
+	std::unique_lock<std::mutex> lock(stateMutex);
+	doneCondition.wait(lock, [&]() { return pendingChunks.load() == 0; });
+	this->task = nullptr;
+}
+
+void EasyCNN::prepareThreadBuffers(ThreadPool* pool, std::vector<std::vector<float>>& buffers, const size_t size)
+{
+	buffers.resize(getThreadCount(pool));
+	for (auto& buffer : buffers)
+	{
+		buffer.assign(size, 0.0f);
+	}
+}
+
+void EasyCNN::reduceThreadBuffers(ThreadPool* pool, const std::vector<std::vector<float>>& buffers, float* result)
+{
+	easyAssert(!buffers.empty(), "thread buffers are not prepared.");
+	const size_t size = buffers[0].size();
+	parallelFor(pool, size, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			float sum = 0.0f;
+			for (const auto& buffer : buffers)
+			{
+				sum += buffer[i];
+			}
+			result[i] = sum;
+		}
+	}, 4096);
+}
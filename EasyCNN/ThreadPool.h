@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <type_traits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	//task(begin, end, threadIdx) : threadIdx is in [0, threadCount), use it to pick thread local buffers.
+	//a non owning reference to the callable (a lambda on the caller's stack), handing work to the pool allocates nothing.
+	class ParallelTask
+	{
+	public:
+		template <typename Callable, typename = typename std::enable_if<!std::is_same<typename std::decay<Callable>::type, ParallelTask>::value>::type>
+		ParallelTask(const Callable& callable)
+			:object(&callable), invoker(&invoke<Callable>)
+		{
+		}
+		inline void operator()(const size_t begin, const size_t end, const size_t threadIdx) const
+		{
+			invoker(object, begin, end, threadIdx);
+		}
+	private:
+		template <typename Callable>
+		static void invoke(const void* object, const size_t begin, const size_t end, const size_t threadIdx)
+		{
+			(*static_cast<const Callable*>(object))(begin, end, threadIdx);
+		}
+	private:
+		const void* object;
+		void(*invoker)(const void* object, const size_t begin, const size_t end, const size_t threadIdx);
+	};
+
+	//persistent worker threads with work stealing.
+	//parallelFor splits [0, count) into chunks of grain items, deals them out as contiguous runs, one per thread,
+	//and an idle thread steals chunks from the back of the others' runs.
+	//the calling thread works as thread 0, parallelFor returns once every chunk is done.
+	//nested calls from inside a task run serially on the calling worker, calls on another pool from inside
+	//a task run serially as that pool's thread 0 (so a pool must not be used by two outer tasks at once).
+	class ThreadPool
+	{
+	public:
+		//threadCount 0 uses every hardware thread.
+		//pinThreads binds worker i to core i (the caller's thread is left alone).
+		explicit ThreadPool(const size_t threadCount = 0, const bool pinThreads = false);
+		virtual ~ThreadPool();
+		size_t getThreadCount() const { return threadCount; }
+		void parallelFor(const size_t count, const ParallelTask& task, const size_t grain = 1);
+	private:
+		struct ChunkQueue
+		{
+			std::mutex mutex;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+		void workerLoop(const size_t threadIdx);
+		void runChunks(const size_t threadIdx);
+		bool popChunk(const size_t threadIdx, size_t& chunk);
+	private:
+		size_t threadCount = 1;
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<ChunkQueue>> queues;
+		//one parallelFor at a time
+		std::mutex jobMutex;
+		//current job
+		const ParallelTask* task = nullptr;
+		size_t count = 0;
+		size_t grain = 1;
+		std::atomic<size_t> pendingChunks;
+		//wake up / completion
+		std::mutex stateMutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable doneCondition;
+		size_t generation = 0;
+		bool stopping = false;
+	};
+
+	//runs on pool, or serially as thread 0 when pool is null
+	inline void parallelFor(ThreadPool* pool, const size_t count, const ParallelTask& task, const size_t grain = 1)
+	{
+		if (pool == nullptr)
+		{
+			if (count > 0)
+			{
+				task(0, count, 0);
+			}
+			return;
+		}
+		pool->parallelFor(count, task, grain);
+	}
+
+	inline size_t getThreadCount(const ThreadPool* pool)
+	{
+		return pool == nullptr ? 1 : pool->getThreadCount();
+	}
+
+	//thread local accumulation buffers : one per pool thread, each of the same size.
+	//prepareThreadBuffers sizes and zeroes them, reduceThreadBuffers writes their element wise sum to result.
+	void prepareThreadBuffers(ThreadPool* pool, std::vector<std::vector<float>>& buffers, const size_t size);
+	void reduceThreadBuffers(ThreadPool* pool, const std::vector<std::vector<float>>& buffers, float* result);
+}
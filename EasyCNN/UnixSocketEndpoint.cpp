@@ -0,0 +1,247 @@
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <vector>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "UnixSocketEndpoint.h"
+#include "EasyAssert.h"
+#include "EasyLogger.h"
+#include "InferenceServer.h"
+
+#ifndef _WIN32
+//short reads / writes are retried, false once the peer is gone
+static bool readFully(const int fd, void* data, const size_t bytes)
+{
+	char* cursor = (char*)data;
+	size_t left = bytes;
+	while (left > 0)
+	{
+		const ssize_t got = recv(fd, cursor, left, 0);
+		if (got <= 0)
+		{
+			return false;
+		}
+		cursor += got;
+		left -= (size_t)got;
+	}
+	return true;
+}
+
+static bool writeFully(const int fd, const void* data, const size_t bytes)
+{
+	const char* cursor = (const char*)data;
+	size_t left = bytes;
+	while (left > 0)
+	{
+		//a client that hung up must not kill the process with SIGPIPE
+		const ssize_t sent = send(fd, cursor, left, MSG_NOSIGNAL);
+		if (sent <= 0)
+		{
+			return false;
+		}
+		cursor += sent;
+		left -= (size_t)sent;
+	}
+	return true;
+}
+#endif
+
+EasyCNN::UnixSocketEndpoint::UnixSocketEndpoint(InferenceServer& server, const size_t maxFrameSamples)
+	:server(server), maxFrameSamples(maxFrameSamples)
+{
+	logVerbose("UnixSocketEndpoint constructed.");
+	easyAssert(maxFrameSamples > 0, "maxFrameSamples can't be 0.");
+}
+
+EasyCNN::UnixSocketEndpoint::~UnixSocketEndpoint()
+{
+	stop();
+	logVerbose("UnixSocketEndpoint destructed.");
+}
+
+#ifdef _WIN32
+bool EasyCNN::UnixSocketEndpoint::start(const std::string& path)
+{
+	logCritical("unix socket endpoint isn't supported on this platform, can't serve %s.", path.c_str());
+	return false;
+}
+
+void EasyCNN::UnixSocketEndpoint::stop()
+{
+}
+
+void EasyCNN::UnixSocketEndpoint::acceptLoop()
+{
+}
+
+void EasyCNN::UnixSocketEndpoint::serveConnection(Connection* connection)
+{
+}
+
+void EasyCNN::UnixSocketEndpoint::reapConnections()
+{
+}
+#else
+bool EasyCNN::UnixSocketEndpoint::start(const std::string& path)
+{
+	easyAssert(listenFd < 0, "endpoint is already started.");
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+	{
+		logCritical("socket path %s is empty or too long.", path.c_str());
+		return false;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size());
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		logCritical("can't create unix socket.");
+		return false;
+	}
+	unlink(path.c_str());
+	if (bind(fd, (const sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+	{
+		logCritical("can't listen on %s.", path.c_str());
+		close(fd);
+		return false;
+	}
+	this->path = path;
+	listenFd = fd;
+	stopping = false;
+	acceptThread = std::thread(&UnixSocketEndpoint::acceptLoop, this);
+	return true;
+}
+
+void EasyCNN::UnixSocketEndpoint::stop()
+{
+	if (listenFd < 0)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		stopping = true;
+		//wakes the blocked accept / recv calls, the fds are closed by their owners
+		shutdown(listenFd, SHUT_RDWR);
+		for (auto& connection : connections)
+		{
+			if (!connection.done)
+			{
+				shutdown(connection.fd, SHUT_RDWR);
+			}
+		}
+	}
+	acceptThread.join();
+	for (auto& connection : connections)
+	{
+		connection.thread.join();
+	}
+	connections.clear();
+	close(listenFd);
+	listenFd = -1;
+	unlink(path.c_str());
+}
+
+void EasyCNN::UnixSocketEndpoint::acceptLoop()
+{
+	for (;;)
+	{
+		const int fd = accept(listenFd, nullptr, nullptr);
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		if (stopping)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+			return;
+		}
+		if (fd < 0)
+		{
+			continue;
+		}
+		reapConnections();
+		connections.push_back(Connection());
+		Connection* connection = &connections.back();
+		connection->fd = fd;
+		connection->thread = std::thread(&UnixSocketEndpoint::serveConnection, this, connection);
+	}
+}
+
+void EasyCNN::UnixSocketEndpoint::reapConnections()
+{
+	for (auto it = connections.begin(); it != connections.end();)
+	{
+		if (it->done)
+		{
+			it->thread.join();
+			it = connections.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void EasyCNN::UnixSocketEndpoint::serveConnection(Connection* connection)
+{
+	const int fd = connection->fd;
+	const size_t inputSampleSize = server.getInputSize()._3DSize();
+	const size_t outputSampleSize = server.getOutputSize()._3DSize();
+	std::vector<float> inputs;
+	std::vector<float> outputs;
+	std::vector<std::future<std::vector<float>>> results;
+	for (;;)
+	{
+		uint32_t number = 0;
+		if (!readFully(fd, &number, sizeof(number)))
+		{
+			break;
+		}
+		if (number == 0 || number > maxFrameSamples)
+		{
+			logCritical("unix socket frame of %u samples is refused.", number);
+			break;
+		}
+		inputs.resize(number * inputSampleSize);
+		if (!readFully(fd, inputs.data(), inputs.size() * sizeof(float)))
+		{
+			break;
+		}
+		results.clear();
+		for (size_t i = 0; i < number; i++)
+		{
+			results.push_back(server.submit(inputs.data() + i * inputSampleSize));
+		}
+		outputs.resize(number * outputSampleSize);
+		bool failed = false;
+		for (size_t i = 0; i < number; i++)
+		{
+			try
+			{
+				const std::vector<float> output = results[i].get();
+				std::copy(output.begin(), output.end(), outputs.begin() + i * outputSampleSize);
+			}
+			catch (...)
+			{
+				failed = true;
+			}
+		}
+		if (failed || !writeFully(fd, &number, sizeof(number)) ||
+			!writeFully(fd, outputs.data(), outputs.size() * sizeof(float)))
+		{
+			break;
+		}
+	}
+	std::lock_guard<std::mutex> lock(connectionsMutex);
+	close(fd);
+	connection->done = true;
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Configure.h"
+
+namespace EasyCNN
+{
+	class InferenceServer;
+
+	//serves an InferenceServer on a unix domain socket (not available on windows, start fails there).
+	//a request frame is a uint32 sample count followed by that many input samples as floats, the response
+	//frame the same count followed by the output samples, host byte order both ways. a connection may send
+	//any number of frames, its samples go to the server one by one and batch with every other client's.
+	//a frame with 0 or more than maxFrameSamples samples closes the connection.
+	class UnixSocketEndpoint
+	{
+	public:
+		explicit UnixSocketEndpoint(InferenceServer& server, const size_t maxFrameSamples = 1024);
+		virtual ~UnixSocketEndpoint();
+		//binds path (an existing socket file there is replaced) and starts accepting
+		bool start(const std::string& path);
+		//closes the listening socket and every connection, removes the socket file
+		void stop();
+	private:
+		struct Connection
+		{
+			int fd = -1;
+			std::thread thread;
+			//set by the connection's thread as it leaves, the accept loop then joins it
+			bool done = false;
+		};
+		UnixSocketEndpoint(const UnixSocketEndpoint&) = delete;
+		UnixSocketEndpoint& operator=(const UnixSocketEndpoint&) = delete;
+		void acceptLoop();
+		void serveConnection(Connection* connection);
+		//joins and forgets connections that are done
+		void reapConnections();
+	private:
+		InferenceServer& server;
+		size_t maxFrameSamples = 0;
+		std::string path;
+		int listenFd = -1;
+		std::thread acceptThread;
+		std::mutex connectionsMutex;
+		std::list<Connection> connections;
+		bool stopping = false;
+	};
+}
